@@ -14,29 +14,19 @@
 #include <QtOpenGL>
 
 #include "GLCanvas.h"
-
-#define SFM_BACKGROUND_COLOR     1.0f, 1.0f, 1.0f, 1.0f
+#include "render.h"
 
 using namespace std;
 
 namespace sfmviewer {
 
-	/* ************************************************************************* */
-	// the conversion matrix from OpenGL default coordinate system
-	//  to the camera coordiante system:
-	// [ 1  0  0  0] * [ x ] = [ x ]
-	//   0 -1  0  0      y      -y
-	//   0  0 -1  0      z      -z
-	//   0  0  0  1      1       1
-	const GLfloat m_convert[4][4] = {
-			{1.,  0.,  0., 0.},
-			{0., -1.,  0., 0.},
-			{0.,	0., -1., 0.},
-			{0.,  0.,  0., 1.}};
-
 	/* ************************************************************************* */
 	GLCanvas::GLCanvas(QWidget *parent) :
-		QGLWidget(QGLFormat(QGL::SampleBuffers), parent) {
+		QGLWidget(QGLFormat(QGL::SampleBuffers), parent), selecting_(false), lasso_(false),
+		drawLayer_(new CallbackLayer), picker_(NULL), selectable_(NULL), selection_(NULL) {
+		// the immediate drawing of setDrawFunc comes first
+		scene_.add(drawLayer_);
+
 		// initial camera pose
 		glPose_.m_shift[0] = 0.0f;
 		glPose_.m_shift[1] = 0.0f;
@@ -61,6 +51,9 @@ namespace sfmviewer {
 
 	/* ************************************************************************* */
 	GLCanvas::~GLCanvas() {
+		// the cached buffers go with the context, which has to be current to delete them
+		makeCurrent();
+		releaseDrawCache();
 	}
 
 	/* ************************************************************************* */
@@ -82,59 +75,56 @@ namespace sfmviewer {
 
 	/* ************************************************************************* */
 	void GLCanvas::initializeGL() {
-		// remove back faces
-		glEnable( GL_CULL_FACE);
-		glEnable( GL_DEPTH_TEST);
-		glEnable(GL_MULTISAMPLE);
-
-		// speedups
-		glEnable(GL_DITHER);
-		glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_FASTEST);
-		glHint(GL_POLYGON_SMOOTH_HINT, GL_FASTEST);
-		glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-		glEnable( GL_POINT_SMOOTH);
-
-		glClearColor(SFM_BACKGROUND_COLOR);
+		setGLDefaults();
 	}
 
 	/* ************************************************************************* */
 	void GLCanvas::paintGL() {
 
 		// Transformations
-		glMatrixMode( GL_MODELVIEW);
-		glLoadIdentity();
-		GLfloat prj[4][4];
-		build_tran_matrix(glPose_, prj);
-		glMultTransposeMatrixf((GLfloat*)m_convert); // second, convert the camera coordinates to the opengl camera coordinates
-		glMultTransposeMatrixf((GLfloat*)prj);       // first, project the points in the world coordinates to the camera coorrdinates
+		setGLModelView(glPose_);
 
 		// background
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		fun_draw_();
+		scene_.draw();
+
+		if (selecting_) drawSelectionPath();
 
 		glFlush();
 	}
 
 	/* ************************************************************************* */
 	void GLCanvas::resizeGL(int width, int height) {
-		// the calibration matrix only depends on the window aspect ratio
-		glMatrixMode( GL_PROJECTION);
-
-    // set the viewport size
-    glViewport(0, 0, width, height);
-
-		glLoadIdentity();
-		gluPerspective(60.0, (GLfloat) width / height, 0.01, 5000.0); // the 3rd parameter
+		setGLProjection(width, height);
 	}
 
 	/* ************************************************************************* */
 	void GLCanvas::mousePressEvent(QMouseEvent *event) {
 		lastPos_ = event->pos();
+		pressPos_ = event->pos();
+
+		// start a selection
+		if (selection_ && (event->button() == Qt::LeftButton) && (event->modifiers() & Qt::ShiftModifier)) {
+			selecting_ = true;
+			lasso_ = event->modifiers() & Qt::ControlModifier;
+			selectionPath_.clear();
+			selectionPath_ << event->pos() << event->pos();
+		}
 	}
 
 	/* ************************************************************************* */
 	void GLCanvas::mouseMoveEvent(QMouseEvent *event) {
+		// extend the rectangle or the lasso
+		if (selecting_) {
+			if (lasso_)
+				selectionPath_ << event->pos();
+			else
+				selectionPath_[1] = event->pos();
+			updateGL();
+			return;
+		}
+
 		float m_shift_step = 0.01f;
 
 		float scale = 10;
@@ -181,16 +171,87 @@ namespace sfmviewer {
 		updateGL();
 
 		// update status bar
-		if (parentWidget()) {
-			stringstream portMsg;
-			portMsg << glPose_.m_shift[0] << ", " << glPose_.m_shift[1] << ", "
-							<< glPose_.m_shift[2] << ", " << glPose_.m_quat[0] << ", "
-							<< glPose_.m_quat[1] << ", " << glPose_.m_quat[2] << ", "
-							<< glPose_.m_quat[3] << endl;
-			// TODO: check whether the parent is actually a QMainWindow
-			((QMainWindow*) parentWidget())->statusBar()->showMessage(
-					QString::fromStdString(portMsg.str()));
+		stringstream portMsg;
+		portMsg << glPose_.m_shift[0] << ", " << glPose_.m_shift[1] << ", "
+						<< glPose_.m_shift[2] << ", " << glPose_.m_quat[0] << ", "
+						<< glPose_.m_quat[1] << ", " << glPose_.m_quat[2] << ", "
+						<< glPose_.m_quat[3] << endl;
+		showStatus(portMsg.str());
+	}
+
+	/* ************************************************************************* */
+	void GLCanvas::mouseReleaseEvent(QMouseEvent *event) {
+		if (selecting_) {
+			selecting_ = false;
+			Selection::Mode mode = (event->modifiers() & Qt::AltModifier) ? Selection::SUBTRACT : Selection::REPLACE;
+			if (lasso_)
+				selection_->selectLasso(*selectable_, glPose_, width(), height(), selectionPath_, mode);
+			else
+				selection_->selectRect(*selectable_, glPose_, width(), height(),
+						QRect(selectionPath_[0], selectionPath_[1]), mode);
+
+			stringstream msg;
+			msg << selection_->count() << " points selected";
+			showStatus(msg.str());
+			updateGL();
+			return;
+		}
+
+		if (!picker_ || event->button() != Qt::LeftButton || (event->pos() - pressPos_).manhattanLength() > 2)
+			return;
+
+		PickResult result = picker_->pick(glPose_, event->x(), event->y(), width(), height());
+		stringstream msg;
+		switch (result.type) {
+		case PickResult::POINT:  msg << "point ";  break;
+		case PickResult::CAMERA: msg << "camera "; break;
+		default:                 msg << "nothing picked"; break;
 		}
+		if (result.type != PickResult::NOTHING)
+			msg << result.index << ": " << result.position.X << ", " << result.position.Y << ", " << result.position.Z;
+		showStatus(msg.str());
+
+		if (fun_pick_) fun_pick_(result);
+	}
+
+	/* ************************************************************************* */
+	void GLCanvas::showStatus(const string& msg) {
+		// TODO: check whether the parent is actually a QMainWindow
+		if (parentWidget())
+			((QMainWindow*) parentWidget())->statusBar()->showMessage(QString::fromStdString(msg));
+	}
+
+	/* ************************************************************************* */
+	void GLCanvas::drawSelectionPath() {
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadIdentity();
+		gluOrtho2D(0, width(), height(), 0);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+		glDisable(GL_DEPTH_TEST);
+
+		glColor4f(0.f, 0.f, 0.f, 1.f);
+		glLineWidth(1.);
+		glBegin(GL_LINE_LOOP);
+		if (lasso_) {
+			for (int i=0; i<selectionPath_.size(); i++)
+				glVertex2f(selectionPath_[i].x() + 0.5f, selectionPath_[i].y() + 0.5f);
+		} else {
+			QRect rect = QRect(selectionPath_[0], selectionPath_[1]).normalized();
+			glVertex2f(rect.left() + 0.5f, rect.top() + 0.5f);
+			glVertex2f(rect.right() + 0.5f, rect.top() + 0.5f);
+			glVertex2f(rect.right() + 0.5f, rect.bottom() + 0.5f);
+			glVertex2f(rect.left() + 0.5f, rect.bottom() + 0.5f);
+		}
+		glEnd();
+
+		glEnable(GL_DEPTH_TEST);
+		glPopMatrix();
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
 	}
 
 	/* ************************************************************************* */
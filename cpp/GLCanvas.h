@@ -11,13 +11,17 @@
 #include <boost/function.hpp>
 #include <boost/optional.hpp>
 #include <QGLWidget>
+#include <QPolygon>
 
 #include "trackball.h"
+#include "picking.h"
+#include "selection.h"
+#include "scene.h"
 
 namespace sfmviewer {
 
-	// callback function types
-	typedef boost::function<void ()> Callback;
+	// callback function types, see scene.h for Callback
+	typedef boost::function<void (const PickResult&)> PickCallback;
 
 	class GLCanvas : public QGLWidget
 	{
@@ -40,14 +44,30 @@ namespace sfmviewer {
 		// Called from window.cpp to set default size
 		void setSizeHint(int w, int h);
 
-		// set up users' callback functions
-		void setDrawFunc(const Callback& fun_draw) { fun_draw_ = fun_draw; }
+		// set up users' callback functions, which are drawn as the first layer of the scene
+		void setDrawFunc(const Callback& fun_draw) { drawLayer_->setCallback(fun_draw); }
+
+		// the layers drawn by the canvas
+		Scene& scene() { return scene_; }
 
 		// set the current opengl camera pose
 		void setGLPose(const QuatPose& pose) { glPose_ = pose; }
+		const QuatPose& glPose() const { return glPose_; }
 
 		void setGLPoseTop(const QuatPose& pose) { glPoseTop_ = pose; }
 
+		// set the picker that answers mouse clicks, which has to outlive the canvas
+		void setPicker(const Picker* picker) { picker_ = picker; }
+
+		// set the callback for clicked points and cameras
+		void setPickFunc(const PickCallback& fun_pick) { fun_pick_ = fun_pick; }
+
+		// let shift + drag select a rectangle of {structure} into {selection}, shift + control + drag
+		// a lasso, and holding alt as well removes from the selection; both have to outlive the canvas
+		void setSelection(const std::vector<Vertex>& structure, Selection& selection) {
+			selectable_ = &structure; selection_ = &selection;
+		}
+
 		// set the refresh interval
 		void setRefreshInterval(int msec);
 
@@ -70,6 +90,15 @@ namespace sfmviewer {
 		// mouse click and drag
 		void mouseMoveEvent(QMouseEvent *event);
 
+		// pick the point or camera under a click that did not drag
+		void mouseReleaseEvent(QMouseEvent *event);
+
+		// show a message in the status bar of the parent window
+		void showStatus(const std::string& msg);
+
+		// draw the rubber band of the current selection
+		void drawSelectionPath();
+
 		// create actions for events
 		void createActions();
 
@@ -88,6 +117,14 @@ namespace sfmviewer {
 		// the last position of mouse clicks
 		QPoint lastPos_;
 
+		// the position where the mouse button went down
+		QPoint pressPos_;
+
+		// the rectangle corners or the lasso while the user drags a selection
+		QPolygon selectionPath_;
+		bool selecting_;
+		bool lasso_;
+
 		int hintWidth_;
 		int hintHeight_;
 
@@ -97,8 +134,19 @@ namespace sfmviewer {
 		// the pose when the opengl camera is at top
 		QuatPose glPoseTop_;
 
+		// the retained layers and the one drawing the callback of setDrawFunc
+		Scene scene_;
+		boost::shared_ptr<CallbackLayer> drawLayer_;
+
 		// the pointers of callback functions
-		Callback fun_draw_;
+		PickCallback fun_pick_;
+
+		// the spatial index of the clickable points and cameras
+		const Picker* picker_;
+
+		// the points that can be selected and their selection
+		const std::vector<Vertex>* selectable_;
+		Selection* selection_;
 
 		// the action to change mouse speed
 		QAction* changeTopViewAct;
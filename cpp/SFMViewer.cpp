@@ -25,7 +25,7 @@ namespace sfmviewer {
 		setWindowTitle(QString::fromStdString(title));
 
 		// set up menus
-		QMenu *helpMenu = new QMenu(tr("Help"), this);
+		helpMenu = new QMenu(tr("Help"), this);
 		menuBar()->addMenu(helpMenu);
 		helpMenu->addAction(tr("About"), this, SLOT(about()));
 		helpMenu->addAction(tr("preferences"), this, SLOT(config()));
@@ -38,6 +38,7 @@ namespace sfmviewer {
 		setCentralWidget(glCanvas);
 
 		fun_timer_ = NULL;
+		sliderBar_ = NULL;
 	}
 
 	/* ************************************************************************* */
@@ -51,6 +52,46 @@ namespace sfmviewer {
 		glCanvas->setSizeHint(width, height);
 	}
 
+	/* ************************************************************************* */
+	void SFMViewer::addMenuAction(const std::string& menu, const std::string& name, const Callback& fun) {
+		QMenu*& qmenu = menus_[menu];
+		if (!qmenu) {
+			qmenu = new QMenu(QString::fromStdString(menu), this);
+			menuBar()->insertMenu(helpMenu->menuAction(), qmenu);
+		}
+		qmenu->addAction(QString::fromStdString(name), new CallbackSlot(fun, this), SLOT(call()));
+	}
+
+	/* ************************************************************************* */
+	QSlider* SFMViewer::addSlider(const std::string& name, int minimum, int maximum, int value, const IntCallback& fun) {
+		if (!sliderBar_) sliderBar_ = addToolBar(tr("Sliders"));
+
+		QSlider* slider = new QSlider(Qt::Horizontal, sliderBar_);
+		slider->setRange(minimum, maximum);
+		slider->setValue(value);
+		SliderLabel* label = new SliderLabel(QString::fromStdString(name) + ": %1", value);
+		connect(slider, SIGNAL(valueChanged(int)), label, SLOT(setPos(int)));
+		connect(slider, SIGNAL(valueChanged(int)), new IntCallbackSlot(fun, this), SLOT(call(int)));
+		sliderBar_->addWidget(label);
+		sliderBar_->addWidget(slider);
+		return slider;
+	}
+
+	/* ************************************************************************* */
+	QLabel* SFMViewer::addPanel(const std::string& name) {
+		QDockWidget* dock = new QDockWidget(QString::fromStdString(name), this);
+		QLabel* label = new QLabel(dock);
+		QFont font("Monospace");
+		font.setStyleHint(QFont::TypeWriter);
+		label->setFont(font);
+		label->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+		label->setTextInteractionFlags(Qt::TextSelectableByMouse);
+		label->setMargin(6);
+		dock->setWidget(label);
+		addDockWidget(Qt::RightDockWidgetArea, dock);
+		return label;
+	}
+
 	/* ************************************************************************* */
 	void SFMViewer::keyPressEvent(QKeyEvent *e)
 	{
@@ -8,17 +8,52 @@
 
 #pragma once
 
+#include <map>
 #include <QMainWindow>
 #include "GLCanvas.h"
 
 QT_BEGIN_NAMESPACE
+class QLabel;
 class QSlider;
+class QToolBar;
 QT_END_NAMESPACE
 
 QT_FORWARD_DECLARE_CLASS(QMenu)
 
 namespace sfmviewer {
 
+	// forwards a qt signal to a boost callback
+	class CallbackSlot : public QObject
+	{
+		Q_OBJECT
+
+	public:
+		CallbackSlot(const Callback& fun, QObject *parent) : QObject(parent), fun_(fun) {}
+
+	public slots:
+		void call() { fun_(); }
+
+	private:
+		Callback fun_;
+	};
+
+	typedef boost::function<void (int)> IntCallback;
+
+	// forwards a qt signal with an integer, e.g. the value of a slider, to a boost callback
+	class IntCallbackSlot : public QObject
+	{
+		Q_OBJECT
+
+	public:
+		IntCallbackSlot(const IntCallback& fun, QObject *parent) : QObject(parent), fun_(fun) {}
+
+	public slots:
+		void call(int value) { fun_(value); }
+
+	private:
+		IntCallback fun_;
+	};
+
 	class SFMViewer : public QMainWindow
 	{
 		Q_OBJECT
@@ -36,6 +71,16 @@ namespace sfmviewer {
 		// return the canvas pointer
 		GLCanvas* canvas() { return glCanvas; }
 
+		// add an item {name} to the menu {menu}, which is created in front of the help menu if needed
+		void addMenuAction(const std::string& menu, const std::string& name, const Callback& fun);
+
+		// add a slider labeled {name} from {minimum} to {maximum} to the tool bar, {fun} is called with the new
+		// value whenever it moves
+		QSlider* addSlider(const std::string& name, int minimum, int maximum, int value, const IntCallback& fun);
+
+		// add a panel {name} docked on the right, the returned label shows its text in a fixed-width font
+		QLabel* addPanel(const std::string& name);
+
 	private slots:
 		// show the about dialog
 		void about();
@@ -53,6 +98,13 @@ namespace sfmviewer {
 		// the pointer of the opengl canvas
 		GLCanvas *glCanvas;
 
+		// the help menu and the menus added by the application
+		QMenu *helpMenu;
+		std::map<std::string, QMenu*> menus_;
+
+		// the tool bar of the sliders, created with the first one
+		QToolBar *sliderBar_;
+
 		// the callback function handle for timer events
 		Callback fun_timer_;
 	};
@@ -0,0 +1,25 @@
+/*
+ * assets.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: demo data baked at build time into the layout it is drawn with
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+namespace sfmviewer {
+
+	// the bytes of an asset, written by exes/sfmbake.cpp into a generated source of the library
+	struct BakedAsset {
+		const void* data;   // the elements one after the other, e.g. Vertex for point clouds
+		size_t bytes;
+		size_t count;       // the number of elements
+	};
+
+	// the stanford bunny of bunny.h with y pointing down as in the camera coordinates
+	extern const BakedAsset baked_bunny_structure;
+
+} // namespace sfmviewer
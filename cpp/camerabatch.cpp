@@ -0,0 +1,148 @@
+/*
+ * camerabatch.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the frusta of many pinhole cameras at once
+ */
+
+#include <math.h>
+#include <stdexcept>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "camerabatch.h"
+#include "trackball.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	// the kernels write the five vertices of a camera as 15 consecutive floats
+	typedef char CameraVerticesArePacked[sizeof(CameraVertices) == 15 * sizeof(float) ? 1 : -1];
+
+	/* ************************************************************************* */
+	void CameraBatch::resize(const size_t numCameras) {
+		for (int j=0; j<9; j++) r[j].resize(numCameras);
+		for (int j=0; j<3; j++) t[j].resize(numCameras);
+		fx.resize(numCameras);
+		fy.resize(numCameras);
+		cx.resize(numCameras);
+		cy.resize(numCameras);
+	}
+
+	/* ************************************************************************* */
+	void CameraBatch::set(const size_t k, const float R[3][3], const float center[3], const float fx0,
+			const float fy0, const float cx0, const float cy0) {
+		for (int i=0; i<3; i++) {
+			for (int j=0; j<3; j++)
+				r[3*i+j][k] = R[i][j];
+			t[i][k] = center[i];
+		}
+		fx[k] = fx0; fy[k] = fy0;
+		cx[k] = cx0; cy[k] = cy0;
+	}
+
+	/* ************************************************************************* */
+	void CameraBatch::set(const size_t k, const QuatPose& pose, const float fov, const int img_w, const int img_h) {
+		float R[3][3];
+		build_rotmatrix(R, pose.m_quat);
+		float focal = 0.5f * img_w / tan(fov * M_PI / 360.);
+		set(k, R, pose.m_shift, focal, focal, 0.5f * img_w, 0.5f * img_h);
+	}
+
+	/* ************************************************************************* */
+	// the frusta of the cameras [begin, end) one by one
+	static void calcCameraVerticesScalar(const CameraBatch& b, const float u1, const float v1, const float scale,
+			const size_t begin, const size_t end, CameraVertices* cameras) {
+		for (size_t k=begin; k<end; k++) {
+			// the image corners (0,v1), (u1,v1), (u1,0) and (0,0) in normalized coordinates times the depth
+			const float a0 = -b.cx[k] / b.fx[k] * scale, a1 = (u1 - b.cx[k]) / b.fx[k] * scale;
+			const float b0 = -b.cy[k] / b.fy[k] * scale, b1 = (v1 - b.cy[k]) / b.fy[k] * scale;
+			const float as[4] = {a0, a1, a1, a0}, bs[4] = {b1, b1, b0, b0};
+
+			Vertex* v = cameras[k].v;
+			v[0] = Vertex(b.t[0][k], b.t[1][k], b.t[2][k]);
+			float* out = &v[1].X;
+			for (int c=0; c<4; c++)
+				for (int i=0; i<3; i++)
+					out[3*c+i] = b.r[3*i][k] * as[c] + b.r[3*i+1][k] * bs[c] + (b.r[3*i+2][k] * scale + b.t[i][k]);
+		}
+	}
+
+#ifdef __SSE2__
+	/* ************************************************************************* */
+	// the frusta of four cameras starting at {k}, one camera per lane
+	static inline void calcCameraVerticesSSE(const CameraBatch& b, const __m128 u1, const __m128 v1, const __m128 s,
+			const size_t k, CameraVertices* cameras) {
+		const __m128 fx = _mm_loadu_ps(&b.fx[k]), fy = _mm_loadu_ps(&b.fy[k]);
+		const __m128 cx = _mm_loadu_ps(&b.cx[k]), cy = _mm_loadu_ps(&b.cy[k]);
+		const __m128 sx = _mm_div_ps(s, fx), sy = _mm_div_ps(s, fy);
+		const __m128 a0 = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), cx), sx), a1 = _mm_mul_ps(_mm_sub_ps(u1, cx), sx);
+		const __m128 b0 = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), cy), sy), b1 = _mm_mul_ps(_mm_sub_ps(v1, cy), sy);
+		const __m128 as[4] = {a0, a1, a1, a0}, bs[4] = {b1, b1, b0, b0};
+
+		// rows[m] holds the m-th float of the four cameras
+		__m128 rows[16];
+		for (int i=0; i<3; i++) {
+			const __m128 ri0 = _mm_loadu_ps(&b.r[3*i][k]), ri1 = _mm_loadu_ps(&b.r[3*i+1][k]);
+			const __m128 ti = _mm_loadu_ps(&b.t[i][k]);
+			const __m128 base = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&b.r[3*i+2][k]), s), ti);
+			rows[i] = ti;
+			for (int c=0; c<4; c++)
+				rows[3 + 3*c + i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ri0, as[c]), _mm_mul_ps(ri1, bs[c])), base);
+		}
+		rows[15] = _mm_setzero_ps();
+
+		// transpose to one camera per 15 floats, the last three floats are stored one by one so that
+		// nothing is written past the camera
+		float* out = &cameras[k].v[0].X;
+		for (int m=0; m<12; m+=4) {
+			__m128 r0 = rows[m], r1 = rows[m+1], r2 = rows[m+2], r3 = rows[m+3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(out + m, r0);
+			_mm_storeu_ps(out + 15 + m, r1);
+			_mm_storeu_ps(out + 30 + m, r2);
+			_mm_storeu_ps(out + 45 + m, r3);
+		}
+		float last[3][4];
+		for (int m=0; m<3; m++)
+			_mm_storeu_ps(last[m], rows[12 + m]);
+		for (int j=0; j<4; j++)
+			for (int m=0; m<3; m++)
+				out[15 * j + 12 + m] = last[m][j];
+	}
+#endif
+
+	/* ************************************************************************* */
+	void calcCameraVertices(const CameraBatch& batch, const int img_w, const int img_h, const float scale,
+			vector<CameraVertices>& cameras) {
+		const size_t n = batch.size();
+		for (int j=0; j<9; j++)
+			if (batch.r[j].size() != n || (j < 3 && batch.t[j].size() != n))
+				throw std::runtime_error("calcCameraVertices: inconsistent camera batch");
+		if (batch.fy.size() != n || batch.cx.size() != n || batch.cy.size() != n)
+			throw std::runtime_error("calcCameraVertices: inconsistent camera batch");
+
+		cameras.resize(n);
+		if (n == 0) return;
+		const float u1 = img_w - 1.f, v1 = img_h - 1.f;
+
+		// blocks of 1024 cameras per thread, four at a time within a block
+		const long blockSize = 1024;
+		const long numBlocks = (n + blockSize - 1) / blockSize;
+#pragma omp parallel for schedule(static)
+		for (long blk=0; blk<numBlocks; blk++) {
+			size_t k = blk * blockSize;
+			const size_t end = min(n, (size_t)(blk + 1) * blockSize);
+#ifdef __SSE2__
+			const __m128 u = _mm_set1_ps(u1), v = _mm_set1_ps(v1), s = _mm_set1_ps(scale);
+			for (; k + 4 <= end; k += 4)
+				calcCameraVerticesSSE(batch, u, v, s, k, &cameras[0]);
+#endif
+			calcCameraVerticesScalar(batch, u1, v1, scale, k, end, &cameras[0]);
+		}
+	}
+
+} // namespace sfmviewer
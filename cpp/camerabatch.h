@@ -0,0 +1,41 @@
+/*
+ * camerabatch.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the frusta of many pinhole cameras at once
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "render.h"
+
+namespace sfmviewer {
+
+	// the poses and intrinsics of many cameras, one array per parameter so that neighboring cameras
+	// fill the lanes of a vector register. (R,t) maps camera to world coordinates
+	struct CameraBatch {
+		std::vector<float> r[9];          // the rotations, r[3*i+j][k] is R(i,j) of camera k
+		std::vector<float> t[3];          // the optical centers
+		std::vector<float> fx, fy, cx, cy; // the intrinsics in pixels, without skew
+
+		size_t size() const { return fx.size(); }
+
+		void resize(const size_t numCameras);
+
+		// set camera {k} from a rotation matrix and the optical center
+		void set(const size_t k, const float R[3][3], const float center[3], const float fx0, const float fy0,
+				const float cx0, const float cy0);
+
+		// set camera {k} from a pose and a horizontal field of view {fov} in degrees as in gtsam::Cal3_S2
+		void set(const size_t k, const QuatPose& pose, const float fov, const int img_w, const int img_h);
+	};
+
+	// backproject the four image corners of every camera to the depth {scale}, as calcCameraVertices does camera by
+	// camera. the cameras are processed four at a time with SSE and the groups are spread over the threads
+	void calcCameraVertices(const CameraBatch& batch, const int img_w, const int img_h, const float scale,
+			std::vector<CameraVertices>& cameras);
+
+} // namespace sfmviewer
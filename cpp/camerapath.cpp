@@ -0,0 +1,264 @@
+/*
+ * camerapath.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: scripted paths of the opengl camera
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "camerapath.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	QuatPose OrbitPath::pose(const int segment) const {
+		float angle = -M_PI_2 + (float)segment / segments * M_PI * 2;
+
+		// compute the rotation of the current point on the orbit, refer to quaternions.lyx
+		float theta = -(M_PI_4 + angle / 2);
+		float q1[4] = {0., sin(theta), 0., cos(theta)};
+		float q2[4] = {sin(pitch), 0., 0., cos(pitch)};
+		float q[4];
+		add_quats(q2, q1, q);
+
+		// compute the translation in the new rotated coordinate system
+		float x = cos(angle) * radius + center_x;
+		float z = sin(angle) * radius + center_z;
+
+		return QuatPose(x, height, z, q[0], q[1], q[2], q[3]);
+	}
+
+	/* ************************************************************************* */
+	// the Hamilton product {a} {b} of quaternions (x,y,z,w) as used by build_rotmatrix
+	static void quatMul(const double a[4], const double b[4], double q[4]) {
+		double r[4];
+		r[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+		r[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+		r[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+		r[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+		copy(r, r + 4, q);
+	}
+
+	/* ************************************************************************* */
+	// the logarithm of a unit quaternion, a pure quaternion
+	static void quatLog(const double q[4], double v[4]) {
+		const double s = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+		const double f = s > 1e-12 ? atan2(s, q[3]) / s : 1.;
+		v[0] = f * q[0]; v[1] = f * q[1]; v[2] = f * q[2]; v[3] = 0.;
+	}
+
+	/* ************************************************************************* */
+	static void quatExp(const double v[4], double q[4]) {
+		const double theta = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		const double f = theta > 1e-12 ? sin(theta) / theta : 1.;
+		q[0] = f * v[0]; q[1] = f * v[1]; q[2] = f * v[2]; q[3] = cos(theta);
+	}
+
+	/* ************************************************************************* */
+	// spherical interpolation along the arc from {a} to {b}, which are in the same hemisphere
+	static void slerp(const double a[4], const double b[4], const double t, double q[4]) {
+		const double cosOmega = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+		double wa = 1. - t, wb = t;
+		if (cosOmega < 0.9999) {
+			const double omega = acos(max(-1., cosOmega)), sinOmega = sin(omega);
+			wa = sin((1. - t) * omega) / sinOmega;
+			wb = sin(t * omega) / sinOmega;
+		}
+		double norm = 0.;
+		for (int k=0; k<4; k++) {
+			q[k] = wa * a[k] + wb * b[k];
+			norm += q[k] * q[k];
+		}
+		norm = sqrt(norm);
+		for (int k=0; k<4; k++) q[k] /= norm;
+	}
+
+	/* ************************************************************************* */
+	void KeyframePath::add(const double time, const QuatPose& pose) {
+		vector<Keyframe>::iterator it = keys_.begin();
+		while (it != keys_.end() && it->time <= time) ++it;
+		keys_.insert(it, Keyframe(time, pose));
+		prepared_ = false;
+	}
+
+	/* ************************************************************************* */
+	void KeyframePath::prepare() const {
+		const size_t n = keys_.size();
+		quats_.resize(4 * n);
+		controls_.resize(4 * n);
+		tangents_.resize(3 * n);
+
+		for (size_t i=0; i<n; i++) {
+			const float* q = keys_[i].pose.m_quat;
+			const double norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+			double sign = 1. / norm;
+			if (i > 0) {
+				const double* prev = &quats_[4 * (i-1)];
+				if (prev[0] * q[0] + prev[1] * q[1] + prev[2] * q[2] + prev[3] * q[3] < 0.) sign = -sign;
+			}
+			for (int k=0; k<4; k++) quats_[4*i+k] = sign * q[k];
+		}
+
+		// the neighbors of a keyframe, across the seam of a closed path
+		for (size_t i=0; i<n; i++) {
+			size_t prev = i > 0 ? i - 1 : 0, next = i + 1 < n ? i + 1 : n - 1;
+			double prevTime = keys_[prev].time, nextTime = keys_[next].time;
+			if (closed_ && n > 2 && i == 0) { prev = n - 2; prevTime = keys_[prev].time - duration(); }
+			if (closed_ && n > 2 && i == n - 1) { next = 1; nextTime = keys_[next].time + duration(); }
+
+			// Catmull-Rom velocities
+			const float* p0 = keys_[prev].pose.m_shift;
+			const float* p1 = keys_[next].pose.m_shift;
+			const double dt = nextTime - prevTime;
+			for (int k=0; k<3; k++)
+				tangents_[3*i+k] = dt > 0. ? (p1[k] - p0[k]) / dt : 0.;
+
+			// squad controls s_i = q_i exp(-(log(q_i^-1 q_i-1) + log(q_i^-1 q_i+1)) / 4)
+			const double* q = &quats_[4*i];
+			const double inv[4] = {-q[0], -q[1], -q[2], q[3]};
+			double qPrev[4], qNext[4];
+			copy(&quats_[4*prev], &quats_[4*prev] + 4, qPrev);
+			copy(&quats_[4*next], &quats_[4*next] + 4, qNext);
+			if (q[0] * qPrev[0] + q[1] * qPrev[1] + q[2] * qPrev[2] + q[3] * qPrev[3] < 0.)
+				for (int k=0; k<4; k++) qPrev[k] = -qPrev[k];
+			if (q[0] * qNext[0] + q[1] * qNext[1] + q[2] * qNext[2] + q[3] * qNext[3] < 0.)
+				for (int k=0; k<4; k++) qNext[k] = -qNext[k];
+			double a[4], b[4], la[4], lb[4], e[4];
+			quatMul(inv, qPrev, a);
+			quatMul(inv, qNext, b);
+			quatLog(a, la);
+			quatLog(b, lb);
+			for (int k=0; k<4; k++) e[k] = -0.25 * (la[k] + lb[k]);
+			quatExp(e, a);
+			quatMul(q, a, &controls_[4*i]);
+		}
+		prepared_ = true;
+	}
+
+	/* ************************************************************************* */
+	QuatPose KeyframePath::pose(const double time) const {
+		if (keys_.empty())
+			throw std::runtime_error("KeyframePath::pose: no keyframes");
+		if (!prepared_) prepare();
+		if (keys_.size() == 1 || time <= keys_.front().time) return keys_.front().pose;
+		if (time >= keys_.back().time) return keys_.back().pose;
+
+		// the keyframes i and i+1 around the time
+		size_t i = 0, j = keys_.size() - 1;
+		while (j - i > 1) {
+			const size_t k = (i + j) / 2;
+			(keys_[k].time <= time ? i : j) = k;
+		}
+		const double h = keys_[j].time - keys_[i].time;
+		const double u = h > 0. ? (time - keys_[i].time) / h : 0.;
+
+		double q[4];
+		float shift[3];
+		const float* p0 = keys_[i].pose.m_shift;
+		const float* p1 = keys_[j].pose.m_shift;
+		if (interpolation_ == LINEAR) {
+			slerp(&quats_[4*i], &quats_[4*j], u, q);
+			for (int k=0; k<3; k++) shift[k] = (1. - u) * p0[k] + u * p1[k];
+		} else {
+			double a[4], b[4];
+			slerp(&quats_[4*i], &quats_[4*j], u, a);
+			slerp(&controls_[4*i], &controls_[4*j], u, b);
+			slerp(a, b, 2. * u * (1. - u), q);
+
+			// cubic Hermite with the velocities scaled to the segment
+			const double u2 = u * u, u3 = u2 * u;
+			const double h00 = 2. * u3 - 3. * u2 + 1., h10 = u3 - 2. * u2 + u, h01 = -2. * u3 + 3. * u2, h11 = u3 - u2;
+			for (int k=0; k<3; k++)
+				shift[k] = h00 * p0[k] + h10 * h * tangents_[3*i+k] + h01 * p1[k] + h11 * h * tangents_[3*j+k];
+		}
+		return QuatPose(shift[0], shift[1], shift[2], q[0], q[1], q[2], q[3]);
+	}
+
+	/* ************************************************************************* */
+	void KeyframePath::bake(const double fps, vector<QuatPose>& poses) const {
+		if (fps <= 0.)
+			throw std::runtime_error("KeyframePath::bake: fps must be positive");
+		if (keys_.empty()) { poses.clear(); return; }
+		if (!prepared_) prepare();
+
+		const long numFrames = (long)floor(duration() * fps + 1e-9) + 1;
+		poses.resize(numFrames);
+#pragma omp parallel for schedule(static)
+		for (long f=0; f<numFrames; f++)
+			poses[f] = pose(begin() + f / fps);
+	}
+
+	/* ************************************************************************* */
+	KeyframePath orbitKeyframes(const OrbitPath& orbit, const double period, const int numKeys) {
+		KeyframePath path(KeyframePath::SMOOTH, true);
+		for (int k=0; k<=numKeys; k++)
+			path.add(period * k / numKeys, orbit.pose((int)((long)orbit.segments * k / numKeys)));
+		return path;
+	}
+
+	/* ************************************************************************* */
+	PathPlayer::PathPlayer(const KeyframePath* path, const double fps, const bool loop)
+	: path_(path), fps_(fps), loop_(loop), running_(false), offset_(0.), lastFrame_(-1), skipped_(0) {
+		if (!path_ || fps_ <= 0.)
+			throw std::runtime_error("PathPlayer: needs a path and a positive frame rate");
+	}
+
+	/* ************************************************************************* */
+	void PathPlayer::start(const double from) {
+		if (from < 0.)
+			throw std::runtime_error("PathPlayer::start: can not start before the first keyframe");
+		offset_ = from;
+		lastFrame_ = -1;
+		skipped_ = 0;
+		clock_.start();
+		running_ = true;
+	}
+
+	/* ************************************************************************* */
+	void PathPlayer::pause() {
+		if (!running_) return;
+		offset_ += clock_.nsecsElapsed() * 1e-9;
+		running_ = false;
+	}
+
+	/* ************************************************************************* */
+	void PathPlayer::resume() {
+		if (running_) return;
+		clock_.start();
+		running_ = true;
+	}
+
+	/* ************************************************************************* */
+	// the time since the first keyframe, not wrapped around
+	static double unwrappedTime(const QElapsedTimer& clock, const bool running, const double offset) {
+		return offset + (running && clock.isValid() ? clock.nsecsElapsed() * 1e-9 : 0.);
+	}
+
+	/* ************************************************************************* */
+	double PathPlayer::time() const {
+		double t = unwrappedTime(clock_, running_, offset_);
+		const double duration = path_->duration();
+		if (loop_ && duration > 0.) t = fmod(t, duration);
+		return path_->begin() + t;
+	}
+
+	/* ************************************************************************* */
+	QuatPose PathPlayer::pose() {
+		// the frames are counted on the unwrapped time, so the skipped ones are found across the loops
+		const long frame = (long)floor(unwrappedTime(clock_, running_, offset_) * fps_ + 1e-9);
+		if (lastFrame_ >= 0 && frame > lastFrame_ + 1)
+			skipped_ += frame - lastFrame_ - 1;
+		lastFrame_ = max(lastFrame_, frame);
+
+		double t = frame / fps_;
+		const double duration = path_->duration();
+		if (loop_ && duration > 0.) t = fmod(t, duration);
+		return path_->pose(path_->begin() + t);
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,124 @@
+/*
+ * camerapath.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: scripted paths of the opengl camera
+ */
+
+#pragma once
+
+#include <math.h>
+#include <vector>
+#include <QElapsedTimer>
+
+#include "trackball.h"
+
+namespace sfmviewer {
+
+	// a circular orbit around a vertical axis, looking slightly down at the center
+	struct OrbitPath {
+		float center_x;    // the center of the orbit
+		float center_z;    // the center of the orbit
+		float radius;      // the radius of the camera's orbit circle
+		float height;      // the height of the orbit
+		float pitch;       // the tilt of the camera towards the ground
+		int segments;      // how many steps to traverse the orbit
+
+		OrbitPath(float center_x0 = 0., float center_z0 = 200., float radius0 = 300., float height0 = -200.,
+				int segments0 = 720, float pitch0 = -M_PI_4 * 0.4) :
+			center_x(center_x0), center_z(center_z0), radius(radius0), height(height0), pitch(pitch0), segments(segments0) {}
+
+		// the camera pose at the given step on the orbit
+		QuatPose pose(const int segment) const;
+	};
+
+	// a camera pose at a time in seconds
+	struct Keyframe {
+		double time;
+		QuatPose pose;
+		Keyframe(const double time0, const QuatPose& pose0) : time(time0), pose(pose0) {}
+	};
+
+	// a camera animation through keyframes that can be evaluated at any time. the positions follow a Catmull-Rom
+	// spline and the rotations squad, or both are interpolated linearly with slerp for the rotations
+	class KeyframePath {
+	public:
+		enum Interpolation { LINEAR, SMOOTH };
+
+		// a {closed} path repeats the first keyframe at the end and is smooth across the seam when looped
+		KeyframePath(const Interpolation interpolation = SMOOTH, const bool closed = false)
+		: interpolation_(interpolation), closed_(closed), prepared_(false) {}
+
+		// insert a keyframe, keyframes at the same time keep their order
+		void add(const double time, const QuatPose& pose);
+
+		size_t size() const { return keys_.size(); }
+		const Keyframe& operator[](const size_t i) const { return keys_[i]; }
+		bool closed() const { return closed_; }
+
+		// the times of the first and last keyframes
+		double begin() const { return keys_.empty() ? 0. : keys_.front().time; }
+		double end() const { return keys_.empty() ? 0. : keys_.back().time; }
+		double duration() const { return end() - begin(); }
+
+		// the pose at {time}, clamped to the keyframes
+		QuatPose pose(const double time) const;
+
+		// the poses at {fps} frames per second from the first to the last keyframe, e.g. to export a video
+		void bake(const double fps, std::vector<QuatPose>& poses) const;
+
+	private:
+		// align the signs of the quaternions and compute the squad controls and the spline tangents
+		void prepare() const;
+
+		Interpolation interpolation_;
+		bool closed_;
+		std::vector<Keyframe> keys_;
+
+		// derived from the keyframes by prepare
+		mutable bool prepared_;
+		mutable std::vector<double> quats_;     // 4 per keyframe, neighbors in the same hemisphere
+		mutable std::vector<double> controls_;  // the squad control quaternions, 4 per keyframe
+		mutable std::vector<double> tangents_;  // the velocities of the positions, 3 per keyframe
+	};
+
+	// {numKeys} + 1 keyframes around {orbit}, one round in {period} seconds, as a closed path
+	KeyframePath orbitKeyframes(const OrbitPath& orbit, const double period, const int numKeys = 24);
+
+	// plays a path in real time. the pose is the one of the last frame boundary before the time of a monotonic
+	// clock, so the frames are the same as in KeyframePath::bake and a slow frame skips frames instead of slowing
+	// the animation down
+	class PathPlayer {
+	public:
+		PathPlayer(const KeyframePath* path, const double fps = 60., const bool loop = true);
+
+		// start the clock {from} seconds after the first keyframe of the path
+		void start(const double from = 0.);
+
+		void pause();
+		void resume();
+		bool running() const { return running_; }
+		double fps() const { return fps_; }
+
+		// the time on the path, wrapped around if looping
+		double time() const;
+
+		// the pose of the current frame
+		QuatPose pose();
+
+		// the frames skipped by pose() since start() because the caller could not keep up
+		size_t skipped() const { return skipped_; }
+
+	private:
+		const KeyframePath* path_;
+		double fps_;
+		bool loop_;
+		bool running_;
+		QElapsedTimer clock_;
+		double offset_;       // the path time when the clock was started
+		long lastFrame_;
+		size_t skipped_;
+	};
+
+} // namespace sfmviewer
@@ -0,0 +1,73 @@
+/*
+ * channel.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: passing scene updates from a producer thread to the gui thread without locks
+ */
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <QAtomicInt>
+
+#include "render.h"
+#include "trackball.h"
+
+namespace sfmviewer {
+
+	// the latest value of T from one producer thread to one consumer thread. there are three slots, the one the
+	// producer fills, the one the consumer reads and the last published one in the middle. publishing and
+	// acquiring exchange a slot with the middle one atomically, so neither side waits for the other and the
+	// consumer always gets a complete value. values published faster than they are acquired are dropped
+	template <class T>
+	class TripleBuffer {
+	public:
+		TripleBuffer() : middle_(1), back_(2), front_(0), published_(0) {
+			serials_[0] = serials_[1] = serials_[2] = 0;
+		}
+
+		// producer: the slot to fill, it still holds an older value whose memory can be reused
+		T& back() { return slots_[back_]; }
+
+		// producer: hand back() over to the consumer
+		void publish() {
+			serials_[back_] = ++published_;
+			back_ = middle_.fetchAndStoreOrdered(back_ | FRESH) & INDEX;
+		}
+
+		// consumer: move to the last published value, false if nothing was published since the last call
+		bool acquire() {
+			if (!((int)middle_ & FRESH)) return false;
+			front_ = middle_.fetchAndStoreOrdered(front_) & INDEX;
+			return true;
+		}
+
+		// consumer: the value of the last acquire, it may be modified until the next acquire
+		T& front() { return slots_[front_]; }
+
+		// consumer: the number of publish calls up to the value of front(), 0 before the first one
+		uint64_t serial() const { return serials_[front_]; }
+
+	private:
+		enum { INDEX = 3, FRESH = 4 };  // the middle slot and whether the consumer has not seen it yet
+
+		T slots_[3];
+		uint64_t serials_[3];
+		QAtomicInt middle_;
+		int back_;          // owned by the producer
+		int front_;         // owned by the consumer
+		uint64_t published_;
+	};
+
+	// the points and camera poses an optimizer publishes, see LiveLayer
+	struct SceneSnapshot {
+		std::vector<Vertex> structure;
+		std::vector<SFMColor> pointColors;  // empty or one per point
+		std::vector<QuatPose> poses;
+	};
+
+	typedef TripleBuffer<SceneSnapshot> SceneChannel;
+
+} // namespace sfmviewer
@@ -0,0 +1,72 @@
+/*
+ * covisibility.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the covisibility graph of the cameras, i.e. how many points every pair of cameras shares
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "covisibility.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	void covisibilityGraph(const vector<vector<int> >& tracks, const size_t numCameras,
+			vector<CovisibilityEdge>& edges) {
+		// the points of every camera in compressed rows, the transpose of the tracks
+		vector<uint32_t> offsets(numCameras + 1, 0), points;
+		for (size_t p=0; p<tracks.size(); p++)
+			for (size_t k=0; k<tracks[p].size(); k++) {
+				if (tracks[p][k] < 0 || (size_t)tracks[p][k] >= numCameras)
+					throw std::runtime_error("covisibilityGraph: camera index out of range");
+				offsets[tracks[p][k] + 1]++;
+			}
+		for (size_t c=0; c<numCameras; c++)
+			offsets[c + 1] += offsets[c];
+		points.resize(offsets[numCameras]);
+		vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t p=0; p<tracks.size(); p++)
+			for (size_t k=0; k<tracks[p].size(); k++)
+				points[fill[tracks[p][k]]++] = p;
+
+		// row a of the product counts the cameras b > a along the tracks of the points of a
+		vector<vector<CovisibilityEdge> > rows(numCameras);
+#pragma omp parallel
+		{
+			vector<uint32_t> counts(numCameras, 0), touched;
+#pragma omp for schedule(dynamic, 16)
+			for (long a=0; a<(long)numCameras; a++) {
+				touched.clear();
+				for (uint32_t i=offsets[a]; i<offsets[a + 1]; i++) {
+					const vector<int>& track = tracks[points[i]];
+					for (size_t k=0; k<track.size(); k++) {
+						const int b = track[k];
+						if (b <= a) continue;
+						if (counts[b]++ == 0) touched.push_back(b);
+					}
+				}
+				sort(touched.begin(), touched.end());
+				rows[a].resize(touched.size());
+				for (size_t j=0; j<touched.size(); j++) {
+					CovisibilityEdge edge = {(uint32_t)a, touched[j], counts[touched[j]]};
+					rows[a][j] = edge;
+					counts[touched[j]] = 0;
+				}
+			}
+		}
+
+		size_t numEdges = 0;
+		for (size_t a=0; a<numCameras; a++)
+			numEdges += rows[a].size();
+		edges.clear();
+		edges.reserve(numEdges);
+		for (size_t a=0; a<numCameras; a++)
+			edges.insert(edges.end(), rows[a].begin(), rows[a].end());
+	}
+
+} // namespace sfmviewer
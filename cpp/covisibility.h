@@ -0,0 +1,29 @@
+/*
+ * covisibility.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the covisibility graph of the cameras, i.e. how many points every pair of cameras shares
+ */
+
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sfmviewer {
+
+	// two cameras a < b that see {shared} points in common
+	struct CovisibilityEdge {
+		uint32_t a, b;
+		uint32_t shared;
+	};
+
+	// the edges between the {numCameras} cameras that share at least one point, from the {tracks} that list the
+	// cameras seeing every point. this is the sparse product of the point-camera incidence matrix with its
+	// transpose, computed camera by camera with one dense counter per thread. the edges are ordered by a, then b
+	void covisibilityGraph(const std::vector<std::vector<int> >& tracks, const size_t numCameras,
+			std::vector<CovisibilityEdge>& edges);
+
+} // namespace sfmviewer
@@ -0,0 +1,85 @@
+/*
+ * bench.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: statistics and process information shared by the benchmark executables
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+namespace sfmviewer {
+
+	// summary of repeated measurements
+	struct SampleStats {
+		double mean, stddev, min, p50, p90, p95, p99, max;
+	};
+
+	// the nearest-rank percentile of sorted samples, 0 < p <= 100
+	inline double percentile(const std::vector<double>& sorted, const double p) {
+		size_t rank = (size_t)ceil(p / 100. * sorted.size());
+		return sorted[std::min(sorted.size(), std::max(rank, (size_t)1)) - 1];
+	}
+
+	// compute mean, standard deviation and nearest-rank percentiles
+	inline SampleStats computeStats(std::vector<double> samples) {
+		SampleStats stats = {0., 0., 0., 0., 0., 0., 0., 0.};
+		if (samples.empty()) return stats;
+
+		std::sort(samples.begin(), samples.end());
+		double sum = 0., sum2 = 0.;
+		for (size_t i=0; i<samples.size(); i++) {
+			sum += samples[i];
+			sum2 += samples[i] * samples[i];
+		}
+		size_t n = samples.size();
+		stats.mean = sum / n;
+		stats.stddev = n > 1 ? sqrt(std::max(0., (sum2 - sum * stats.mean) / (n - 1))) : 0.;
+		stats.min = samples.front();
+		stats.max = samples.back();
+		stats.p50 = percentile(samples, 50.);
+		stats.p90 = percentile(samples, 90.);
+		stats.p95 = percentile(samples, 95.);
+		stats.p99 = percentile(samples, 99.);
+		return stats;
+	}
+
+	// write the statistics as a json object
+	inline std::string toJson(const SampleStats& stats) {
+		std::stringstream ss;
+		ss << "{\"mean\":" << stats.mean << ",\"stddev\":" << stats.stddev << ",\"min\":" << stats.min
+			 << ",\"p50\":" << stats.p50 << ",\"p90\":" << stats.p90 << ",\"p95\":" << stats.p95
+			 << ",\"p99\":" << stats.p99 << ",\"max\":" << stats.max << "}";
+		return ss.str();
+	}
+
+	// the peak resident set size of this process so far in KB
+	inline long peakRSSKB() {
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1024; // bytes on mac os
+#else
+		return usage.ru_maxrss;
+#endif
+	}
+
+	// parse a comma separated list such as "1000,10000,1e5"
+	inline std::vector<size_t> parseSizes(const std::string& list) {
+		std::vector<size_t> sizes;
+		std::stringstream ss(list);
+		std::string item;
+		while (std::getline(ss, item, ','))
+			if (!item.empty()) sizes.push_back((size_t)atof(item.c_str()));
+		return sizes;
+	}
+
+} // namespace sfmviewer
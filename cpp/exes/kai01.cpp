@@ -6,9 +6,12 @@
  *  Description: the most simple viewer
  */
 #include <fstream>
+#include <QFileDialog>
 #include <gtsam/geometry/SimpleCamera.h>
 
 #include "render-inl.h"
+#include "sceneio.h"
+#include "pointfilter.h"
 #include "main.h"
 
 using namespace std;
@@ -21,8 +24,37 @@ static string filename = "/Users/nikai/borg/sfmviewer/data/StPeter.txt";
 static vector<Vertex> structure;             // 3d points
 static vector<SFMColor> pointColors;      // the colors of 3d points
 static vector<CameraVertices> cameras;       // 3d cameras
+static Picker picker;                        // finds the clicked points and cameras
+static Selection selected;                   // the points selected with the rubber band
+static Selection hidden;                     // the points hidden by the user
+static float voxelSize = 0.f;                // average the points in cubes of this size, 0 keeps all
+static PointMapping sourcePoints;            // the points in the file behind every point in structure
+static float outlierSigma = 0.f;             // drop points this many standard deviations out, 0 keeps all
+static int outlierNeighbors = 8;             // the neighbors to measure the outliers with
+static uint64_t pointsGeneration = 1;        // the generation of structure in the draw cache, see dropOutliers
+
+// read the command line options
+void parseArguments() {
+	QStringList args = app->arguments();
+	for (int i=1; i<args.size(); i++) {
+		if (args[i] == "--voxel" && i + 1 < args.size())
+			voxelSize = args[++i].toFloat();
+		else if (args[i] == "--outliers" && i + 1 < args.size())
+			outlierSigma = args[++i].toFloat();
+		else if (args[i] == "--neighbors" && i + 1 < args.size())
+			outlierNeighbors = args[++i].toInt();
+		else if (!args[i].startsWith("--"))
+			filename = args[i].toStdString();
+		else
+			cerr << "usage: kai01 [--voxel size] [--outliers sigma] [--neighbors k] [file]" << endl;
+	}
+}
 
 void load3d() {
+	// with a voxel size the points are downsampled in chunks while reading
+	const size_t chunkSize = 1 << 20;
+	VoxelGrid* grid = voxelSize > 0.f ? new VoxelGrid(voxelSize) : NULL;
+
 	// load the files
 	ifstream is(filename.c_str());
 	string tag;
@@ -36,6 +68,11 @@ void load3d() {
 			is >> x >> y >> z >> r >> g >> b;
 			structure.push_back(Vertex(x,y,z));
 			pointColors.push_back(SFMColor(r, g, b, 1.0));
+			if (grid && structure.size() == chunkSize) {
+				grid->add(&structure[0], &pointColors[0], structure.size());
+				structure.clear();
+				pointColors.clear();
+			}
 		}
 
 		// load 3D camera
@@ -56,13 +93,104 @@ void load3d() {
 	}
 
 	is.close();
+
+	if (grid) {
+		if (!structure.empty())
+			grid->add(&structure[0], &pointColors[0], structure.size());
+		grid->finish(structure, pointColors, &sourcePoints);
+		cout << "downsampled " << grid->numSources() << " points with voxel size " << voxelSize << endl;
+		delete grid;
+	}
+
 	cout << "loaded " << structure.size() << " points and " << cameras.size() << " cameras" << endl;
 	cout.flush();
 }
 
+// drop the floaters that are far from their neighbors, the indices of the remaining points go to {kept}
+void dropOutliers(vector<uint32_t>& kept) {
+	size_t numPoints = structure.size();
+	removeOutliers(structure, pointColors, outlierNeighbors, outlierSigma > 0.f ? outlierSigma : 3.f, &kept);
+	if (sourcePoints.size()) sourcePoints.keepRows(kept);
+	pointsGeneration++;
+	cout << "removed " << numPoints - structure.size() << " outliers" << endl;
+}
+
+// drop the floaters on demand, the picker is rebuilt and the selections follow the remaining points
+void dropOutliersNow() {
+	vector<uint32_t> kept;
+	dropOutliers(kept);
+	picker.setStructure(structure);
+	selected.keepRows(kept);
+	hidden.keepRows(kept);
+	canvas->updateGL();
+}
+
+// tell which points of the file were averaged into a picked point
+void printSources(const PickResult& result) {
+	if (result.type != PickResult::POINT || sourcePoints.size() == 0) return;
+	cout << "point " << result.index << " averages " << sourcePoints.numSources(result.index)
+			<< " points of the file, starting at point " << sourcePoints.sources[sourcePoints.offsets[result.index]] << endl;
+}
+
+// print the number of selected points
+void countSelection() {
+	cout << selected.count() << " points selected" << endl;
+}
+
+// hide the selected points
+void hideSelection() {
+	hidden.merge(selected);
+	selected.clear();
+	canvas->updateGL();
+}
+
+// bring back the hidden points
+void showAll() {
+	hidden.clear();
+	canvas->updateGL();
+}
+
+// unselect all the points
+void clearSelection() {
+	selected.clear();
+	canvas->updateGL();
+}
+
+// save the selected points to a scene file
+void exportSelection() {
+	QString name = QFileDialog::getSaveFileName(window, "Export selection");
+	if (name.isEmpty()) return;
+
+	SceneData data;
+	selected.extract(structure, data.structure);
+	selected.extract(pointColors, data.pointColors);
+	saveSceneData(name.toStdString(), data);
+	cout << "saved " << data.structure.size() << " points to " << name.toStdString() << endl;
+}
+
 void sfmviewer::setup()
 {
+	parseArguments();
 	load3d();
+	vector<uint32_t> kept;
+	if (outlierSigma > 0.f) dropOutliers(kept);
+
+	// click on points and cameras to see their indices
+	picker.setStructure(structure);
+	picker.setCameras(cameras);
+	canvas->setPicker(&picker);
+	canvas->setPickFunc(printSources);
+
+	// shift + drag to select points, shift + control + drag for a lasso, alt to unselect
+	selected.resize(structure.size());
+	hidden.resize(structure.size());
+	canvas->setSelection(structure, selected);
+	window->addMenuAction("Selection", "Count", countSelection);
+	window->addMenuAction("Selection", "Hide", hideSelection);
+	window->addMenuAction("Selection", "Show all", showAll);
+	window->addMenuAction("Selection", "Clear", clearSelection);
+	window->addMenuAction("Selection", "Export...", exportSelection);
+	window->addMenuAction("Filter", "Remove outliers", dropOutliersNow);
 
 	// set the default camera pose for St. Peter
 	canvas->setGLPose(QuatPose(119., -257., -100., -0.341, -0.223, -0.081, 0.909));
@@ -73,7 +201,7 @@ void sfmviewer::setup()
 }
 
 void sfmviewer::draw() {
-	drawStructure(structure, pointColors);
-	drawCameras(cameras);
+	drawStructure(structure, pointColors, selected, &hidden, default_selection_color, pointsGeneration);
+	drawCameras(cameras, vector<SFMColor>(), true, 1);
 //	drawCameraCircle();
 }
@@ -6,14 +6,24 @@
  *  Description: the viewer for the visibility
  */
 
+#include <float.h>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <boost/foreach.hpp>
 #include <QDir>
+#include <QLabel>
+#include <QSlider>
 #include <gtsam/geometry/SimpleCamera.h>
 
 #include "main.h"
 #include "trackball.h"
 #include "render-inl.h"
+#include "camerapath.h"
+#include "visibilityset.h"
+#include "timeline.h"
+#include "reprojection.h"
+#include "trackstats.h"
 
 using namespace std;
 using namespace gtsam;
@@ -22,6 +32,7 @@ using namespace sfmviewer;
 #define LINESIZE 81920
 static const string filename = "/Users/nikai/borg/sfmviewer/data/StPeter.txt";
 static const string visibility_filename = "/Users/nikai/borg/sfmviewer/data/StPeter_visibility.txt";
+static const string observation_filename = "/Users/nikai/borg/sfmviewer/data/StPeter_observations.txt";
 static const float slow_motion = 2.2;
 
 /**
@@ -30,28 +41,81 @@ static const float slow_motion = 2.2;
 static vector<Vertex> structure;             // 3d points
 static vector<SFMColor> pointColors;         // the colors of 3d points
 static vector<CameraVertices> cameras;       // 3d cameras
+static vector<QuatPose> poses;               // the poses of the cameras
 static vector<SFMColor> cameraColors;        // the colors of 3d cameras
 static map<int, vector<int> > visibileFeatures; // the indices of visible features
 static map<int, vector<int> > neighborCameras;  // the indices of neighbor cameras
 static const SFMColor camera_color(0., 1., 0., 1.);
 
+/**
+ * the reprojection errors of the 2d observations, the points are colored by them if they are loaded
+ */
+enum ErrorColoring { NO_ERRORS, MEAN_ERRORS, MAX_ERRORS };
+static vector<SFMColor> loadedColors;        // the colors of the file, pointColors are either these or the errors
+static ReprojectionErrors reprojection;
+static ErrorColoring errorColoring = NO_ERRORS;
+static float maxColoredError = 10.f;         // the error in pixels at the red end of the color map
+
+/**
+ * the covisibility graph of all the cameras
+ */
+static vector<Vertex> cameraCenters;
+static vector<CovisibilityEdge> covisibility;
+static boost::shared_ptr<CovisibilityLayer> covisibilityLayer;
+
+/**
+ * the points of every camera as bitsets, the cameras are colored by their overlap with the current one
+ */
+static VisibilitySets visibilitySets;
+static vector<uint32_t> overlapCounts;  // the overlaps of the current camera
+static size_t overlapCamera = 0;        // the camera overlapCounts belongs to
+static uint32_t minOverlap = 0;         // 0 shows the neighbor cameras from the visibility file instead
+
 /**
  * camera motions
  */
-static float orbit_center_x = 0.;     // the center of the orbit
-static float orbit_center_z = 200.;   // the center of the orbit
-static float orbit_radius = 300.0;    // the radius of the camera's orbit circle
-static float orbit_height = -200.0;   // the height of the orbit
-static int orbit_segments = 720;      // how many steps to traverse the orbit
-static int orbit_step = 250;          // the current step in the orbit
+static const OrbitPath orbit(0., 200., 300., -200., 720); // the orbit around St. Peter
+static const double orbit_period = orbit.segments * slow_motion * 0.06;  // seconds per round
+static const KeyframePath orbit_path = orbitKeyframes(orbit, orbit_period);
+static PathPlayer orbit_player(&orbit_path);  // plays the orbit against the clock
 
 /**
  * information about the current frame
  */
-static size_t step = 0;
+static size_t step = 0;                   // the timeline step to play next
 static size_t step_size = 1;
+static size_t shownStep = 0;              // the timeline step the colors and thumbnails show
 static vector<SFMColor> pointColorsNow;
 static vector<SFMColor> cameraColorsNow;
+static const SFMColor visible_point_color(1.0, 0.55, 0.15, 1.0);
+static boost::shared_ptr<PointLayer> pointLayer;    // the points in pointColorsNow
+static boost::shared_ptr<CameraLayer> cameraLayer;  // the cameras in cameraColorsNow
+
+/**
+ * the timeline of the frames with visibility information, seeking applies the points and the neighbor cameras
+ * entering and leaving between the steps
+ */
+static vector<int> timelineCameras;         // the camera of every step
+static HighlightTimeline visibleTimeline;   // the visible points of every step
+static HighlightTimeline neighborTimeline;  // the neighbor cameras of every step
+static QSlider* timelineSlider = NULL;
+
+/**
+ * the statistics of the frames played up to the shown step, updated frame by frame as the timeline moves
+ */
+static TrackStatistics statistics;
+static QLabel* statisticsPanel = NULL;
+static size_t statisticsStep = 0;  // the step of the statistics, left behind while the replay plays
+
+/**
+ * the replay of the reconstruction as it grows: every point and camera knows the steps it is seen in, so that the
+ * gpu decides what to show and a step only sets a uniform
+ */
+static vector<Lifetime> pointLifetimes;
+static vector<Lifetime> cameraLifetimes;
+static vector<SFMColor> replayCameraColors;
+static boost::shared_ptr<LifetimeLayer> lifetimeLayer;
+static bool replay = false;  // whether the replay is shown instead of the visibility colors
 
 /**
  * thumbnails
@@ -89,6 +153,9 @@ void load3D() {
 			Pose3 pose(Rot3(r11, r12, r13, r21, r22, r23, r31, r32, r33), Point3(x, y, z));
 			SimpleCamera camera(Cal3_S2(120., 1600, 1600), pose);
 			cameras.push_back(calcCameraVertices<SimpleCamera, Point2, Point3>(camera, 1600, 1600, 7.0));
+			float m[4][4] = {{r11, r12, r13, 0.}, {r21, r22, r23, 0.}, {r31, r32, r33, 0.}, {0., 0., 0., 1.}};
+			poses.push_back(QuatPose(x, y, z, 0., 0., 0., 1.));
+			rotation_to_quaternion(m, poses.back().m_quat);
 			cameraColors.push_back(SFMColor(camera_color.r, camera_color.g, camera_color.b, 0.2));
 		}
 
@@ -141,89 +208,304 @@ void loadVisibility() {
 }
 
 /* ************************************************************************* */
-// show the visibility of the next frame
-void nextVisibility() {
-	// change camera colors
-	cameraColorsNow = cameraColors;
-	if (step >=0 && step < neighborCameras.size()) {
-		cameraColorsNow[step] = SFMColor(1.0, 0.0, 0.0, 1.0);
-		BOOST_FOREACH(const int& i, neighborCameras.find(step)->second)
-			cameraColorsNow[i].alpha = 1.0;
+// the shared points of every pair of cameras from the points they see
+void computeCovisibility() {
+	vector<vector<int> > tracks(structure.size());
+	for (map<int, vector<int> >::const_iterator it = visibileFeatures.begin(); it != visibileFeatures.end(); ++it)
+		BOOST_FOREACH(const int& i, it->second)
+			if (i >= 0 && i < (int)tracks.size() && it->first < (int)cameras.size())
+				tracks[i].push_back(it->first);
+	covisibilityGraph(tracks, cameras.size(), covisibility);
+
+	cameraCenters.resize(cameras.size());
+	for (size_t i=0; i<cameras.size(); i++)
+		cameraCenters[i] = cameras[i].v[0];
+	cout << "computed " << covisibility.size() << " covisibility edges" << endl;
+}
+
+/* ************************************************************************* */
+void setCovisibilityThreshold(int minShared) {
+	covisibilityLayer->setThreshold(minShared);
+	canvas->updateGL();
+}
+
+/* ************************************************************************* */
+// the points every camera sees as bitsets
+void computeVisibilitySets() {
+	vector<vector<int> > cameraPoints(cameras.size());
+	for (map<int, vector<int> >::const_iterator it = visibileFeatures.begin(); it != visibileFeatures.end(); ++it)
+		if (it->first >= 0 && it->first < (int)cameras.size())
+			BOOST_FOREACH(const int& i, it->second)
+				if (i >= 0 && i < (int)structure.size())
+					cameraPoints[it->first].push_back(i);
+	visibilitySets = VisibilitySets(cameraPoints, structure.size());
+}
+
+/* ************************************************************************* */
+// the reprojection errors of the observations next to the visibility file, if there are any
+void computeReprojectionErrors() {
+	vector<Observation> observations;
+	if (!loadObservations(observation_filename, observations)) return;
+	vector<Observation> inside;
+	BOOST_FOREACH(const Observation& o, observations)
+		if (o.point < structure.size() && o.camera < poses.size())
+			inside.push_back(o);
+	reprojection = ReprojectionErrors(inside, structure.size(), poses.size(), 120., 1600, 1600);
+	reprojection.compute(poses, structure);
+	cout << "loaded " << inside.size() << " observations, rms reprojection error " << reprojection.rms() << endl;
+}
+
+/* ************************************************************************* */
+// the colors of the points without the visibility of the shown step
+void colorPoints() {
+	if (errorColoring == NO_ERRORS || reprojection.numObservations() == 0)
+		pointColors = loadedColors;
+	else
+		errorColors(errorColoring == MEAN_ERRORS ? reprojection.meanErrors() : reprojection.maxErrors(),
+				maxColoredError, loadedColors[0], pointColors);
+}
+
+/* ************************************************************************* */
+// the timelines of the visible points and the neighbor cameras of the frames, in the order of the frames
+void computeTimelines() {
+	vector<vector<int> > points, neighbors;
+	for (map<int, vector<int> >::const_iterator it = visibileFeatures.begin(); it != visibileFeatures.end(); ++it) {
+		if (it->first < 0 || it->first >= (int)cameras.size() || it->first >= (int)thumbnailNames.size()) continue;
+		timelineCameras.push_back(it->first);
+		points.push_back(vector<int>());
+		BOOST_FOREACH(const int& i, it->second)
+			if (i >= 0 && i < (int)structure.size())
+				points.back().push_back(i);
+		neighbors.push_back(vector<int>());
+		map<int, vector<int> >::const_iterator nns = neighborCameras.find(it->first);
+		if (nns != neighborCameras.end())
+			BOOST_FOREACH(const int& i, nns->second)
+				if (i >= 0 && i < (int)cameras.size())
+					neighbors.back().push_back(i);
 	}
+	visibleTimeline = HighlightTimeline(points, structure.size());
+	neighborTimeline = HighlightTimeline(neighbors, cameras.size());
+}
 
-	// change point colors
-	pointColorsNow = pointColors;
-	if (step >=0 && step < visibileFeatures.size()) {
-		BOOST_FOREACH(const int& i, visibileFeatures.find(step)->second) {
-			pointColorsNow[i].r     = 1.0;
-			pointColorsNow[i].g     = 0.55;
-			pointColorsNow[i].b     = 0.15;
-			pointColorsNow[i].alpha = 1.0;
+/* ************************************************************************* */
+// the color of camera {i} among the neighbors of the shown step
+void colorNeighbor(const int i) {
+	cameraColorsNow[i] = cameraColors[i];
+	if (neighborTimeline.highlighted(i)) cameraColorsNow[i].alpha = 1.0;
+}
+
+/* ************************************************************************* */
+// the colors of all the cameras around the camera of the shown step, only the cameras whose color changed are
+// uploaded
+void colorCameras() {
+	const size_t camera = timelineCameras[shownStep];
+	vector<SFMColor> colors = cameraColors;
+	if (minOverlap > 0) {
+		if (overlapCamera != camera || overlapCounts.empty()) {
+			visibilitySets.overlaps(camera, overlapCounts);
+			overlapCamera = camera;
 		}
+		overlapColors(overlapCounts, camera, minOverlap, camera_color, colors);
+	} else {
+		for (const int* i=neighborTimeline.begin(shownStep); i!=neighborTimeline.end(shownStep); i++)
+			colors[*i].alpha = 1.0;
+		colors[camera] = SFMColor(1.0, 0.0, 0.0, 1.0);
 	}
 
-	// load thumbnails
+	if (colors.size() != cameraColorsNow.size()) {
+		cameraColorsNow.swap(colors);
+		cameraLayer->touch();
+		return;
+	}
+	vector<int> changed;
+	for (size_t i=0; i<colors.size(); i++)
+		if (colors[i].r != cameraColorsNow[i].r || colors[i].g != cameraColorsNow[i].g ||
+				colors[i].b != cameraColorsNow[i].b || colors[i].alpha != cameraColorsNow[i].alpha)
+			changed.push_back(i);
+	cameraColorsNow.swap(colors);
+	cameraLayer->colorsChanged(changed);
+}
+
+/* ************************************************************************* */
+void setOverlapThreshold(int minShared) {
+	minOverlap = minShared;
+	colorCameras();
+	canvas->updateGL();
+}
+
+/* ************************************************************************* */
+// the thumbnails of the camera of the shown step and its first neighbors
+void loadThumbnails() {
 	if (queryTexID!=0) glDeleteTextures(1, &queryTexID);
 	BOOST_FOREACH(const GLuint& id, nnTexIDs)
 		glDeleteTextures(1, &id);
 	nnTexIDs.clear();
 
-	QImage image(QString::fromStdString(thumbnailNames[step]));
+	const int camera = timelineCameras[shownStep];
+	QImage image(QString::fromStdString(thumbnailNames[camera]));
 	if (image.width() != 128 || image.height() != 128) image = image.scaled(QSize(128, 128));
 	queryTexID = loadThumbnailTexture(image);
 
-	if (step >=0 && step < neighborCameras.size()) {
-		vector<int> nns = neighborCameras.find(step)->second;
+	map<int, vector<int> >::const_iterator it = neighborCameras.find(camera);
+	if (it != neighborCameras.end()) {
+		const vector<int>& nns = it->second;
 		size_t numNN = nns.size() > 4 ? 4 : nns.size();
 		for (size_t i=0; i<numNN; i++) {
 			QImage image(QString::fromStdString(thumbnailNames[nns[i]]));
 			nnTexIDs.push_back(loadThumbnailTexture(image));
 		}
 	}
+}
 
-	// update opengla canvas
+/* ************************************************************************* */
+// the frames up to timeline step {k} in the statistics, starting with those up to statisticsStep
+void updateStatistics(const size_t k) {
+	for (size_t i=statisticsStep+1; i<=k; i++)
+		statistics.setCamera(timelineCameras[i], vector<int>(visibleTimeline.begin(i), visibleTimeline.end(i)));
+	for (size_t i=statisticsStep; i>k; i--)
+		statistics.setCamera(timelineCameras[i], vector<int>());
+	statisticsStep = k;
+
+	ostringstream os;
+	os << "frames         " << setw(9) << k + 1 << " / " << timelineCameras.size() << "\n" << statistics.report();
+	statisticsPanel->setText(QString::fromStdString(os.str()));
+}
+
+/* ************************************************************************* */
+// show the visibility of timeline step {k}, only the points and cameras that change are recolored and uploaded.
+// the replay only moves its step, the statistics and the thumbnails catch up when it is left
+void showStep(const size_t k) {
+	if (k == shownStep) return;
+	const int previous = timelineCameras[shownStep];
+	shownStep = k;
+
+	if (replay) {
+		lifetimeLayer->setStep(k);
+		return;
+	}
+	updateStatistics(k);
+
+	const vector<int>& points = visibleTimeline.seek(k);
+	BOOST_FOREACH(const int& i, points)
+		pointColorsNow[i] = visibleTimeline.highlighted(i) ? visible_point_color : pointColors[i];
+	pointLayer->colorsChanged(points);
+
+	vector<int> changedCameras = neighborTimeline.seek(k);
+	if (minOverlap > 0)
+		colorCameras();
+	else {
+		BOOST_FOREACH(const int& i, changedCameras)
+			colorNeighbor(i);
+		colorNeighbor(previous);
+		cameraColorsNow[timelineCameras[k]] = SFMColor(1.0, 0.0, 0.0, 1.0);
+		changedCameras.push_back(previous);
+		changedCameras.push_back(timelineCameras[k]);
+		cameraLayer->colorsChanged(changedCameras);
+	}
+
+	loadThumbnails();
+}
+
+/* ************************************************************************* */
+// recolor all the points, keeping the visible ones of the shown step highlighted
+void recolorPoints() {
+	pointColorsNow = pointColors;
+	for (const int* i=visibleTimeline.begin(shownStep); i!=visibleTimeline.end(shownStep); i++)
+		pointColorsNow[*i] = visible_point_color;
+	pointLayer->touch();
 	canvas->updateGL();
+}
+
+/* ************************************************************************* */
+// the base colors of the points changed with the error coloring, the replay draws them as well
+void recolorErrors() {
+	colorPoints();
+	lifetimeLayer->touch();
+	recolorPoints();
+}
 
-	// quit if all the data has been processed
-	if (step + step_size >= visibileFeatures.size())
-		app->quit();
+void showVisibilityColors() { errorColoring = NO_ERRORS; recolorErrors(); }
+void showMeanErrors() { errorColoring = MEAN_ERRORS; recolorErrors(); }
+void showMaxErrors() { errorColoring = MAX_ERRORS; recolorErrors(); }
 
-	// find the next frame that has visibility information
-	while(true) {
-		step >= visibileFeatures.size() ? step = 0 : step += step_size;
-		if (visibileFeatures.find(step) != visibileFeatures.end())
-			break;
+/* ************************************************************************* */
+// the lifetimes of the points and the cameras, a camera lives from the first step it is seen in, as the current
+// camera or a neighbor, to the last one
+void computeLifetimes() {
+	visibleTimeline.lifetimes(pointLifetimes);
+	neighborTimeline.lifetimes(cameraLifetimes);
+	for (size_t k=0; k<timelineCameras.size(); k++) {
+		Lifetime& lifetime = cameraLifetimes[timelineCameras[k]];
+		lifetime.first = min(lifetime.first, (GLfloat)k);
+		lifetime.last = lifetime.last == FLT_MAX ? k : max(lifetime.last, (GLfloat)k);
 	}
+	replayCameraColors.assign(cameras.size(), camera_color);
+}
+
+/* ************************************************************************* */
+// play the reconstruction as it grows
+void showReplay() {
+	replay = true;
+	lifetimeLayer->setStep(shownStep);
+	lifetimeLayer->setVisible(true);
+	pointLayer->setVisible(false);
+	cameraLayer->setVisible(false);
+	canvas->updateGL();
 }
 
 /* ************************************************************************* */
-QuatPose computeOrbitCamera(const int segment) {
-	float angle = -M_PI_2 + (float)segment / orbit_segments * M_PI * 2;
-
-	// compute the rotation of the current point on the orbit, refer to quaternions.lyx
-	//float beta = atan2(orbit_height, orbit_radius) / 2;
-	float theta = -(M_PI_4 + angle / 2);
-	float beta = -M_PI_4 * 0.4;
-	float q1[4] = {0., sin(theta), 0., cos(theta)};
-	float q2[4] = {sin(beta), 0., 0., cos(beta)};
-	float q[4];
-	add_quats(q2, q1, q);
-
-	// compute the translation in the new rotated coordinate system
-	float x = cos(angle) * orbit_radius + orbit_center_x;
-	float z = sin(angle) * orbit_radius + orbit_center_z;
-	float trans[3] = {x, orbit_height, z};
-
-	return QuatPose(trans[0], trans[1], trans[2], q[0], q[1], q[2], q[3]);
+// go back to the visibility colors, the timelines catch up with the steps played meanwhile
+void showVisibility() {
+	replay = false;
+	lifetimeLayer->setVisible(false);
+	pointLayer->setVisible(true);
+	cameraLayer->setVisible(true);
+	visibleTimeline.seek(shownStep);
+	neighborTimeline.seek(shownStep);
+	updateStatistics(shownStep);
+	loadThumbnails();
+	colorCameras();
+	recolorPoints();
 }
 
+/* ************************************************************************* */
+void setMaxColoredError(int pixels) {
+	maxColoredError = pixels;
+	if (errorColoring != NO_ERRORS) recolorErrors();
+}
+
+/* ************************************************************************* */
+// jump to timeline step {k} from the slider, the playback continues from there
+void seekVisibility(int k) {
+	step = k;
+	if ((size_t)k == shownStep) return;
+	showStep(k);
+	canvas->updateGL();
+}
+
+/* ************************************************************************* */
+// show the visibility of the next frame
+void nextVisibility() {
+	// hold on the last step once all the data has been played, until the slider moves back
+	const bool last = step + step_size >= timelineCameras.size();
+	if (last && step == shownStep) return;
+
+	showStep(step);
+	timelineSlider->setValue(step);
+
+	// update opengla canvas
+	canvas->updateGL();
+
+	if (!last) step += step_size;
+}
+
+/* ************************************************************************* */
 // move the camera around an orbit
 void moveCamera() {
-	// the current position on the orbit
-	int segment = orbit_step % orbit_segments;
-	canvas->setGLPose(computeOrbitCamera(segment));
+	// the current position on the orbit, independent of how often the timer fires
+	if (!orbit_player.running()) return;
+	canvas->setGLPose(orbit_player.pose());
 	canvas->updateGL();
-	orbit_step ++;
 }
 
 /* ************************************************************************* */
@@ -239,31 +521,87 @@ void sfmviewer::setup()
 	// load the visibility file
 	loadVisibility();
 
+	// the covisibility graph, filtered by a slider
+	computeCovisibility();
+	covisibilityLayer.reset(new CovisibilityLayer(&cameraCenters, &covisibility));
+	canvas->scene().add(covisibilityLayer);
+	uint32_t maxShared = 1;
+	BOOST_FOREACH(const CovisibilityEdge& edge, covisibility)
+		maxShared = max(maxShared, edge.shared);
+	const int threshold = max(1, (int)maxShared / 4);
+	covisibilityLayer->setThreshold(threshold);
+	window->addSlider("shared points", 1, maxShared, threshold, setCovisibilityThreshold);
+
+	// the cameras sharing at least so many points with the current one, 0 for the neighbors of the file
+	computeVisibilitySets();
+	window->addSlider("overlap", 0, maxShared, minOverlap, setOverlapThreshold);
+
+	// the timeline of the visibility, starting with the colors of the first step
+	computeTimelines();
+	if (timelineCameras.empty()) {
+		cerr << "kai02: no visibility information" << endl;
+		exit(1);
+	}
+	loadedColors = pointColors;
+	computeReprojectionErrors();
+	pointLayer.reset(new PointLayer(&structure, &pointColorsNow));
+	cameraLayer.reset(new CameraLayer(&cameras, &cameraColorsNow, false));
+	canvas->scene().add(pointLayer);
+	canvas->scene().add(cameraLayer);
+	pointColorsNow = pointColors;
+	for (const int* i=visibleTimeline.begin(0); i!=visibleTimeline.end(0); i++)
+		pointColorsNow[*i] = visible_point_color;
+	colorCameras();
+	loadThumbnails();
+	timelineSlider = window->addSlider("frame", 0, timelineCameras.size() - 1, 0, seekVisibility);
+
+	// the statistics of the first frame, the others come in as it plays
+	vector<vector<int> > firstFrame(cameras.size());
+	firstFrame[timelineCameras[0]].assign(visibleTimeline.begin(0), visibleTimeline.end(0));
+	statistics.compute(firstFrame, structure.size());
+	statisticsPanel = window->addPanel("Statistics");
+	updateStatistics(0);
+
+	// the replay of the reconstruction, hidden until it is chosen
+	computeLifetimes();
+	lifetimeLayer.reset(new LifetimeLayer(&structure, &pointColors, &pointLifetimes, &cameras, &replayCameraColors,
+			&cameraLifetimes));
+	lifetimeLayer->setVisible(false);
+	canvas->scene().add(lifetimeLayer);
+	window->addMenuAction("Playback", "Visibility", showVisibility);
+	window->addMenuAction("Playback", "Reconstruction", showReplay);
+
+	// the points colored by their reprojection errors instead
+	if (reprojection.numObservations()) {
+		window->addMenuAction("Errors", "Visibility", showVisibilityColors);
+		window->addMenuAction("Errors", "Mean reprojection error", showMeanErrors);
+		window->addMenuAction("Errors", "Max reprojection error", showMaxErrors);
+		window->addSlider("error px", 1, 50, maxColoredError, setMaxColoredError);
+	}
+
 	// set the default camera pose for St. Peter
 //	canvas->setGLPose(QuatPose(119., -257., -100., -0.341, -0.223, -0.081, 0.909));
-	canvas->setGLPose(computeOrbitCamera(orbit_step));
+	orbit_player.start(orbit_period * 250 / orbit.segments);
+	canvas->setGLPose(orbit_player.pose());
 
 	// set the top camera pose
 	canvas->setGLPoseTop(QuatPose(0., -500., 200., -1./sqrt(2.), 0., 0., 1./sqrt(2.)));
 
 	// set up the timer for pluging in the visibility data
-	pointColorsNow = pointColors;
-	cameraColorsNow = cameraColors;
 	canvas->addTimer(nextVisibility, slow_motion * 100);
 
-	// set up the timer for moving the opengl camera
-	canvas->addTimer(moveCamera, slow_motion * 60);
+	// set up the timer for moving the opengl camera, once per frame of the orbit
+	canvas->addTimer(moveCamera, (int)(1000. / orbit_player.fps()));
 }
 
 /* ************************************************************************* */
 void sfmviewer::draw() {
-	// draw inactive world
-	drawStructure(structure, pointColorsNow);
-	drawCameras(cameras, cameraColorsNow, false);
+	// the world and the replay are drawn by their layers
 //	drawCameraCircle();
 
+	// the thumbnails stay at the step the replay started from, so they are left out while it plays
 	int left = window_scale * 17;
-	if (!nnTexIDs.empty()) {
+	if (!replay && !nnTexIDs.empty()) {
 		drawThumbnail(queryTexID, canvas->size(), QRectF(left, 10., thumbnail_width, thumbnail_height), SFMColor(1.,0.,0.,1.));
 		BOOST_FOREACH(const GLuint& id, nnTexIDs) {
 			left += thumbnail_width + thumbnail_space;
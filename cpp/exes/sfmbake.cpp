@@ -0,0 +1,69 @@
+/*
+ * sfmbake.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: converts the arrays of bunny.h into the render layout of assets.h at build time
+ *
+ *  usage: sfmbake baked_assets.cpp
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// bunny.h only needs the opengl float type, the tool does not link opengl
+typedef float GLfloat;
+#include "bunny.h"
+
+using namespace std;
+
+/* ************************************************************************* */
+// write {floats} as the words of a BakedAsset of {count} elements
+void writeAsset(ostream& os, const string& name, const vector<float>& floats, const size_t count) {
+	os << "\tstatic const uint32_t " << name << "_words[" << floats.size() << "] = {";
+	for (size_t i=0; i<floats.size(); i++) {
+		uint32_t word;
+		memcpy(&word, &floats[i], sizeof(word));
+		char hex[16];
+		sprintf(hex, "0x%08xu", word);
+		os << (i % 8 == 0 ? "\n\t\t" : " ") << hex << (i + 1 < floats.size() ? "," : "");
+	}
+	os << "\n\t};\n";
+	os << "\tconst BakedAsset baked_" << name << " = {" << name << "_words, sizeof(" << name << "_words), "
+		 << count << "};\n\n";
+}
+
+/* ************************************************************************* */
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		cerr << "usage: sfmbake baked_assets.cpp" << endl;
+		return 1;
+	}
+
+	ofstream os(argv[1]);
+	if (!os) {
+		cerr << "sfmbake: can not write " << argv[1] << endl;
+		return 1;
+	}
+
+	os << "// generated by sfmbake from bunny.h, do not edit\n\n"
+		 << "#include <stdint.h>\n#include \"assets.h\"\n\nnamespace sfmviewer {\n\n";
+
+	// the bunny is stored with y up, the viewer looks at it with y down
+	vector<float> bunny;
+	bunny.reserve(3 * bunny_nr_vertex);
+	for (int i=0; i<bunny_nr_vertex; i++) {
+		bunny.push_back(bunny_vertices[i][0]);
+		bunny.push_back(-bunny_vertices[i][1]);
+		bunny.push_back(bunny_vertices[i][2]);
+	}
+	writeAsset(os, "bunny_structure", bunny, bunny_nr_vertex);
+
+	os << "} // namespace sfmviewer\n";
+	return os ? 0 : 1;
+}
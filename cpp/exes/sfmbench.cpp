@@ -0,0 +1,183 @@
+/*
+ * sfmbench.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: end-to-end benchmark on synthetic reconstructions, one json line per scene
+ *
+ *  usage: sfmbench [--points 1e6,1e7,1e8] [--cameras 1e3,1e4,1e5] [--grid] [--frames 360]
+ *                  [--size 1024x768] [--skip-load] [--retained] [--trajectory] [--seed 1] [--output results.jsonl]
+ *
+ *  --retained draws through a Scene of point and camera layers instead of the immediate calls.
+ *  --trajectory adds a TrajectoryLayer through the camera centers and implies --retained.
+ *  Without --grid the i-th point count is paired with the i-th camera count. It needs an X
+ *  display for the pixel buffer, headless machines run it under Mesa, e.g.
+ *    xvfb-run -a env LIBGL_ALWAYS_SOFTWARE=1 ./sfmbench
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <boost/bind.hpp>
+
+#include "bench.h"
+#include "camerapath.h"
+#include "offscreen.h"
+#include "render.h"
+#include "scene.h"
+#include "sceneio.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+/**
+ * benchmark settings
+ */
+static vector<size_t> numPointsList = parseSizes("1e6,1e7,1e8");
+static vector<size_t> numCamerasList = parseSizes("1e3,1e4,1e5");
+static bool grid = false;
+static int numFrames = 360;
+static int width = 1024, height = 768;
+static bool skipLoad = false;
+static bool retained = false;
+static bool trajectory = false;
+static unsigned int seed = 1;
+static string output;
+
+// draws the scene as kai01 does, from buffers that stay cached as long as the {generation} does
+struct DrawScene {
+	const SceneData* data;
+	const vector<CameraVertices>* cameras;
+	uint64_t generation;
+	void operator()() const {
+		drawStructure(data->structure, data->pointColors, generation);
+		drawCameras(*cameras, vector<SFMColor>(), true, generation);
+	}
+};
+
+// a new one for every synthesized scene, which may reuse the memory of the last one
+static uint64_t sceneGeneration = uncached;
+
+/* ************************************************************************* */
+static double elapsedMS(const QElapsedTimer& timer) {
+	return timer.nsecsElapsed() * 1e-6;
+}
+
+/* ************************************************************************* */
+void parseArguments(const QStringList& args) {
+	for (int i=1; i<args.size(); i++) {
+		string arg = args[i].toStdString();
+		string value = i + 1 < args.size() ? args[i+1].toStdString() : "";
+		if (arg == "--points")           { numPointsList = parseSizes(value); i++; }
+		else if (arg == "--cameras")     { numCamerasList = parseSizes(value); i++; }
+		else if (arg == "--grid")        grid = true;
+		else if (arg == "--frames")      { numFrames = atoi(value.c_str()); i++; }
+		else if (arg == "--size")        { sscanf(value.c_str(), "%dx%d", &width, &height); i++; }
+		else if (arg == "--skip-load")   skipLoad = true;
+		else if (arg == "--retained")    retained = true;
+		else if (arg == "--trajectory")  retained = trajectory = true;
+		else if (arg == "--seed")        { seed = atoi(value.c_str()); i++; }
+		else if (arg == "--output")      { output = value; i++; }
+		else
+			throw runtime_error("sfmbench: unknown argument " + arg);
+	}
+	if (numFrames < 1 || numPointsList.empty() || numCamerasList.empty() ||
+			(!grid && numPointsList.size() != numCamerasList.size()))
+		throw runtime_error("sfmbench: invalid scene list, use --grid for lists of different lengths");
+}
+
+/* ************************************************************************* */
+void benchmark(OffscreenRenderer& renderer, const size_t numPoints, const size_t numCameras, ostream& os) {
+	QElapsedTimer timer;
+	SceneData data;
+
+	// synthesize the reconstruction
+	timer.start();
+	generateSyntheticScene(numPoints, numCameras, data, seed);
+	double generate_ms = elapsedMS(timer);
+
+	// load it back from the text format
+	double load_ms = -1.;
+	if (!skipLoad) {
+		string filename = QDir::tempPath().toStdString() + "/sfmbench_" + QString::number(getpid()).toStdString() + ".txt";
+		saveSceneData(filename, data);
+		data = SceneData();
+		timer.start();
+		if (!loadSceneData(filename, data))
+			throw runtime_error("sfmbench: can not read back " + filename);
+		load_ms = elapsedMS(timer);
+		unlink(filename.c_str());
+	}
+
+	// compute the camera frusta
+	timer.start();
+	vector<CameraVertices> cameras;
+	data.calcCameras(cameras);
+	double prep_ms = elapsedMS(timer);
+
+	// the first frame carries all one-time uploads
+	DrawScene immediate = {&data, &cameras, ++sceneGeneration};
+	Scene scene;
+	scene.add(LayerPtr(new PointLayer(&data.structure, &data.pointColors)));
+	scene.add(LayerPtr(new CameraLayer(&cameras)));
+	boost::shared_ptr<TrajectoryLayer> path;
+	if (trajectory) scene.add(path = boost::shared_ptr<TrajectoryLayer>(new TrajectoryLayer(&data.poses)));
+	Callback draw = retained ? Callback(boost::bind(&Scene::draw, &scene)) : Callback(immediate);
+	OrbitPath orbit;
+	orbit.segments = numFrames;
+	timer.start();
+	renderer.render(orbit.pose(0), draw);
+	double upload_ms = elapsedMS(timer);
+
+	// fly around the orbit
+	vector<double> frame_ms;
+	frame_ms.reserve(numFrames);
+	for (int i=0; i<numFrames; i++) {
+		timer.start();
+		renderer.render(orbit.pose(i), draw);
+		frame_ms.push_back(elapsedMS(timer));
+	}
+	SampleStats stats = computeStats(frame_ms);
+
+	os << "{\"bench\":\"sfmbench\",\"mode\":\"" << (retained ? "retained" : "immediate") << "\""
+		 << ",\"points\":" << data.structure.size() << ",\"cameras\":" << cameras.size()
+		 << ",\"trajectory_vertices\":" << (path ? (long)path->numDrawn() : -1L)
+		 << ",\"width\":" << width << ",\"height\":" << height << ",\"frames\":" << numFrames
+		 << ",\"generate_ms\":" << generate_ms << ",\"load_ms\":" << load_ms << ",\"prep_ms\":" << prep_ms
+		 << ",\"upload_ms\":" << upload_ms << ",\"frame_ms\":" << toJson(stats)
+		 << ",\"fps\":" << (stats.mean > 0. ? 1000. / stats.mean : 0.)
+		 << ",\"peak_rss_kb\":" << peakRSSKB() << "}" << endl;
+}
+
+/* ************************************************************************* */
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+	try {
+		parseArguments(app.arguments());
+
+		OffscreenRenderer renderer(width, height);
+		if (!renderer.isValid()) {
+			cerr << "sfmbench: can not create a " << width << "x" << height << " pixel buffer" << endl;
+			return 1;
+		}
+
+		ofstream file;
+		if (!output.empty()) file.open(output.c_str());
+		ostream& os = output.empty() ? cout : file;
+
+		// the scenes are run from small to large, so the peak memory is the one of the current scene
+		for (size_t i=0; i<numPointsList.size(); i++)
+			for (size_t j=0; j<numCamerasList.size(); j++)
+				if (grid || i == j)
+					benchmark(renderer, numPointsList[i], numCamerasList[j], os);
+	} catch (const exception& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
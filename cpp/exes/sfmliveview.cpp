@@ -0,0 +1,188 @@
+/*
+ * sfmliveview.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a viewer of a scene that an optimizer thread keeps changing, through a SceneChannel
+ *
+ *  usage: sfmliveview [--stress seconds]
+ *
+ *  The producer thread pulls a noisy bunny back into shape and circles a ring of cameras around it,
+ *  publishing every iteration while the canvas draws the latest one. With --stress the two sides run
+ *  flat out without a window for the given time, and every snapshot the reader gets is checked to be
+ *  the complete one of its serial, the exit code is 1 if any of them was torn.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdexcept>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "assets.h"
+#include "channel.h"
+#include "main.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+static const size_t numCameras = 12;
+
+/* ************************************************************************* */
+// the size and the stamp of the snapshot with {serial}, small enough to be exact as floats
+static size_t stressSize(const uint64_t serial) { return 1 + serial % 1000; }
+static float stressStamp(const uint64_t serial) { return (float)(serial % 65536); }
+
+/* ************************************************************************* */
+// the producer side, either a mock optimizer or the stress writer
+class Producer : public QThread {
+public:
+	Producer(SceneChannel* channel, const bool stress) : channel_(channel), stress_(stress), stop_(0), published_(0) {}
+
+	void stop() { stop_ = 1; }
+
+	// the number of snapshots published so far, read after the thread finished
+	uint64_t published() const { return published_; }
+
+protected:
+	void run() { stress_ ? runStress() : runOptimizer(); }
+
+private:
+	// fill the whole snapshot with the stamp of its serial, in sizes that change every time
+	void runStress() {
+		while (!(int)stop_) {
+			const uint64_t serial = ++published_;
+			const float stamp = stressStamp(serial);
+			SceneSnapshot& snapshot = channel_->back();
+			snapshot.structure.assign(stressSize(serial), Vertex(stamp, stamp, stamp));
+			snapshot.pointColors.assign(stressSize(serial), SFMColor(stamp, stamp, stamp, stamp));
+			snapshot.poses.assign(serial % numCameras, QuatPose(stamp, stamp, stamp, 0.f, 0.f, 0.f, 1.f));
+			channel_->publish();
+		}
+	}
+
+	// every iteration moves the points a bit towards the bunny and starts over from noise once it converged
+	void runOptimizer() {
+		const Vertex* bunny = (const Vertex*)baked_bunny_structure.data;
+		const size_t numPoints = baked_bunny_structure.count;
+		vector<Vertex> points(bunny, bunny + numPoints);
+		srand(0);
+
+		for (int iteration=0; !(int)stop_; iteration++) {
+			if (iteration % 200 == 0)
+				for (size_t i=0; i<numPoints; i++) {
+					points[i].X += 0.1f * ((float)rand() / RAND_MAX - 0.5f);
+					points[i].Y += 0.1f * ((float)rand() / RAND_MAX - 0.5f);
+					points[i].Z += 0.1f * ((float)rand() / RAND_MAX - 0.5f);
+				}
+
+			// the points are reddish as long as they are far from where they belong
+			SceneSnapshot& snapshot = channel_->back();
+			snapshot.structure.resize(numPoints);
+			snapshot.pointColors.assign(numPoints, default_point_color);
+			for (size_t i=0; i<numPoints; i++) {
+				Vertex& p = points[i];
+				p.X += 0.05f * (bunny[i].X - p.X);
+				p.Y += 0.05f * (bunny[i].Y - p.Y);
+				p.Z += 0.05f * (bunny[i].Z - p.Z);
+				const float dx = bunny[i].X - p.X, dy = bunny[i].Y - p.Y, dz = bunny[i].Z - p.Z;
+				snapshot.pointColors[i].r = min(1.f, 50.f * sqrtf(dx * dx + dy * dy + dz * dz));
+				snapshot.structure[i] = p;
+			}
+
+			// the cameras circle the bunny about the y axis, looking at it
+			snapshot.poses.resize(numCameras);
+			for (size_t c=0; c<numCameras; c++) {
+				const float angle = 2.f * M_PI * c / numCameras + 0.01f * iteration;
+				snapshot.poses[c] = QuatPose(0.3f * sinf(angle), 0.f, -0.3f * cosf(angle),
+						0.f, sinf(-0.5f * angle), 0.f, cosf(-0.5f * angle));
+			}
+			channel_->publish();
+			published_++;
+			msleep(10);
+		}
+	}
+
+	SceneChannel* channel_;
+	bool stress_;
+	QAtomicInt stop_;
+	uint64_t published_;
+};
+
+/* ************************************************************************* */
+// whether {snapshot} is the complete one published with {serial}
+static bool isComplete(const SceneSnapshot& snapshot, const uint64_t serial) {
+	const float stamp = stressStamp(serial);
+	if (snapshot.structure.size() != stressSize(serial) || snapshot.pointColors.size() != stressSize(serial) ||
+			snapshot.poses.size() != serial % numCameras)
+		return false;
+	for (size_t i=0; i<snapshot.structure.size(); i++)
+		if (snapshot.structure[i].X != stamp || snapshot.structure[i].Z != stamp ||
+				snapshot.pointColors[i].r != stamp || snapshot.pointColors[i].alpha != stamp)
+			return false;
+	for (size_t i=0; i<snapshot.poses.size(); i++)
+		if (snapshot.poses[i].x() != stamp || snapshot.poses[i].z() != stamp)
+			return false;
+	return true;
+}
+
+/* ************************************************************************* */
+// read as fast as possible for {seconds} while the producer writes, returns the number of torn snapshots
+static uint64_t stress(const double seconds) {
+	SceneChannel channel;
+	Producer producer(&channel, true);
+	producer.start();
+
+	uint64_t acquired = 0, torn = 0, lastSerial = 0;
+	QElapsedTimer timer;
+	timer.start();
+	while (timer.elapsed() < seconds * 1000.) {
+		if (!channel.acquire()) continue;
+		acquired++;
+		const uint64_t serial = channel.serial();
+		if (serial <= lastSerial || !isComplete(channel.front(), serial)) torn++;
+		lastSerial = serial;
+	}
+	producer.stop();
+	producer.wait();
+
+	cout << "published " << producer.published() << " snapshots, acquired " << acquired << ", torn " << torn << endl;
+	return torn;
+}
+
+static SceneChannel channel;
+static Producer* producer = NULL;
+
+/* ************************************************************************* */
+static void stopProducer() {
+	producer->stop();
+	producer->wait();
+}
+
+/* ************************************************************************* */
+void sfmviewer::setup()
+{
+	QStringList args = app->arguments();
+	for (int i=1; i+1<args.size(); i++)
+		if (args[i] == "--stress") {
+			const double seconds = args[i+1].toDouble();
+			if (!(seconds > 0.)) {
+				cerr << "sfmliveview: --stress needs a positive number of seconds" << endl;
+				exit(1);
+			}
+			exit(stress(seconds) == 0 ? 0 : 1);
+		}
+
+	canvas->scene().add(LayerPtr(new LiveLayer(&channel, 0.05f)));
+	canvas->setGLPose(QuatPose(0., 0., -1., 0., 0., 0., 1.));
+	canvas->setRefreshInterval(15);
+
+	producer = new Producer(&channel, false);
+	producer->start();
+	atexit(stopProducer);
+}
+
+/* ************************************************************************* */
+void sfmviewer::draw() {
+}
@@ -0,0 +1,407 @@
+/*
+ * sfmmicrobench.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: microbenchmarks of the math and render-prep kernels, one json line per kernel and size
+ *
+ *  usage: sfmmicrobench [--sizes 1e3,1e4,1e5,1e6] [--reps 21] [--kernel name] [--output results.jsonl] [--verify]
+ *
+ *  --verify compares the array kernels of every supported instruction set with the scalar ones
+ *  and exits with an error if any result differs, nothing is timed then
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <QElapsedTimer>
+#include <gtsam/geometry/SimpleCamera.h>
+
+#include "bench.h"
+#include "covisibility.h"
+#include "polyline.h"
+#include "render-inl.h"
+#include "reprojection.h"
+#include "sceneio.h"
+#include "visibilityset.h"
+
+using namespace std;
+using namespace gtsam;
+using namespace sfmviewer;
+
+/**
+ * benchmark settings
+ */
+static vector<size_t> sizes = parseSizes("1e3,1e4,1e5,1e6");
+static int numReps = 21;
+static string onlyKernel;
+static string output;
+static bool verify = false;
+
+// keeps the compiler from removing the kernels
+static volatile float sink = 0.f;
+
+/* ************************************************************************* */
+// random quaternions and poses that are reused by all the kernels
+struct Inputs {
+	vector<QuatPose> poses;
+	vector<float> quats;  // 4 floats per quaternion
+
+	Inputs(size_t n) : poses(n), quats(4 * n) {
+		unsigned int state = 12345;
+		for (size_t i=0; i<n; i++) {
+			float q[4], norm = 0.f;
+			for (int k=0; k<4; k++) {
+				state = state * 1664525u + 1013904223u;
+				q[k] = (state >> 8) / (float)(1 << 24) - 0.5f;
+				norm += q[k] * q[k];
+			}
+			norm = sqrt(norm);
+			for (int k=0; k<4; k++)
+				quats[4*i+k] = q[k] / norm;
+			poses[i] = QuatPose(i * 0.1f, -1.f, i * 0.2f, quats[4*i], quats[4*i+1], quats[4*i+2], quats[4*i+3]);
+		}
+	}
+};
+
+/* ************************************************************************* */
+struct BuildRotmatrix {
+	const Inputs* in;
+	vector<float> out;
+	BuildRotmatrix(const Inputs& inputs) : in(&inputs), out(9 * inputs.poses.size()) {}
+	void operator()() {
+		float (*m)[3][3] = (float (*)[3][3])&out[0];
+		for (size_t i=0; i<in->poses.size(); i++)
+			build_rotmatrix(m[i], &in->quats[4*i]);
+		sink += out[out.size() / 2];
+	}
+};
+
+struct AddQuats {
+	Inputs* in;
+	vector<float> out;
+	AddQuats(Inputs& inputs) : in(&inputs), out(inputs.quats.size()) {}
+	void operator()() {
+		size_t n = in->poses.size();
+		for (size_t i=0; i<n; i++)
+			add_quats(&in->quats[4*i], &in->quats[4*((i+1)%n)], &out[4*i]);
+		sink += out[out.size() / 2];
+	}
+};
+
+struct BuildTranMatrix {
+	const Inputs* in;
+	vector<float> out;
+	BuildTranMatrix(const Inputs& inputs) : in(&inputs), out(16 * inputs.poses.size()) {}
+	void operator()() {
+		float (*m)[4][4] = (float (*)[4][4])&out[0];
+		for (size_t i=0; i<in->poses.size(); i++)
+			build_tran_matrix(in->poses[i], m[i]);
+		sink += out[out.size() / 2];
+	}
+};
+
+struct RotationToQuaternion {
+	vector<float> matrices;
+	vector<float> out;
+	RotationToQuaternion(const Inputs& inputs) : matrices(16 * inputs.poses.size()), out(inputs.quats.size()) {
+		float (*m)[4][4] = (float (*)[4][4])&matrices[0];
+		for (size_t i=0; i<inputs.poses.size(); i++)
+			build_tran_matrix(inputs.poses[i], m[i]);
+	}
+	void operator()() {
+		float (*m)[4][4] = (float (*)[4][4])&matrices[0];
+		for (size_t i=0; i<out.size() / 4; i++)
+			rotation_to_quaternion(m[i], &out[4*i]);
+		sink += out[out.size() / 2];
+	}
+};
+
+// the array versions on the same inputs, at the instruction set chosen by set_simd_level
+struct ArrayKernels {
+	const Inputs* in;
+	vector<float> quats2, matrices;
+	vector<float> rotations, products, transforms, quaternions;
+	ArrayKernels(const Inputs& inputs) : in(&inputs), quats2(inputs.quats.size()), matrices(16 * inputs.poses.size()),
+			rotations(9 * inputs.poses.size()), products(inputs.quats.size()), transforms(16 * inputs.poses.size()),
+			quaternions(inputs.quats.size()) {
+		size_t n = inputs.poses.size();
+		for (size_t i=0; i<inputs.quats.size(); i++)
+			quats2[i] = inputs.quats[(i + 4) % (4 * n)];
+		float (*m)[4][4] = (float (*)[4][4])&matrices[0];
+		for (size_t i=0; i<n; i++)
+			build_tran_matrix(inputs.poses[i], m[i]);
+	}
+	void buildRotmatrix() {
+		build_rotmatrix_array(&in->quats[0], &rotations[0], in->poses.size());
+		sink += rotations[rotations.size() / 2];
+	}
+	void addQuats() {
+		add_quats_array(&in->quats[0], &quats2[0], &products[0], in->poses.size());
+		sink += products[products.size() / 2];
+	}
+	void buildTranMatrix() {
+		build_tran_matrix_array(&in->poses[0], &transforms[0], in->poses.size());
+		sink += transforms[transforms.size() / 2];
+	}
+	void rotationToQuaternion() {
+		rotation_to_quaternion_array(&matrices[0], &quaternions[0], in->poses.size());
+		sink += quaternions[quaternions.size() / 2];
+	}
+};
+
+// the cameras are keyed as in gtsam values
+struct CalcCameraVertices {
+	map<int, SimpleCamera> cameras;
+	vector<CameraVertices> out;
+	CalcCameraVertices(const Inputs& inputs) {
+		Cal3_S2 k(120., 1600, 1600);
+		for (size_t i=0; i<inputs.poses.size(); i++) {
+			const QuatPose& p = inputs.poses[i];
+			float r[3][3];
+			build_rotmatrix(r, p.m_quat);
+			Pose3 pose(Rot3(r[0][0], r[0][1], r[0][2], r[1][0], r[1][1], r[1][2], r[2][0], r[2][1], r[2][2]),
+					Point3(p.x(), p.y(), p.z()));
+			cameras.insert(make_pair((int)i, SimpleCamera(k, pose)));
+		}
+	}
+	void operator()() {
+		out = calcCameraVertices<map<int, SimpleCamera>::const_iterator, SimpleCamera, Point2, Point3>(
+				cameras.begin(), cameras.end(), cameras.size(), 1600, 1600, 7.f);
+		sink += out[out.size() / 2].v[1].X;
+	}
+};
+
+// the frusta straight from a batch that is already in SoA form, e.g. refreshed after every optimizer iteration
+struct CalcCameraVerticesBatch {
+	CameraBatch batch;
+	vector<CameraVertices> out;
+	CalcCameraVerticesBatch(const Inputs& inputs) {
+		batch.resize(inputs.poses.size());
+		for (size_t i=0; i<inputs.poses.size(); i++)
+			batch.set(i, inputs.poses[i], 120.f, 1600, 1600);
+	}
+	void operator()() {
+		calcCameraVertices(batch, 1600, 1600, 7.f, out);
+		sink += out[out.size() / 2].v[1].X;
+	}
+};
+
+// the simplification of a random walk of camera centers at all tolerances
+struct SimplifyTrajectory {
+	vector<Vertex> centers;
+	PolylineLod lod;
+	SimplifyTrajectory(const Inputs& inputs) : centers(inputs.poses.size()) {
+		Vertex c(0.f, 0.f, 0.f);
+		for (size_t i=0; i<centers.size(); i++) {
+			c = Vertex(c.X + inputs.quats[4*i], c.Y + inputs.quats[4*i+1], c.Z + 0.1f * inputs.quats[4*i+2]);
+			centers[i] = c;
+		}
+	}
+	void operator()() {
+		lod.update(centers);
+		sink += lod.error(centers.size() / 2);
+	}
+};
+
+// the covisibility graph of a video, where every point is seen by a few consecutive cameras out of n / 100
+struct CovisibilityGraph {
+	vector<vector<int> > tracks;
+	size_t numCameras;
+	vector<CovisibilityEdge> edges;
+	CovisibilityGraph(const Inputs& inputs) : tracks(inputs.poses.size()), numCameras(inputs.poses.size() / 100 + 1) {
+		for (size_t i=0; i<tracks.size(); i++) {
+			const size_t first = i * numCameras / tracks.size();
+			const size_t length = 2 + (size_t)(4.f * fabs(inputs.quats[4*i]));
+			for (size_t c=first; c<min(first + length, numCameras); c++)
+				tracks[i].push_back(c);
+		}
+	}
+	void operator()() {
+		covisibilityGraph(tracks, numCameras, edges);
+		sink += edges.size();
+	}
+};
+
+// the overlaps of the middle camera with all the others, on the cameras of CovisibilityGraph
+struct VisibilityOverlaps {
+	VisibilitySets sets;
+	vector<uint32_t> counts;
+	VisibilityOverlaps(const Inputs& inputs) {
+		CovisibilityGraph graph(inputs);
+		vector<vector<int> > cameraPoints(graph.numCameras);
+		for (size_t i=0; i<graph.tracks.size(); i++)
+			for (size_t k=0; k<graph.tracks[i].size(); k++)
+				cameraPoints[graph.tracks[i][k]].push_back(i);
+		sets = VisibilitySets(cameraPoints, graph.tracks.size());
+	}
+	void operator()() {
+		sets.overlaps(sets.numCameras() / 2, counts);
+		sink += counts[counts.size() / 2];
+	}
+};
+
+// the reprojection errors of a synthetic scene whose points are seen by four cameras each, all of them
+// recomputed or, with {moveOne}, only the tracks of the one camera that moves between the calls
+struct ReprojectionErrorsKernel {
+	SceneData scene;
+	ReprojectionErrors errors;
+	bool moveOne;
+	vector<int> movedCameras, movedPoints;
+	ReprojectionErrorsKernel(const Inputs& inputs, const bool moveOne0) : moveOne(moveOne0), movedCameras(1, 0) {
+		const size_t numCameras = inputs.poses.size() / 1000 + 8;
+		generateSyntheticScene(inputs.poses.size(), numCameras, scene);
+		vector<Observation> observations;
+		for (size_t p=0; p<scene.structure.size(); p++)
+			for (size_t k=0; k<4; k++) {
+				const size_t c = (p * 7 + k * 13) % numCameras;
+				float u, v;
+				if (projectPoint(scene.poses[c], scene.fov, scene.img_w, scene.img_h, scene.structure[p], u, v))
+					observations.push_back(Observation(c, p, u + inputs.quats[4*p], v + inputs.quats[4*p+1]));
+			}
+		errors = ReprojectionErrors(observations, scene.structure.size(), numCameras, scene.fov, scene.img_w, scene.img_h);
+		errors.compute(scene.poses, scene.structure);
+	}
+	void operator()() {
+		if (moveOne) {
+			scene.poses[0].m_shift[0] += 1e-3f;
+			sink += errors.update(scene.poses, scene.structure, movedCameras, movedPoints);
+		} else
+			errors.compute(scene.poses, scene.structure);
+		sink += errors.rms();
+	}
+};
+
+// the copy loop of the iterator-based drawStructure
+struct CopyStructure {
+	map<int, Point3> points;
+	vector<Vertex> out;
+	CopyStructure(const Inputs& inputs) {
+		for (size_t i=0; i<inputs.poses.size(); i++)
+			points.insert(make_pair((int)i, Point3(inputs.poses[i].x(), inputs.poses[i].y(), inputs.poses[i].z())));
+	}
+	void operator()() {
+		copyStructure(points.begin(), points.end(), points.size(), out);
+		sink += out[out.size() / 2].X;
+	}
+};
+
+// the color array the single-color drawStructure builds on every call
+struct FillColors {
+	size_t n;
+	FillColors(const Inputs& inputs) : n(inputs.poses.size()) {}
+	void operator()() {
+		std::vector<SFMColor> pointColors(n, default_camera_color);
+		sink += pointColors[n / 2].r;
+	}
+};
+
+/* ************************************************************************* */
+void run(const string& name, const size_t n, boost::function<void ()> kernel, ostream& os) {
+	if (!onlyKernel.empty() && onlyKernel != name) return;
+
+	// warm up the caches and the allocator
+	kernel();
+
+	QElapsedTimer timer;
+	vector<double> ns_per_item;
+	for (int r=0; r<numReps; r++) {
+		timer.start();
+		kernel();
+		ns_per_item.push_back((double)timer.nsecsElapsed() / n);
+	}
+	SampleStats stats = computeStats(ns_per_item);
+
+	os << "{\"bench\":\"sfmmicrobench\",\"kernel\":\"" << name << "\",\"n\":" << n << ",\"reps\":" << numReps
+		 << ",\"ns_per_item\":" << toJson(stats)
+		 << ",\"items_per_s\":" << (stats.p50 > 0. ? 1e9 / stats.p50 : 0.) << "}" << endl;
+}
+
+/* ************************************************************************* */
+// the array kernels of every supported instruction set have to reproduce the scalar ones bit by bit
+bool verifyArrayKernels(const Inputs& inputs, ostream& os) {
+	ArrayKernels reference(inputs), kernels(inputs);
+	set_simd_level(SIMD_SCALAR);
+	reference.buildRotmatrix(); reference.addQuats(); reference.buildTranMatrix(); reference.rotationToQuaternion();
+
+	bool ok = true;
+	for (int level=SIMD_SSE2; level<=simd_supported(); level++) {
+		set_simd_level((SimdLevel)level);
+		kernels.buildRotmatrix(); kernels.addQuats(); kernels.buildTranMatrix(); kernels.rotationToQuaternion();
+		const char* names[4] = {"build_rotmatrix_array", "add_quats_array", "build_tran_matrix_array", "rotation_to_quaternion_array"};
+		const vector<float>* expected[4] = {&reference.rotations, &reference.products, &reference.transforms, &reference.quaternions};
+		const vector<float>* actual[4] = {&kernels.rotations, &kernels.products, &kernels.transforms, &kernels.quaternions};
+		for (int k=0; k<4; k++) {
+			const bool same = memcmp(&(*expected[k])[0], &(*actual[k])[0], expected[k]->size() * sizeof(float)) == 0;
+			os << "{\"bench\":\"sfmmicrobench\",\"verify\":\"" << names[k] << "\",\"simd\":\"" << simd_level_name((SimdLevel)level)
+				 << "\",\"n\":" << inputs.poses.size() << ",\"identical\":" << (same ? "true" : "false") << "}" << endl;
+			ok = ok && same;
+		}
+	}
+	set_simd_level(simd_supported());
+	return ok;
+}
+
+/* ************************************************************************* */
+int main(int argc, char *argv[]) {
+	for (int i=1; i<argc; i++) {
+		string arg = argv[i];
+		string value = i + 1 < argc ? argv[i+1] : "";
+		if (arg == "--sizes")       { sizes = parseSizes(value); i++; }
+		else if (arg == "--reps")   { numReps = atoi(value.c_str()); i++; }
+		else if (arg == "--kernel") { onlyKernel = value; i++; }
+		else if (arg == "--output") { output = value; i++; }
+		else if (arg == "--verify") { verify = true; }
+		else {
+			cerr << "sfmmicrobench: unknown argument " << arg << endl;
+			return 1;
+		}
+	}
+
+	ofstream file;
+	if (!output.empty()) file.open(output.c_str());
+	ostream& os = output.empty() ? cout : file;
+
+	for (size_t i=0; i<sizes.size(); i++) {
+		size_t n = sizes[i];
+		Inputs inputs(n);
+		if (verify) {
+			if (!verifyArrayKernels(inputs, os)) return 1;
+			continue;
+		}
+
+		run("build_rotmatrix", n, BuildRotmatrix(inputs), os);
+		run("add_quats", n, AddQuats(inputs), os);
+		run("build_tran_matrix", n, BuildTranMatrix(inputs), os);
+		run("rotation_to_quaternion", n, RotationToQuaternion(inputs), os);
+		ArrayKernels arrays(inputs);
+		for (int level=SIMD_SCALAR; level<=simd_supported(); level++) {
+			set_simd_level((SimdLevel)level);
+			const string simd = string("/") + simd_level_name((SimdLevel)level);
+			run("build_rotmatrix_array" + simd, n, boost::bind(&ArrayKernels::buildRotmatrix, &arrays), os);
+			run("add_quats_array" + simd, n, boost::bind(&ArrayKernels::addQuats, &arrays), os);
+			run("build_tran_matrix_array" + simd, n, boost::bind(&ArrayKernels::buildTranMatrix, &arrays), os);
+			run("rotation_to_quaternion_array" + simd, n, boost::bind(&ArrayKernels::rotationToQuaternion, &arrays), os);
+		}
+		set_simd_level(simd_supported());
+		run("calcCameraVertices", n, CalcCameraVertices(inputs), os);
+		run("calcCameraVerticesBatch", n, CalcCameraVerticesBatch(inputs), os);
+		run("simplifyTrajectory", n, SimplifyTrajectory(inputs), os);
+		run("covisibilityGraph", n, CovisibilityGraph(inputs), os);
+		VisibilityOverlaps overlaps(inputs);
+		for (int level=SIMD_SCALAR; level<=simd_supported(); level++) {
+			set_simd_level((SimdLevel)level);
+			run(string("visibilityOverlaps/") + simd_level_name((SimdLevel)level), n, boost::ref(overlaps), os);
+		}
+		set_simd_level(simd_supported());
+		run("reprojectionErrors", n, ReprojectionErrorsKernel(inputs, false), os);
+		run("reprojectionErrorsUpdate", n, ReprojectionErrorsKernel(inputs, true), os);
+		run("copyStructure", n, CopyStructure(inputs), os);
+		run("fillColors", n, FillColors(inputs), os);
+	}
+	return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * sfmposter.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: render a scene into an image larger than any viewport, e.g. for posters and wall displays
+ *
+ *  usage: sfmposter (scene.txt | --points 1e6 --cameras 1e3 [--seed 1]) [--size 16384x16384] [--tile 2048]
+ *                   [--workers 4] [--orbit 0] [--output poster.png]
+ *
+ *  The view is the one of sfmbench at the step --orbit of its orbit, with the perspective of a window of
+ *  --size. The tiles are spread over --workers processes, by default one per core, which map the scene
+ *  published by the parent with publishSharedScene and write their tiles into a shared image file. It needs
+ *  an X display for the pixel buffers, headless machines run it under Mesa, e.g.
+ *    xvfb-run -a env LIBGL_ALWAYS_SOFTWARE=1 ./sfmposter --points 1e6 --cameras 1e3
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QStringList>
+#include <boost/bind.hpp>
+
+#include "bench.h"
+#include "camerapath.h"
+#include "poster.h"
+#include "sceneio.h"
+#include "sharedscene.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+/**
+ * poster settings
+ */
+static string filename;
+static size_t numPoints = 0, numCameras = 0;
+static unsigned int seed = 1;
+static int width = 16384, height = 16384;
+static int tileSize = 2048;
+static int numWorkers = 0;
+static int orbitStep = 0;
+static string output = "poster.png";
+
+// set in the worker processes
+static int worker = -1;
+static string sceneName, canvasFile;
+
+/* ************************************************************************* */
+void parseArguments(const QStringList& args) {
+	for (int i=1; i<args.size(); i++) {
+		string arg = args[i].toStdString();
+		string value = i + 1 < args.size() ? args[i+1].toStdString() : "";
+		if (arg == "--points")           { numPoints = parseSizes(value).at(0); i++; }
+		else if (arg == "--cameras")     { numCameras = parseSizes(value).at(0); i++; }
+		else if (arg == "--seed")        { seed = atoi(value.c_str()); i++; }
+		else if (arg == "--size")        { sscanf(value.c_str(), "%dx%d", &width, &height); i++; }
+		else if (arg == "--tile")        { tileSize = atoi(value.c_str()); i++; }
+		else if (arg == "--workers")     { numWorkers = atoi(value.c_str()); i++; }
+		else if (arg == "--orbit")       { orbitStep = atoi(value.c_str()); i++; }
+		else if (arg == "--output")      { output = value; i++; }
+		else if (arg == "--worker")      { worker = atoi(value.c_str()); i++; }
+		else if (arg == "--scene")       { sceneName = value; i++; }
+		else if (arg == "--canvas")      { canvasFile = value; i++; }
+		else if (arg.compare(0, 2, "--") != 0 && filename.empty()) filename = arg;
+		else
+			throw runtime_error("sfmposter: unknown argument " + arg);
+	}
+	if (width <= 0 || height <= 0 || tileSize <= 0)
+		throw runtime_error("sfmposter: invalid size");
+	if (numWorkers <= 0) numWorkers = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+/* ************************************************************************* */
+// the tiles of one worker, every numWorkers-th tile so that the expensive parts of the view are shared
+static void workerTiles(const int k, vector<PosterTile>& tiles) {
+	vector<PosterTile> all;
+	posterTiles(width, height, tileSize, all);
+	tiles.clear();
+	for (size_t i=k; i<all.size(); i+=numWorkers)
+		tiles.push_back(all[i]);
+}
+
+/* ************************************************************************* */
+static QuatPose posterPose() {
+	OrbitPath orbit;
+	return orbit.pose(orbitStep);
+}
+
+/* ************************************************************************* */
+// map the shared poster file, which holds width x height pixels
+static uint32_t* mapCanvas(const string& file, const bool create) {
+	const size_t bytes = (size_t)width * height * sizeof(uint32_t);
+	int fd = open(file.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0600);
+	if (fd < 0 || (create && ftruncate(fd, bytes) != 0))
+		throw runtime_error("sfmposter: can not create " + file);
+	void* pixels = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pixels == MAP_FAILED)
+		throw runtime_error("sfmposter: can not map " + file);
+	return (uint32_t*)pixels;
+}
+
+/* ************************************************************************* */
+// render the tiles of worker {worker} from the shared scene into the shared canvas
+void runWorker() {
+	SharedScene shared(sceneName);
+	OffscreenRenderer renderer(tileSize + 2 * poster_margin, tileSize + 2 * poster_margin);
+	if (!renderer.isValid())
+		throw runtime_error("sfmposter: can not create the pixel buffer");
+	Scene scene;
+	scene.add(LayerPtr(new SharedSceneLayer(&shared)));
+
+	vector<PosterTile> tiles;
+	workerTiles(worker, tiles);
+	uint32_t* pixels = mapCanvas(canvasFile, false);
+	renderPosterTiles(renderer, posterPose(), boost::bind(&Scene::draw, &scene), width, height, tiles, pixels);
+	munmap(pixels, (size_t)width * height * sizeof(uint32_t));
+}
+
+/* ************************************************************************* */
+// start the workers on {args} and wait for all of them, returns false if one of them failed
+bool runWorkers(const QStringList& args) {
+	vector<pid_t> pids;
+	for (int k=0; k<numWorkers; k++) {
+		QStringList workerArgs = args;
+		workerArgs << "--worker" << QString::number(k) << "--scene" << sceneName.c_str() << "--canvas" << canvasFile.c_str()
+				<< "--workers" << QString::number(numWorkers);
+
+		vector<string> strings;
+		for (int i=0; i<workerArgs.size(); i++) strings.push_back(workerArgs[i].toStdString());
+		vector<char*> argv;
+		for (size_t i=0; i<strings.size(); i++) argv.push_back(&strings[i][0]);
+		argv.push_back(NULL);
+
+		pid_t pid = fork();
+		if (pid == 0) {
+			execv(QApplication::applicationFilePath().toStdString().c_str(), &argv[0]);
+			_exit(127);
+		}
+		if (pid < 0) break;
+		pids.push_back(pid);
+	}
+
+	bool ok = (int)pids.size() == numWorkers;
+	for (size_t k=0; k<pids.size(); k++) {
+		int status;
+		ok = waitpid(pids[k], &status, 0) == pids[k] && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+	}
+	return ok;
+}
+
+/* ************************************************************************* */
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+	try {
+		parseArguments(app.arguments());
+		if (worker >= 0) {
+			runWorker();
+			return 0;
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+		SceneData data;
+		if (!filename.empty()) {
+			if (!loadSceneData(filename, data))
+				throw runtime_error("sfmposter: can not read " + filename);
+		} else if (numPoints || numCameras)
+			generateSyntheticScene(numPoints, numCameras, data, seed);
+		else
+			throw runtime_error("sfmposter: give a scene file or --points and --cameras");
+		const double load_ms = timer.nsecsElapsed() * 1e-6;
+
+		// the workers map the scene and the canvas instead of loading and sending them
+		timer.start();
+		const string id = QString::number(getpid()).toStdString();
+		sceneName = "/sfmposter_" + id;
+		canvasFile = QDir::tempPath().toStdString() + "/sfmposter_" + id + ".rgb";
+		publishSharedScene(sceneName, data);
+		data = SceneData();
+		uint32_t* pixels = mapCanvas(canvasFile, true);
+		const bool ok = runWorkers(app.arguments());
+		removeSharedScene(sceneName);
+		unlink(canvasFile.c_str());
+		if (!ok) {
+			munmap(pixels, (size_t)width * height * sizeof(uint32_t));
+			throw runtime_error("sfmposter: a worker failed");
+		}
+		const double render_ms = timer.nsecsElapsed() * 1e-6;
+
+		timer.start();
+		QImage poster((const uchar*)pixels, width, height, QImage::Format_RGB32);
+		const bool saved = poster.save(output.c_str());
+		munmap(pixels, (size_t)width * height * sizeof(uint32_t));
+		if (!saved)
+			throw runtime_error("sfmposter: can not write " + output);
+		const double save_ms = timer.nsecsElapsed() * 1e-6;
+
+		cout << "{\"bench\":\"sfmposter\",\"width\":" << width << ",\"height\":" << height << ",\"tile\":" << tileSize
+				 << ",\"workers\":" << numWorkers << ",\"load_ms\":" << load_ms << ",\"render_ms\":" << render_ms
+				 << ",\"save_ms\":" << save_ms << "}" << endl;
+	} catch (const exception& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * sfmremoteview.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a thin viewer that shows the frames of sfmrenderserver
+ *
+ *  usage: sfmremoteview [--address /tmp/sfmviewer.sock]
+ *
+ *  The mouse moves the camera as usual, the pose is sent to the server whenever it changes by a thread of
+ *  its own and the latencies of the last 100 frames are printed now and then.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdexcept>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "bench.h"
+#include "channel.h"
+#include "framestream.h"
+#include "main.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+// a frame of the server as the requester thread hands it to the gui thread
+struct RemoteFrame {
+	vector<uint32_t> pixels;
+	int width, height;
+	string error;  // why the requester stopped, the pixels are empty then
+	RemoteFrame() : width(0), height(0) {}
+};
+
+static FrameClient* client = NULL;      // used by the requester thread only once it runs
+static TripleBuffer<RemoteFrame> frames;
+
+// the view the gui thread wants next, guarded by the mutex
+static QMutex mutex;
+static QWaitCondition wanted;
+static bool pending = false, quitting = false;
+static QuatPose wantedPose;
+static int wantedWidth = 0, wantedHeight = 0;
+
+// the view asked for last by the gui thread
+static bool requested = false;
+static QuatPose lastPose;
+static int lastWidth = 0, lastHeight = 0;
+
+/* ************************************************************************* */
+// sends the wanted view to the server and waits for its frame, off the gui thread so that a slow server
+// does not stall painting. views wanted while a frame is on its way are merged into the latest one
+class Requester : public QThread {
+protected:
+	void run() {
+		while (true) {
+			mutex.lock();
+			while (!pending && !quitting) wanted.wait(&mutex);
+			if (quitting) {
+				mutex.unlock();
+				return;
+			}
+			const QuatPose pose = wantedPose;
+			const int width = wantedWidth, height = wantedHeight;
+			pending = false;
+			mutex.unlock();
+
+			RemoteFrame& frame = frames.back();
+			try {
+				client->request(pose, width, height);
+			} catch (exception& e) {
+				frame.pixels.clear();
+				frame.error = e.what();
+				frames.publish();
+				return;
+			}
+			frame.pixels = client->frame();
+			frame.width = client->width();
+			frame.height = client->height();
+			frames.publish();
+
+			if (client->numFrames() % 100 == 0)
+				cout << "sfmremoteview: frame_ms " << toJson(computeStats(client->latencies())) << endl;
+		}
+	}
+};
+
+static Requester* requester = NULL;
+
+/* ************************************************************************* */
+// whether {pose} at the canvas size is the view asked for last
+static bool isCurrent(const QuatPose& pose) {
+	return requested && lastWidth == canvas->width() && lastHeight == canvas->height() &&
+			equal(pose.m_shift, pose.m_shift + 3, lastPose.m_shift) && equal(pose.m_quat, pose.m_quat + 4, lastPose.m_quat);
+}
+
+/* ************************************************************************* */
+// ask for the view of the canvas if it changed and draw the latest frame of the server over the whole canvas
+void drawFrame() {
+	const QuatPose& pose = canvas->glPose();
+	if (!isCurrent(pose)) {
+		requested = true;
+		lastPose = pose;
+		lastWidth = canvas->width();
+		lastHeight = canvas->height();
+
+		mutex.lock();
+		wantedPose = lastPose;
+		wantedWidth = lastWidth;
+		wantedHeight = lastHeight;
+		pending = true;
+		wanted.wakeOne();
+		mutex.unlock();
+	}
+
+	frames.acquire();
+	const RemoteFrame& frame = frames.front();
+	if (!frame.error.empty()) {
+		cerr << frame.error << endl;
+		app->quit();
+		return;
+	}
+	if (frame.pixels.empty()) return;
+
+	// the rows are stored from the top, the overlay has its origin at the top left
+	glRasterPos2i(0, 0);
+	glPixelZoom(1.f, -1.f);
+	glDrawPixels(frame.width, frame.height, GL_BGRA, GL_UNSIGNED_BYTE, &frame.pixels[0]);
+	glPixelZoom(1.f, 1.f);
+}
+
+/* ************************************************************************* */
+// let the requester finish, a request still waiting for the server is cancelled
+static void stopRequester() {
+	mutex.lock();
+	quitting = true;
+	wanted.wakeOne();
+	mutex.unlock();
+	client->cancel();
+	requester->wait();
+}
+
+/* ************************************************************************* */
+void sfmviewer::setup()
+{
+	string address = "/tmp/sfmviewer.sock";
+	QStringList args = app->arguments();
+	for (int i=1; i+1<args.size(); i++)
+		if (args[i] == "--address") address = args[i+1].toStdString();
+
+	try {
+		client = new FrameClient(address);
+	} catch (exception& e) {
+		cerr << e.what() << endl;
+		exit(1);
+	}
+	requester = new Requester;
+	requester->start();
+	atexit(stopRequester);
+
+	canvas->scene().add(LayerPtr(new OverlayLayer(drawFrame)));
+	canvas->setGLPose(QuatPose(0., -500., 200., -1./sqrt(2.), 0., 0., 1./sqrt(2.)));
+
+	// poll the pose and the frames, the server is only asked when the pose changed
+	canvas->setRefreshInterval(15);
+}
+
+/* ************************************************************************* */
+void sfmviewer::draw() {
+}
@@ -0,0 +1,289 @@
+/*
+ * sfmrender.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: render the frames of an orbit video with worker processes sharing a directory queue
+ *
+ *  usage: sfmrender --queue dir (scene.txt | --points 1e6 --cameras 1e3 [--seed 1]) [--frames 3600] [--job 10]
+ *                   [--size 1920x1080] [--workers 4] [--timeout 60] [--die-after 0]
+ *         sfmrender --worker dir [--die-after 0]
+ *
+ *  The coordinator creates the queue of framequeue.h in dir with the settings of the workers, starts --workers
+ *  local workers and moves the jobs of workers that were silent for --timeout seconds back to the queue until
+ *  all the frames are written as dir/frame_000000.png etc. More workers on other machines join with
+ *  sfmrender --worker dir, the scene file has to be at the same path there. --die-after makes a worker exit
+ *  after as many frames without finishing its job, to try out the recovery. Given to the coordinator, it is
+ *  passed on to the local workers it starts first, their replacements run to the end. It needs an X display for the
+ *  pixel buffers, headless machines run it under Mesa, e.g.
+ *    xvfb-run -a env LIBGL_ALWAYS_SOFTWARE=1 ./sfmrender --queue /tmp/orbit --points 1e6 --cameras 1e3
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <fstream>
+#include <iostream>
+#include <QApplication>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+#include <boost/bind.hpp>
+
+#include "bench.h"
+#include "camerapath.h"
+#include "framequeue.h"
+#include "offscreen.h"
+#include "sceneio.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+/**
+ * render settings, written into the queue by the coordinator and read by the workers
+ */
+struct RenderSettings {
+	string scene;
+	size_t numPoints, numCameras;
+	unsigned int seed;
+	int numFrames;
+	int width, height;
+	double timeout;  // the seconds after which a silent worker loses its job
+	RenderSettings() : numPoints(0), numCameras(0), seed(1), numFrames(3600), width(1920), height(1080),
+			timeout(60.) {}
+};
+
+static RenderSettings settings;
+static string queueDir, workerDir;
+static int jobSize = 10;
+static int numWorkers = 0;
+static int dieAfter = 0;
+
+/* ************************************************************************* */
+void parseArguments(const QStringList& args) {
+	for (int i=1; i<args.size(); i++) {
+		string arg = args[i].toStdString();
+		string value = i + 1 < args.size() ? args[i+1].toStdString() : "";
+		if (arg == "--queue")            { queueDir = value; i++; }
+		else if (arg == "--worker")      { workerDir = value; i++; }
+		else if (arg == "--points")      { settings.numPoints = parseSizes(value).at(0); i++; }
+		else if (arg == "--cameras")     { settings.numCameras = parseSizes(value).at(0); i++; }
+		else if (arg == "--seed")        { settings.seed = atoi(value.c_str()); i++; }
+		else if (arg == "--frames")      { settings.numFrames = atoi(value.c_str()); i++; }
+		else if (arg == "--size")        { sscanf(value.c_str(), "%dx%d", &settings.width, &settings.height); i++; }
+		else if (arg == "--job")         { jobSize = atoi(value.c_str()); i++; }
+		else if (arg == "--workers")     { numWorkers = atoi(value.c_str()); i++; }
+		else if (arg == "--timeout")     { settings.timeout = atof(value.c_str()); i++; }
+		else if (arg == "--die-after")   { dieAfter = atoi(value.c_str()); i++; }
+		else if (arg.compare(0, 2, "--") != 0 && settings.scene.empty()) settings.scene = arg;
+		else
+			throw runtime_error("sfmrender: unknown argument " + arg);
+	}
+	if (queueDir.empty() == workerDir.empty())
+		throw runtime_error("sfmrender: give either --queue or --worker");
+	if (numWorkers <= 0) numWorkers = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+/* ************************************************************************* */
+void saveSettings(const string& filename) {
+	ofstream os(filename.c_str());
+	os << "scene " << (settings.scene.empty() ? "-" : settings.scene) << endl
+		 << "points " << settings.numPoints << endl << "cameras " << settings.numCameras << endl
+		 << "seed " << settings.seed << endl << "frames " << settings.numFrames << endl
+		 << "size " << settings.width << " " << settings.height << endl << "timeout " << settings.timeout << endl;
+	if (!os)
+		throw runtime_error("sfmrender: can not write " + filename);
+}
+
+/* ************************************************************************* */
+void loadSettings(const string& filename) {
+	ifstream is(filename.c_str());
+	if (!is)
+		throw runtime_error("sfmrender: can not read " + filename);
+	string tag;
+	while (is >> tag) {
+		if (tag == "scene")          { is >> settings.scene; if (settings.scene == "-") settings.scene.clear(); }
+		else if (tag == "points")    is >> settings.numPoints;
+		else if (tag == "cameras")   is >> settings.numCameras;
+		else if (tag == "seed")      is >> settings.seed;
+		else if (tag == "frames")    is >> settings.numFrames;
+		else if (tag == "size")      is >> settings.width >> settings.height;
+		else if (tag == "timeout")   is >> settings.timeout;
+		else
+			throw runtime_error("sfmrender: unknown setting " + tag);
+	}
+}
+
+/* ************************************************************************* */
+// touches a claimed job a few times per timeout while the worker renders it, however long a frame takes
+class Heartbeat : public QThread {
+public:
+	Heartbeat(FrameQueue* queue, const FrameJob* job) : queue_(queue), job_(job), stop_(false), taken_(0) {}
+
+	// stop touching the job and wait for the thread
+	void stop() {
+		mutex_.lock();
+		stop_ = true;
+		wake_.wakeAll();
+		mutex_.unlock();
+		wait();
+	}
+
+	// whether the job was given to another worker because this one was silent for too long
+	bool taken() const { return (int)taken_; }
+
+protected:
+	void run() {
+		// four times per timeout, so that a late touch or a slow file system does not lose the job
+		const unsigned long interval = (unsigned long)max(100., settings.timeout * 250.);
+		QMutexLocker locker(&mutex_);
+		while (!stop_) {
+			wake_.wait(&mutex_, interval);
+			if (!stop_ && !queue_->heartbeat(*job_)) {
+				taken_ = 1;
+				break;
+			}
+		}
+	}
+
+private:
+	FrameQueue* queue_;
+	const FrameJob* job_;
+	QMutex mutex_;
+	QWaitCondition wake_;
+	bool stop_;
+	QAtomicInt taken_;
+};
+
+/* ************************************************************************* */
+// claim jobs and render their frames until the queue is finished
+void runWorker() {
+	FrameQueue queue(workerDir);
+	loadSettings(workerDir + "/settings");
+
+	SceneData data;
+	if (!settings.scene.empty()) {
+		if (!loadSceneData(settings.scene, data))
+			throw runtime_error("sfmrender: can not read " + settings.scene);
+	} else
+		generateSyntheticScene(settings.numPoints, settings.numCameras, data, settings.seed);
+	vector<CameraVertices> cameras;
+	data.calcCameras(cameras);
+
+	OffscreenRenderer renderer(settings.width, settings.height);
+	if (!renderer.isValid())
+		throw runtime_error("sfmrender: can not create the pixel buffer");
+	Scene scene;
+	scene.add(LayerPtr(new PointLayer(&data.structure, &data.pointColors)));
+	scene.add(LayerPtr(new CameraLayer(&cameras)));
+	OrbitPath orbit;
+	orbit.segments = settings.numFrames;
+
+	char hostname[256] = "localhost";
+	gethostname(hostname, sizeof(hostname) - 1);
+	const string name = string(hostname) + "-" + QString::number(getpid()).toStdString();
+
+	int rendered = 0;
+	FrameJob job;
+	while (!queue.finished()) {
+		if (!queue.claim(name, job)) {
+			// the claimed jobs may still come back from dead workers
+			sleep(1);
+			continue;
+		}
+
+		Heartbeat heartbeat(&queue, &job);
+		heartbeat.start();
+		for (int frame=job.first; frame<=job.last && !heartbeat.taken(); frame++) {
+			// a requeued job keeps the frames its first worker finished
+			const string path = queue.framePath(frame);
+			if (access(path.c_str(), F_OK) == 0) continue;
+
+			renderer.render(orbit.pose(frame), boost::bind(&Scene::draw, &scene));
+			const string partial = path + "." + name + ".png";
+			if (!renderer.image().save(partial.c_str()) || rename(partial.c_str(), path.c_str()) != 0)
+				throw runtime_error("sfmrender: can not write " + path);
+			if (dieAfter > 0 && ++rendered == dieAfter) _exit(3);
+		}
+		heartbeat.stop();
+		if (!heartbeat.taken()) queue.complete(job);
+	}
+}
+
+/* ************************************************************************* */
+// a local worker that exits after {frames} frames if that is positive
+static pid_t startWorker(const string& program, const int frames) {
+	const string dieAfterFrames = QString::number(frames).toStdString();
+	pid_t pid = fork();
+	if (pid == 0) {
+		execl(program.c_str(), program.c_str(), "--worker", queueDir.c_str(), "--die-after", dieAfterFrames.c_str(),
+				(char*)NULL);
+		_exit(127);
+	}
+	return pid;
+}
+
+/* ************************************************************************* */
+// create the queue, start the local workers and requeue the jobs of dead ones until all frames are written
+void runCoordinator() {
+	QElapsedTimer timer;
+	timer.start();
+	FrameQueue queue(queueDir);
+	queue.create(settings.numFrames, jobSize);
+	saveSettings(queueDir + "/settings");
+
+	const string program = QApplication::applicationFilePath().toStdString();
+	vector<pid_t> workers;
+	for (int k=0; k<numWorkers; k++)
+		workers.push_back(startWorker(program, dieAfter));
+
+	// a local worker that fails is replaced a few times, the remote ones take care of themselves
+	int requeued = 0, restarts = 0, failures = 0;
+	while (!queue.finished()) {
+		sleep(1);
+		requeued += queue.requeueStale(settings.timeout);
+		for (size_t k=0; k<workers.size(); k++) {
+			int status;
+			if (workers[k] <= 0 || waitpid(workers[k], &status, WNOHANG) != workers[k]) continue;
+			workers[k] = 0;
+			if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+			failures++;
+			if (restarts < 3 * numWorkers && !queue.finished()) {
+				workers[k] = startWorker(program, 0);
+				restarts++;
+			}
+		}
+		if (count(workers.begin(), workers.end(), 0) == (long)workers.size() && !queue.finished())
+			throw runtime_error("sfmrender: all the local workers failed");
+	}
+	for (size_t k=0; k<workers.size(); k++)
+		if (workers[k] > 0) waitpid(workers[k], NULL, 0);
+
+	cout << "{\"bench\":\"sfmrender\",\"frames\":" << settings.numFrames << ",\"width\":" << settings.width
+			 << ",\"height\":" << settings.height << ",\"workers\":" << numWorkers << ",\"failures\":" << failures
+			 << ",\"requeued\":" << requeued << ",\"total_ms\":" << timer.nsecsElapsed() * 1e-6 << "}" << endl;
+}
+
+/* ************************************************************************* */
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+	try {
+		parseArguments(app.arguments());
+		if (!workerDir.empty())
+			runWorker();
+		else {
+			if (settings.scene.empty() && !settings.numPoints && !settings.numCameras)
+				throw runtime_error("sfmrender: give a scene file or --points and --cameras");
+			runCoordinator();
+		}
+	} catch (const exception& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * sfmrenderserver.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a headless renderer that owns a scene and streams frames to thin clients
+ *
+ *  usage: sfmrenderserver [--address /tmp/sfmviewer.sock] (scene.txt | --points 1e6 --cameras 1e3 [--seed 1])
+ *                         [--tile 32]
+ *
+ *  The address is a unix socket path or host:port for tcp. Clients are served one after the other, see
+ *  framestream.h for the protocol, sfmremoteview for the viewer and sfmstreambench for the latency. It needs
+ *  an X display for the pixel buffer, headless machines run it under Mesa, e.g.
+ *    xvfb-run -a env LIBGL_ALWAYS_SOFTWARE=1 ./sfmrenderserver --points 1e6 --cameras 1e3
+ */
+
+#include <unistd.h>
+#include <iostream>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "bench.h"
+#include "framestream.h"
+#include "offscreen.h"
+#include "scene.h"
+#include "sceneio.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+static string address = "/tmp/sfmviewer.sock";
+static string filename;
+static size_t numPoints = 0, numCameras = 0;
+static unsigned int seed = 1;
+static int tileSize = 32;
+
+// a pixel buffer of one size with the layers whose gpu buffers live in its context
+struct RenderTarget {
+	OffscreenRenderer renderer;
+	Scene scene;
+	RenderTarget(const int width, const int height) : renderer(width, height) {}
+};
+
+/* ************************************************************************* */
+void parseArguments(const QStringList& args) {
+	for (int i=1; i<args.size(); i++) {
+		string arg = args[i].toStdString();
+		string value = i + 1 < args.size() ? args[i+1].toStdString() : "";
+		if (arg == "--address")          { address = value; i++; }
+		else if (arg == "--points")      { numPoints = parseSizes(value).at(0); i++; }
+		else if (arg == "--cameras")     { numCameras = parseSizes(value).at(0); i++; }
+		else if (arg == "--seed")        { seed = atoi(value.c_str()); i++; }
+		else if (arg == "--tile")        { tileSize = atoi(value.c_str()); i++; }
+		else if (arg.compare(0, 2, "--") != 0 && filename.empty()) filename = arg;
+		else
+			throw runtime_error("sfmrenderserver: unknown argument " + arg);
+	}
+	if (tileSize < 1)
+		throw runtime_error("sfmrenderserver: invalid tile size");
+}
+
+/* ************************************************************************* */
+// answer the requests of one client until it disconnects
+void serve(const int fd, const SceneData& data, const vector<CameraVertices>& cameras) {
+	boost::shared_ptr<RenderTarget> target;
+	TileEncoder encoder(tileSize);
+	vector<char> payload;
+	QElapsedTimer timer;
+
+	FrameRequest request;
+	while (receiveAll(fd, &request, sizeof(request))) {
+		if (request.magic != frame_stream_magic || request.width <= 0 || request.height <= 0)
+			throw runtime_error("sfmrenderserver: invalid request");
+
+		// a new size needs a new pixel buffer and the layers uploaded into its context
+		if (!target || target->renderer.width() != request.width || target->renderer.height() != request.height) {
+			target.reset();
+			target.reset(new RenderTarget(request.width, request.height));
+			if (!target->renderer.isValid())
+				throw runtime_error("sfmrenderserver: can not create the pixel buffer");
+			target->scene.add(LayerPtr(new PointLayer(&data.structure, &data.pointColors)));
+			target->scene.add(LayerPtr(new CameraLayer(&cameras)));
+			encoder.reset();
+		}
+
+		timer.start();
+		target->renderer.render(request.pose, boost::bind(&Scene::draw, &target->scene));
+		QImage image = target->renderer.image().convertToFormat(QImage::Format_RGB32);
+		const double render_ms = timer.nsecsElapsed() * 1e-6;
+
+		timer.start();
+		payload.clear();
+		FrameHeader header;
+		header.magic = frame_stream_magic;
+		header.serial = request.serial;
+		header.width = request.width;
+		header.height = request.height;
+		header.tileSize = tileSize;
+		header.numTiles = encoder.encode((const uint32_t*)image.constBits(), image.width(), image.height(), payload);
+		header.payloadBytes = payload.size();
+		header.render_ms = render_ms;
+		header.encode_ms = timer.nsecsElapsed() * 1e-6;
+
+		sendAll(fd, &header, sizeof(header));
+		if (!payload.empty()) sendAll(fd, &payload[0], payload.size());
+	}
+}
+
+/* ************************************************************************* */
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+	try {
+		parseArguments(app.arguments());
+
+		SceneData data;
+		if (!filename.empty()) {
+			if (!loadSceneData(filename, data))
+				throw runtime_error("sfmrenderserver: can not read " + filename);
+		} else if (numPoints || numCameras)
+			generateSyntheticScene(numPoints, numCameras, data, seed);
+		else
+			throw runtime_error("sfmrenderserver: give a scene file or --points and --cameras");
+		vector<CameraVertices> cameras;
+		data.calcCameras(cameras);
+
+		int listener = listenSocket(address);
+		cout << "sfmrenderserver: " << data.structure.size() << " points and " << cameras.size()
+				 << " cameras at " << address << endl;
+		for (;;) {
+			int fd = acceptSocket(listener);
+			try {
+				serve(fd, data, cameras);
+			} catch (const exception& e) {
+				cerr << e.what() << endl;
+			}
+			close(fd);
+		}
+	} catch (const exception& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * sfmsceneserver.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: load a reconstruction once into shared memory for all the viewers on this machine
+ *
+ *  usage: sfmsceneserver [--name /sfmviewer] (scene.txt | --points 1e6 --cameras 1e3 [--seed 1])
+ *         sfmsceneserver [--name /sfmviewer] --remove
+ *
+ *  The scene stays published until the server is stopped with Ctrl-C or SIGTERM. Viewers attach
+ *  with sfmsharedview --name /sfmviewer and map the arrays read-only.
+ */
+
+#include <signal.h>
+#include <stdlib.h>
+#include <iostream>
+#include <stdexcept>
+
+#include "bench.h"
+#include "sceneio.h"
+#include "sharedscene.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+/* ************************************************************************* */
+int main(int argc, char *argv[]) {
+	string name = "/sfmviewer", filename;
+	size_t numPoints = 0, numCameras = 0;
+	unsigned int seed = 1;
+	bool remove = false;
+	try {
+		for (int i=1; i<argc; i++) {
+			string arg = argv[i];
+			string value = i + 1 < argc ? argv[i+1] : "";
+			if (arg == "--name")            { name = value; i++; }
+			else if (arg == "--points")     { numPoints = parseSizes(value).at(0); i++; }
+			else if (arg == "--cameras")    { numCameras = parseSizes(value).at(0); i++; }
+			else if (arg == "--seed")       { seed = atoi(value.c_str()); i++; }
+			else if (arg == "--remove")     remove = true;
+			else if (arg.compare(0, 2, "--") != 0 && filename.empty()) filename = arg;
+			else
+				throw runtime_error("sfmsceneserver: unknown argument " + arg);
+		}
+
+		if (remove) {
+			if (!removeSharedScene(name))
+				throw runtime_error("sfmsceneserver: no scene " + name);
+			return 0;
+		}
+
+		SceneData data;
+		if (!filename.empty()) {
+			if (!loadSceneData(filename, data))
+				throw runtime_error("sfmsceneserver: can not read " + filename);
+		} else if (numPoints || numCameras)
+			generateSyntheticScene(numPoints, numCameras, data, seed);
+		else
+			throw runtime_error("sfmsceneserver: give a scene file or --points and --cameras");
+
+		// wait for the signals from here on, so that the scene is removed whenever the server is stopped
+		sigset_t signals;
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGINT);
+		sigaddset(&signals, SIGTERM);
+		sigaddset(&signals, SIGHUP);
+		sigprocmask(SIG_BLOCK, &signals, NULL);
+
+		publishSharedScene(name, data);
+		cout << "sfmsceneserver: published " << data.structure.size() << " points and " << data.poses.size()
+				 << " cameras as " << name << endl;
+
+		// the data of the server is not needed any more, the shared memory holds the only copy
+		data = SceneData();
+		int signal;
+		sigwait(&signals, &signal);
+		removeSharedScene(name);
+	} catch (exception& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
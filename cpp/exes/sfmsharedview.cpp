@@ -0,0 +1,43 @@
+/*
+ * sfmsharedview.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a viewer of the scene published by sfmsceneserver
+ *
+ *  usage: sfmsharedview [--name /sfmviewer]
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdexcept>
+
+#include "main.h"
+#include "sharedscene.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+static SharedScene* shared = NULL;  // mapped for the lifetime of the process
+
+/* ************************************************************************* */
+void sfmviewer::setup()
+{
+	string name = "/sfmviewer";
+	QStringList args = app->arguments();
+	for (int i=1; i+1<args.size(); i++)
+		if (args[i] == "--name") name = args[i+1].toStdString();
+
+	try {
+		shared = new SharedScene(name);
+	} catch (exception& e) {
+		cerr << e.what() << endl;
+		exit(1);
+	}
+	canvas->scene().add(LayerPtr(new SharedSceneLayer(shared)));
+	canvas->setGLPose(QuatPose(0., -500., 200., -1./sqrt(2.), 0., 0., 1./sqrt(2.)));
+}
+
+/* ************************************************************************* */
+void sfmviewer::draw() {
+}
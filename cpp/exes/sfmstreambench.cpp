@@ -0,0 +1,93 @@
+/*
+ * sfmstreambench.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the frame latency of a render server, one json line
+ *
+ *  usage: sfmstreambench [--address /tmp/sfmviewer.sock] [--frames 360] [--still 60] [--size 1024x768]
+ *
+ *  Flies around the orbit of sfmbench for --frames frames and then requests the last view --still more
+ *  times, which only costs the frame headers. Start sfmrenderserver first, e.g. on the same machine.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <stdexcept>
+
+#include "bench.h"
+#include "camerapath.h"
+#include "framestream.h"
+
+using namespace std;
+using namespace sfmviewer;
+
+// the statistics of a part of the frames
+struct StreamStats {
+	vector<double> latency, render, encode;
+	double bytes;
+	StreamStats() : bytes(0.) {}
+
+	void add(const FrameTiming& timing) {
+		latency.push_back(timing.latency_ms);
+		render.push_back(timing.render_ms);
+		encode.push_back(timing.encode_ms);
+		bytes += timing.bytes;
+	}
+
+	string toJson() const {
+		stringstream ss;
+		ss << "{\"latency_ms\":" << sfmviewer::toJson(computeStats(latency))
+			 << ",\"render_ms\":" << sfmviewer::toJson(computeStats(render))
+			 << ",\"encode_ms\":" << sfmviewer::toJson(computeStats(encode))
+			 << ",\"bytes_per_frame\":" << (latency.empty() ? 0. : bytes / latency.size()) << "}";
+		return ss.str();
+	}
+};
+
+/* ************************************************************************* */
+int main(int argc, char *argv[]) {
+	string address = "/tmp/sfmviewer.sock";
+	int numFrames = 360, numStill = 60, width = 1024, height = 768;
+	try {
+		for (int i=1; i<argc; i++) {
+			string arg = argv[i];
+			string value = i + 1 < argc ? argv[i+1] : "";
+			if (arg == "--address")         { address = value; i++; }
+			else if (arg == "--frames")     { numFrames = atoi(value.c_str()); i++; }
+			else if (arg == "--still")      { numStill = atoi(value.c_str()); i++; }
+			else if (arg == "--size")       { sscanf(value.c_str(), "%dx%d", &width, &height); i++; }
+			else
+				throw runtime_error("sfmstreambench: unknown argument " + arg);
+		}
+		if (numFrames < 1 || numStill < 0)
+			throw runtime_error("sfmstreambench: invalid number of frames");
+
+		FrameClient client(address);
+		OrbitPath orbit;
+		orbit.segments = numFrames;
+
+		// the first frame is sent completely
+		client.request(orbit.pose(0), width, height);
+		const FrameTiming first = client.timing();
+
+		StreamStats moving, still;
+		for (int i=0; i<numFrames; i++) {
+			client.request(orbit.pose(i), width, height);
+			moving.add(client.timing());
+		}
+		for (int i=0; i<numStill; i++) {
+			client.request(orbit.pose(numFrames - 1), width, height);
+			still.add(client.timing());
+		}
+
+		cout << "{\"bench\":\"sfmstreambench\",\"address\":\"" << address << "\",\"width\":" << width
+				 << ",\"height\":" << height << ",\"first_ms\":" << first.latency_ms << ",\"first_bytes\":" << first.bytes
+				 << ",\"moving\":" << moving.toJson() << ",\"still\":" << still.toJson() << "}" << endl;
+	} catch (const exception& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * framequeue.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a queue of animation frames in a shared directory for render workers on several machines
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "framequeue.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	// the names of the files in {dir} in increasing order
+	static vector<string> listFiles(const string& dir) {
+		vector<string> names;
+		DIR* d = opendir(dir.c_str());
+		if (!d)
+			throw std::runtime_error("FrameQueue: can not read " + dir);
+		while (struct dirent* entry = readdir(d))
+			if (entry->d_name[0] != '.')
+				names.push_back(entry->d_name);
+		closedir(d);
+		sort(names.begin(), names.end());
+		return names;
+	}
+
+	/* ************************************************************************* */
+	// the modification time of {path} in seconds, negative if it does not exist
+	static double modificationTime(const string& path) {
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) return -1.;
+		return st.st_mtim.tv_sec + st.st_mtim.tv_nsec * 1e-9;
+	}
+
+	/* ************************************************************************* */
+	FrameQueue::FrameQueue(const string& dir) : dir_(dir) {
+		if (dir_.empty())
+			throw std::runtime_error("FrameQueue: empty directory name");
+	}
+
+	/* ************************************************************************* */
+	void FrameQueue::create(const int numFrames, const int jobSize) {
+		if (numFrames <= 0 || jobSize <= 0)
+			throw std::runtime_error("FrameQueue::create: invalid number of frames");
+		mkdir(dir_.c_str(), 0755);
+		const char* subdirs[3] = {"/pending", "/claimed", "/done"};
+		for (int i=0; i<3; i++)
+			if (mkdir((dir_ + subdirs[i]).c_str(), 0755) != 0)
+				throw std::runtime_error("FrameQueue::create: " + dir_ + subdirs[i] + ": " + strerror(errno));
+
+		// the jobs are named by their frames, so that sorting them sorts the frames
+		int numJobs = 0;
+		for (int first=0; first<numFrames; first+=jobSize, numJobs++) {
+			char name[64];
+			snprintf(name, sizeof(name), "job_%08d_%08d", first, min(first + jobSize, numFrames) - 1);
+			ofstream os((dir_ + "/pending/" + name).c_str());
+			if (!os)
+				throw std::runtime_error("FrameQueue::create: can not write " + dir_ + "/pending/" + name);
+		}
+		ofstream os((dir_ + "/jobs").c_str());
+		os << numJobs << endl;
+	}
+
+	/* ************************************************************************* */
+	bool FrameQueue::claim(const string& worker, FrameJob& job) {
+		// try the jobs in order, another worker may rename the same one first
+		vector<string> names = listFiles(dir_ + "/pending");
+		for (size_t i=0; i<names.size(); i++) {
+			const string claimed = dir_ + "/claimed/" + names[i] + "." + worker;
+			if (rename((dir_ + "/pending/" + names[i]).c_str(), claimed.c_str()) != 0) continue;
+			if (sscanf(names[i].c_str(), "job_%d_%d", &job.first, &job.last) != 2)
+				throw std::runtime_error("FrameQueue::claim: invalid job " + names[i]);
+			job.name = names[i];
+			job.claimed = claimed;
+			heartbeat(job);
+			return true;
+		}
+		return false;
+	}
+
+	/* ************************************************************************* */
+	bool FrameQueue::heartbeat(const FrameJob& job) {
+		return utimes(job.claimed.c_str(), NULL) == 0;
+	}
+
+	/* ************************************************************************* */
+	bool FrameQueue::complete(const FrameJob& job) {
+		return rename(job.claimed.c_str(), (dir_ + "/done/" + job.name).c_str()) == 0;
+	}
+
+	/* ************************************************************************* */
+	int FrameQueue::requeueStale(const double timeout) {
+		// the clock of the file system, which may differ from the one of this machine
+		const string clock = dir_ + "/.clock";
+		int fd = open(clock.c_str(), O_WRONLY | O_CREAT, 0644);
+		if (fd >= 0) close(fd);
+		utimes(clock.c_str(), NULL);
+		const double now = modificationTime(clock);
+
+		int requeued = 0;
+		vector<string> names = listFiles(dir_ + "/claimed");
+		for (size_t i=0; i<names.size(); i++) {
+			const string claimed = dir_ + "/claimed/" + names[i];
+			const double touched = modificationTime(claimed);
+			if (touched < 0. || now - touched < timeout) continue;
+			const string name = names[i].substr(0, names[i].find('.'));
+			if (rename(claimed.c_str(), (dir_ + "/pending/" + name).c_str()) == 0)
+				requeued++;
+		}
+		return requeued;
+	}
+
+	/* ************************************************************************* */
+	int FrameQueue::numPending() const {
+		return listFiles(dir_ + "/pending").size();
+	}
+
+	/* ************************************************************************* */
+	int FrameQueue::numClaimed() const {
+		return listFiles(dir_ + "/claimed").size();
+	}
+
+	/* ************************************************************************* */
+	int FrameQueue::numDone() const {
+		return listFiles(dir_ + "/done").size();
+	}
+
+	/* ************************************************************************* */
+	int FrameQueue::numJobs() const {
+		int numJobs = -1;
+		ifstream is((dir_ + "/jobs").c_str());
+		if (!(is >> numJobs))
+			throw std::runtime_error("FrameQueue: no queue in " + dir_);
+		return numJobs;
+	}
+
+	/* ************************************************************************* */
+	bool FrameQueue::finished() const {
+		return numDone() >= numJobs();
+	}
+
+	/* ************************************************************************* */
+	string FrameQueue::framePath(const int frame, const string& extension) const {
+		char name[64];
+		snprintf(name, sizeof(name), "/frame_%06d.", frame);
+		return dir_ + name + extension;
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,70 @@
+/*
+ * framequeue.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a queue of animation frames in a shared directory for render workers on several machines
+ *
+ *  The jobs are files that move by atomic renames between the subdirectories pending, claimed and done of the
+ *  queue, so the workers need nothing but the directory, e.g. on NFS. A worker renames a pending job into
+ *  claimed under its own name and keeps touching it while it renders. A job that has not been touched for a while
+ *  belongs to a dead worker and is moved back to pending by the coordinator.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace sfmviewer {
+
+	// the frames [first, last] of an animation
+	struct FrameJob {
+		int first, last;
+		std::string name;     // the file name in pending and done
+		std::string claimed;  // the path of the claimed file, empty if not claimed
+	};
+
+	class FrameQueue {
+	public:
+		// the queue in the directory {dir}
+		explicit FrameQueue(const std::string& dir);
+
+		const std::string& dir() const { return dir_; }
+
+		// coordinator: create the directories and the jobs of {numFrames} frames, {jobSize} frames per job.
+		// throws if the directory already holds a queue
+		void create(const int numFrames, const int jobSize);
+
+		// worker: move a pending job to claimed under the name {worker}, returns false if there is none
+		bool claim(const std::string& worker, FrameJob& job);
+
+		// worker: tell the coordinator that the job is making progress, returns false if the job was taken
+		// away from this worker because it was silent for too long
+		bool heartbeat(const FrameJob& job);
+
+		// worker: move a claimed job to done, returns false if it was taken away meanwhile
+		bool complete(const FrameJob& job);
+
+		// coordinator: move the claimed jobs that were not touched for {timeout} seconds back to pending,
+		// returns their number
+		int requeueStale(const double timeout);
+
+		// the number of jobs in each state and in total
+		int numPending() const;
+		int numClaimed() const;
+		int numDone() const;
+		int numJobs() const;
+
+		// whether all the jobs are done. a job moves between the states by one rename, so counting them one state
+		// after the other may see a job twice or not at all, but the done ones stay done
+		bool finished() const;
+
+		// the file name of frame {frame} in the queue directory
+		std::string framePath(const int frame, const std::string& extension = "png") const;
+
+	private:
+		std::string dir_;
+	};
+
+} // namespace sfmviewer
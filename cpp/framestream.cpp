@@ -0,0 +1,280 @@
+/*
+ * framestream.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: streaming rendered frames from a headless render server to thin clients
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <algorithm>
+#include <stdexcept>
+#include <QElapsedTimer>
+
+#include "framestream.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	size_t TileEncoder::encode(const uint32_t* pixels, const int width, const int height, vector<char>& payload) {
+		const size_t numPixels = (size_t)width * height;
+		const bool full = width != width_ || height != height_;
+		if (full) {
+			width_ = width;
+			height_ = height;
+			last_.resize(numPixels);
+		}
+
+		const int tilesX = (width + tileSize_ - 1) / tileSize_, tilesY = (height + tileSize_ - 1) / tileSize_;
+		vector<char> changed(tilesX * tilesY, full);
+		if (!full) {
+#pragma omp parallel for schedule(static)
+			for (long t=0; t<(long)changed.size(); t++) {
+				const int x0 = t % tilesX * tileSize_, y0 = t / tilesX * tileSize_;
+				const int w = min(tileSize_, width - x0), h = min(tileSize_, height - y0);
+				for (int y=y0; y<y0+h && !changed[t]; y++)
+					changed[t] = memcmp(pixels + (size_t)y * width + x0, &last_[(size_t)y * width + x0],
+							w * sizeof(uint32_t)) != 0;
+			}
+		}
+
+		size_t numTiles = 0;
+		for (size_t t=0; t<changed.size(); t++) {
+			if (!changed[t]) continue;
+			const int x0 = t % tilesX * tileSize_, y0 = t / tilesX * tileSize_;
+			const int w = min(tileSize_, width - x0), h = min(tileSize_, height - y0);
+			const uint32_t index = t;
+			size_t offset = payload.size();
+			payload.resize(offset + sizeof(index) + (size_t)w * h * sizeof(uint32_t));
+			memcpy(&payload[offset], &index, sizeof(index));
+			offset += sizeof(index);
+			for (int y=y0; y<y0+h; y++, offset += w * sizeof(uint32_t)) {
+				const uint32_t* row = pixels + (size_t)y * width + x0;
+				memcpy(&payload[offset], row, w * sizeof(uint32_t));
+				copy(row, row + w, &last_[(size_t)y * width + x0]);
+			}
+			numTiles++;
+		}
+		return numTiles;
+	}
+
+	/* ************************************************************************* */
+	void decodeTiles(const char* payload, const size_t bytes, const size_t numTiles, const int tileSize,
+			uint32_t* pixels, const int width, const int height) {
+		if (tileSize <= 0)
+			throw std::runtime_error("decodeTiles: invalid tile size");
+		const int tilesX = (width + tileSize - 1) / tileSize, tilesY = (height + tileSize - 1) / tileSize;
+		size_t offset = 0;
+		for (size_t i=0; i<numTiles; i++) {
+			uint32_t t;
+			if (offset + sizeof(t) > bytes)
+				throw std::runtime_error("decodeTiles: truncated payload");
+			memcpy(&t, payload + offset, sizeof(t));
+			offset += sizeof(t);
+			if (t >= (uint32_t)(tilesX * tilesY))
+				throw std::runtime_error("decodeTiles: tile out of the frame");
+
+			const int x0 = t % tilesX * tileSize, y0 = t / tilesX * tileSize;
+			const int w = min(tileSize, width - x0), h = min(tileSize, height - y0);
+			if (offset + (size_t)w * h * sizeof(uint32_t) > bytes)
+				throw std::runtime_error("decodeTiles: truncated payload");
+			for (int y=y0; y<y0+h; y++, offset += w * sizeof(uint32_t))
+				memcpy(pixels + (size_t)y * width + x0, payload + offset, w * sizeof(uint32_t));
+		}
+	}
+
+	/* ************************************************************************* */
+	// split host:port, returns false for a unix socket path
+	static bool parseTcpAddress(const string& address, string& host, string& port) {
+		const size_t colon = address.rfind(':');
+		if (address.empty() || address[0] == '/' || address[0] == '.' || colon == string::npos) return false;
+		host = address.substr(0, colon);
+		port = address.substr(colon + 1);
+		return true;
+	}
+
+	/* ************************************************************************* */
+	static string socketError(const string& func, const string& address) {
+		return func + ": " + address + ": " + strerror(errno);
+	}
+
+	/* ************************************************************************* */
+	// a socket bound to {address} and listening, or connected to it
+	static int openSocket(const string& address, const bool listening) {
+		const string func = listening ? "listenSocket" : "connectSocket";
+		string host, port;
+		int fd = -1;
+		if (parseTcpAddress(address, host, port)) {
+			struct addrinfo hints, *info;
+			memset(&hints, 0, sizeof(hints));
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			hints.ai_flags = listening ? AI_PASSIVE : 0;
+			if (getaddrinfo(host.empty() ? NULL : host.c_str(), port.c_str(), &hints, &info) != 0)
+				throw std::runtime_error(func + ": can not resolve " + address);
+			fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+			int ok = fd >= 0;
+			if (ok && listening) {
+				int reuse = 1;
+				setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+				ok = bind(fd, info->ai_addr, info->ai_addrlen) == 0;
+			} else if (ok)
+				ok = connect(fd, info->ai_addr, info->ai_addrlen) == 0;
+			freeaddrinfo(info);
+			if (!ok) {
+				string error = socketError(func, address);
+				if (fd >= 0) close(fd);
+				throw std::runtime_error(error);
+			}
+
+			// the requests and the frame headers are small and latency matters more than throughput
+			int noDelay = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		} else {
+			struct sockaddr_un addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sun_family = AF_UNIX;
+			if (address.size() >= sizeof(addr.sun_path))
+				throw std::runtime_error(func + ": path too long " + address);
+			strcpy(addr.sun_path, address.c_str());
+			fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (listening) unlink(address.c_str());
+			if (fd < 0 || (listening ? bind(fd, (struct sockaddr*)&addr, sizeof(addr))
+					: connect(fd, (struct sockaddr*)&addr, sizeof(addr))) != 0) {
+				string error = socketError(func, address);
+				if (fd >= 0) close(fd);
+				throw std::runtime_error(error);
+			}
+		}
+
+		if (listening && listen(fd, 4) != 0) {
+			string error = socketError(func, address);
+			close(fd);
+			throw std::runtime_error(error);
+		}
+		return fd;
+	}
+
+	/* ************************************************************************* */
+	int listenSocket(const string& address) {
+		return openSocket(address, true);
+	}
+
+	/* ************************************************************************* */
+	int acceptSocket(const int listener) {
+		int fd;
+		while ((fd = accept(listener, NULL, NULL)) < 0)
+			if (errno != EINTR)
+				throw std::runtime_error(string("acceptSocket: ") + strerror(errno));
+
+		// fails harmlessly for unix sockets
+		int noDelay = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		return fd;
+	}
+
+	/* ************************************************************************* */
+	int connectSocket(const string& address) {
+		return openSocket(address, false);
+	}
+
+	/* ************************************************************************* */
+	void sendAll(const int fd, const void* data, const size_t bytes) {
+		const char* p = (const char*)data;
+		for (size_t sent = 0; sent < bytes; ) {
+			ssize_t n = send(fd, p + sent, bytes - sent, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0)
+				throw std::runtime_error(string("sendAll: ") + strerror(errno));
+			sent += n;
+		}
+	}
+
+	/* ************************************************************************* */
+	bool receiveAll(const int fd, void* data, const size_t bytes) {
+		char* p = (char*)data;
+		for (size_t received = 0; received < bytes; ) {
+			ssize_t n = recv(fd, p + received, bytes - received, 0);
+			if (n < 0 && errno == EINTR) continue;
+			if (n < 0)
+				throw std::runtime_error(string("receiveAll: ") + strerror(errno));
+			if (n == 0) {
+				if (received == 0) return false;
+				throw std::runtime_error("receiveAll: connection closed in the middle of a message");
+			}
+			received += n;
+		}
+		return true;
+	}
+
+	/* ************************************************************************* */
+	FrameClient::FrameClient(const string& address, const size_t window) : fd_(connectSocket(address)), serial_(0),
+			width_(0), height_(0), window_(max(window, (size_t)1)), numFrames_(0) {
+		memset(&timing_, 0, sizeof(timing_));
+	}
+
+	/* ************************************************************************* */
+	FrameClient::~FrameClient() {
+		close(fd_);
+	}
+
+	/* ************************************************************************* */
+	void FrameClient::cancel() {
+		shutdown(fd_, SHUT_RDWR);
+	}
+
+	/* ************************************************************************* */
+	void FrameClient::request(const QuatPose& pose, const int width, const int height) {
+		if (width <= 0 || height <= 0)
+			throw std::runtime_error("FrameClient::request: invalid frame size");
+		QElapsedTimer timer;
+		timer.start();
+
+		FrameRequest request;
+		request.magic = frame_stream_magic;
+		request.serial = ++serial_;
+		request.width = width;
+		request.height = height;
+		request.pose = pose;
+		sendAll(fd_, &request, sizeof(request));
+
+		FrameHeader header;
+		if (!receiveAll(fd_, &header, sizeof(header)))
+			throw std::runtime_error("FrameClient::request: the server closed the connection");
+		if (header.magic != frame_stream_magic || header.serial != request.serial ||
+				header.width != width || header.height != height)
+			throw std::runtime_error("FrameClient::request: unexpected answer");
+		payload_.resize(header.payloadBytes);
+		if (header.payloadBytes && !receiveAll(fd_, &payload_[0], header.payloadBytes))
+			throw std::runtime_error("FrameClient::request: the server closed the connection");
+
+		if (width != width_ || height != height_) {
+			width_ = width;
+			height_ = height;
+			frame_.assign((size_t)width * height, 0);
+		}
+		decodeTiles(payload_.empty() ? NULL : &payload_[0], payload_.size(), header.numTiles, header.tileSize,
+				&frame_[0], width_, height_);
+
+		timing_.latency_ms = timer.nsecsElapsed() * 1e-6;
+		timing_.render_ms = header.render_ms;
+		timing_.encode_ms = header.encode_ms;
+		timing_.tiles = header.numTiles;
+		timing_.bytes = sizeof(header) + header.payloadBytes;
+		if (latencies_.size() < window_)
+			latencies_.push_back(timing_.latency_ms);
+		else
+			latencies_[numFrames_ % window_] = timing_.latency_ms;
+		numFrames_++;
+	}
+
+} // namespace sfmviewer
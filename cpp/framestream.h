@@ -0,0 +1,128 @@
+/*
+ * framestream.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: streaming rendered frames from a headless render server to thin clients
+ *
+ *  The client sends a FrameRequest with the pose and the size of the frame it wants. The server renders it and
+ *  answers with a FrameHeader followed by the tiles that differ from the frame it sent before, each as its
+ *  32 bit index followed by its pixels row by row. Both ends keep the last frame, so a still view costs a header.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "trackball.h"
+
+namespace sfmviewer {
+
+	const uint32_t frame_stream_magic = 0x53464d46;  // "SFMF"
+
+	struct FrameRequest {
+		uint32_t magic;
+		uint32_t serial;         // echoed by the answer
+		int32_t width, height;
+		QuatPose pose;
+	};
+
+	struct FrameHeader {
+		uint32_t magic;
+		uint32_t serial;
+		int32_t width, height;
+		int32_t tileSize;
+		uint32_t numTiles;       // the tiles that follow
+		uint64_t payloadBytes;   // the bytes of the tiles
+		float render_ms;         // the time the server spent on the frame
+		float encode_ms;
+	};
+
+	// cuts frames of 32 bit pixels into square tiles and keeps the tiles of the last frame, so that only the
+	// tiles that changed are encoded. a frame of a new size is encoded completely
+	class TileEncoder {
+	public:
+		TileEncoder(const int tileSize = 32) : tileSize_(tileSize), width_(0), height_(0) {}
+
+		// append the changed tiles of the {width} x {height} {pixels} to {payload}, returns their number
+		size_t encode(const uint32_t* pixels, const int width, const int height, std::vector<char>& payload);
+
+		// forget the last frame, so that the next one is encoded completely
+		void reset() { last_.clear(); width_ = height_ = 0; }
+
+		int tileSize() const { return tileSize_; }
+
+	private:
+		int tileSize_;
+		int width_, height_;
+		std::vector<uint32_t> last_;
+	};
+
+	// write {numTiles} tiles from {payload} into the {width} x {height} {pixels}, throws if the payload is malformed
+	void decodeTiles(const char* payload, const size_t bytes, const size_t numTiles, const int tileSize,
+			uint32_t* pixels, const int width, const int height);
+
+	// a stream socket listening at {address}, which is a path for a unix socket or host:port for tcp
+	int listenSocket(const std::string& address);
+
+	// wait for the next connection to {listener}
+	int acceptSocket(const int listener);
+
+	// a stream socket connected to {address}, see listenSocket
+	int connectSocket(const std::string& address);
+
+	// send or receive exactly {bytes} bytes, receiveAll returns false if the other end closed the connection
+	void sendAll(const int fd, const void* data, const size_t bytes);
+	bool receiveAll(const int fd, void* data, const size_t bytes);
+
+	// the time a frame took from sending its request to decoding its tiles
+	struct FrameTiming {
+		double latency_ms;      // the round trip seen by the client
+		double render_ms;       // the part spent rendering on the server
+		double encode_ms;
+		size_t tiles;
+		size_t bytes;           // received, including the header
+	};
+
+	// the client side of a frame stream, it keeps the frame patched by the tiles of every answer and the
+	// latencies of the last {window} frames
+	class FrameClient {
+	public:
+		explicit FrameClient(const std::string& address, const size_t window = 100);
+		~FrameClient();
+
+		// render the view from {pose} on the server and wait for its frame
+		void request(const QuatPose& pose, const int width, const int height);
+
+		// make a request waiting in another thread throw, and every later one
+		void cancel();
+
+		// the pixels of the last frame as in QImage::Format_RGB32, row by row from the top
+		const std::vector<uint32_t>& frame() const { return frame_; }
+		int width() const { return width_; }
+		int height() const { return height_; }
+
+		// the timing of the last frame, the latencies of the last frames in no particular order and the number
+		// of all frames so far
+		const FrameTiming& timing() const { return timing_; }
+		const std::vector<double>& latencies() const { return latencies_; }
+		size_t numFrames() const { return numFrames_; }
+
+	private:
+		FrameClient(const FrameClient&);
+		FrameClient& operator=(const FrameClient&);
+
+		int fd_;
+		uint32_t serial_;
+		int width_, height_;
+		std::vector<uint32_t> frame_;
+		std::vector<char> payload_;
+		FrameTiming timing_;
+		size_t window_;
+		size_t numFrames_;
+		std::vector<double> latencies_;  // at most window_, the oldest is overwritten first
+	};
+
+} // namespace sfmviewer
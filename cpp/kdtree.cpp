@@ -0,0 +1,394 @@
+/*
+ * kdtree.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a kd-tree with bounding boxes over 3D points or camera frusta
+ */
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "kdtree.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	// orders item indices by one coordinate of their first vertex
+	struct CompareAxis {
+		const Vertex* vertices;
+		size_t stride;
+		int axis;
+		CompareAxis(const Vertex* vertices0, size_t stride0, int axis0) : vertices(vertices0), stride(stride0), axis(axis0) {}
+		bool operator()(const uint32_t i, const uint32_t j) const {
+			return (&vertices[i * stride].X)[axis] < (&vertices[j * stride].X)[axis];
+		}
+	};
+
+	/* ************************************************************************* */
+	// a node and the range of item indices below it
+	struct Range {
+		size_t node;
+		uint32_t begin, end;
+	};
+
+	/* ************************************************************************* */
+	// whether the ray, widened by {tanAngle} per unit depth, enters the box in front of the origin
+	static inline bool hitsBox(const KdTree::Node& node, const float o[3], const float d[3], const float tanAngle,
+			float& tnear) {
+		// the depth of the farthest corner bounds how wide the cone gets inside the box
+		float tfar = 0.f;
+		for (int a=0; a<3; a++)
+			tfar += ((d[a] > 0.f ? node.bmax[a] : node.bmin[a]) - o[a]) * d[a];
+		if (tfar <= 0.f) return false;
+		float pad = tanAngle * tfar;
+
+		float t0 = 0.f, t1 = FLT_MAX;
+		for (int a=0; a<3; a++) {
+			float lo = node.bmin[a] - pad, hi = node.bmax[a] + pad;
+			if (fabs(d[a]) < 1e-12f) {
+				if (o[a] < lo || o[a] > hi) return false;
+				continue;
+			}
+			float ta = (lo - o[a]) / d[a], tb = (hi - o[a]) / d[a];
+			if (ta > tb) swap(ta, tb);
+			t0 = max(t0, ta);
+			t1 = min(t1, tb);
+			if (t0 > t1) return false;
+		}
+		tnear = t0;
+		return true;
+	}
+
+	/* ************************************************************************* */
+	// the squared distance from a point to the box of a node, 0 inside
+	static inline float boxDistance(const KdTree::Node& node, const float q[3]) {
+		float d2 = 0.f;
+		for (int a=0; a<3; a++) {
+			float d = max(max(node.bmin[a] - q[a], q[a] - node.bmax[a]), 0.f);
+			d2 += d * d;
+		}
+		return d2;
+	}
+
+	/* ************************************************************************* */
+	// two-sided ray triangle intersection (Moller-Trumbore)
+	static inline bool hitsTriangle(const float o[3], const float d[3], const Vertex& a, const Vertex& b, const Vertex& c,
+			float& t) {
+		float e1[3] = {b.X - a.X, b.Y - a.Y, b.Z - a.Z};
+		float e2[3] = {c.X - a.X, c.Y - a.Y, c.Z - a.Z};
+		float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+		float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+		if (fabs(det) < 1e-12f) return false;
+		float inv = 1.f / det;
+		float s[3] = {o[0] - a.X, o[1] - a.Y, o[2] - a.Z};
+		float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+		if (u < 0.f || u > 1.f) return false;
+		float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+		float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+		if (v < 0.f || u + v > 1.f) return false;
+		t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+		return t > 0.f;
+	}
+
+	/* ************************************************************************* */
+	void KdTree::build(const Vertex* points, const size_t numPoints, const size_t leafSize, const bool copyPoints) {
+		build(points, 1, 1, numPoints, leafSize);
+		if (!copyPoints) return;
+
+		leafPoints_.resize(numPoints);
+#pragma omp parallel for schedule(static)
+		for (long i=0; i<(long)numPoints; i++)
+			leafPoints_[i] = points[indices_[i]];
+	}
+
+	/* ************************************************************************* */
+	void KdTree::build(const CameraVertices* cameras, const size_t numCameras, const size_t leafSize) {
+		build(numCameras ? cameras[0].v : NULL, 5, 5, numCameras, leafSize);
+	}
+
+	/* ************************************************************************* */
+	void KdTree::clear() {
+		vertices_ = NULL;
+		vector<uint32_t>().swap(indices_);
+		vector<Node>().swap(nodes_);
+		vector<Vertex>().swap(leafPoints_);
+	}
+
+	/* ************************************************************************* */
+	void KdTree::computeBounds(Node& node, const uint32_t* begin, const uint32_t* end) const {
+		for (int a=0; a<3; a++) {
+			node.bmin[a] =  FLT_MAX;
+			node.bmax[a] = -FLT_MAX;
+		}
+		for (const uint32_t* it = begin; it != end; it++)
+			for (int k=0; k<numVertices_; k++) {
+				const GLfloat* p = &vertex(*it, k).X;
+				for (int a=0; a<3; a++) {
+					node.bmin[a] = min(node.bmin[a], p[a]);
+					node.bmax[a] = max(node.bmax[a], p[a]);
+				}
+			}
+	}
+
+	/* ************************************************************************* */
+	uint32_t* KdTree::split(const Node& node, uint32_t* begin, uint32_t* end) const {
+		int axis = 0;
+		for (int a=1; a<3; a++)
+			if (node.bmax[a] - node.bmin[a] > node.bmax[axis] - node.bmin[axis]) axis = a;
+		uint32_t* mid = begin + (end - begin) / 2;
+		nth_element(begin, mid, end, CompareAxis(vertices_, stride_, axis));
+		return mid;
+	}
+
+	/* ************************************************************************* */
+	void KdTree::buildSubtree(vector<Node>& nodes, const size_t root, uint32_t* begin, uint32_t* end,
+			const size_t leafSize) const {
+		if ((size_t)(end - begin) <= leafSize) {
+			nodes[root].first = begin - &indices_[0];
+			nodes[root].count = end - begin;
+			return;
+		}
+
+		uint32_t* mid = split(nodes[root], begin, end);
+		size_t left = nodes.size();
+		nodes.resize(left + 2);
+		nodes[root].first = left;
+		nodes[root].count = 0;
+		computeBounds(nodes[left], begin, mid);
+		computeBounds(nodes[left + 1], mid, end);
+		buildSubtree(nodes, left, begin, mid, leafSize);
+		buildSubtree(nodes, left + 1, mid, end, leafSize);
+	}
+
+	/* ************************************************************************* */
+	void KdTree::build(const Vertex* vertices, const size_t stride, const int numVertices, const size_t numItems,
+			const size_t leafSize) {
+		if (numItems >= 0xffffffffu)
+			throw runtime_error("KdTree::build: too many items");
+		if (leafSize == 0)
+			throw runtime_error("KdTree::build: the leaf size must be positive");
+
+		vertices_ = vertices;
+		stride_ = stride;
+		numVertices_ = numVertices;
+		nodes_.clear();
+		leafPoints_.clear();
+		indices_.resize(numItems);
+		for (size_t i=0; i<numItems; i++)
+			indices_[i] = i;
+		if (numItems == 0) return;
+
+		// the top of the tree is split level by level, and each level splits its nodes in parallel
+#ifdef _OPENMP
+		const size_t numTasks = 8 * omp_get_max_threads();
+#else
+		const size_t numTasks = 1;
+#endif
+		uint32_t* base = &indices_[0];
+		nodes_.resize(1);
+		computeBounds(nodes_[0], base, base + numItems);
+		Range rootRange = {0, 0, (uint32_t)numItems};
+		vector<Range> frontier(1, rootRange);
+		while (!frontier.empty() && frontier.size() < numTasks) {
+			vector<uint32_t> mids(frontier.size(), 0);
+#pragma omp parallel for schedule(dynamic)
+			for (int i=0; i<(int)frontier.size(); i++) {
+				const Range& r = frontier[i];
+				if (r.end - r.begin > leafSize)
+					mids[i] = split(nodes_[r.node], base + r.begin, base + r.end) - base;
+			}
+
+			vector<Range> next;
+			for (size_t i=0; i<frontier.size(); i++) {
+				const Range& r = frontier[i];
+				Node& node = nodes_[r.node];
+				if (mids[i] == 0) {
+					node.first = r.begin;
+					node.count = r.end - r.begin;
+					continue;
+				}
+				node.first = nodes_.size();
+				node.count = 0;
+				Range left = {nodes_.size(), r.begin, mids[i]}, right = {nodes_.size() + 1, mids[i], r.end};
+				next.push_back(left);
+				next.push_back(right);
+				nodes_.resize(nodes_.size() + 2);
+			}
+
+#pragma omp parallel for schedule(dynamic)
+			for (int i=0; i<(int)next.size(); i++)
+				computeBounds(nodes_[next[i].node], base + next[i].begin, base + next[i].end);
+			frontier.swap(next);
+		}
+
+		// the remaining subtrees are built independently and appended afterwards
+		vector<vector<Node> > subtrees(frontier.size());
+#pragma omp parallel for schedule(dynamic)
+		for (int i=0; i<(int)frontier.size(); i++) {
+			subtrees[i].push_back(nodes_[frontier[i].node]);
+			buildSubtree(subtrees[i], 0, base + frontier[i].begin, base + frontier[i].end, leafSize);
+		}
+
+		for (size_t i=0; i<frontier.size(); i++) {
+			// the local node k > 0 ends up at offset + k
+			size_t offset = nodes_.size() - 1;
+			const vector<Node>& subtree = subtrees[i];
+			nodes_[frontier[i].node] = subtree[0];
+			if (subtree[0].count == 0)
+				nodes_[frontier[i].node].first += offset;
+			for (size_t k=1; k<subtree.size(); k++) {
+				nodes_.push_back(subtree[k]);
+				if (subtree[k].count == 0)
+					nodes_.back().first += offset;
+			}
+			vector<Node>().swap(subtrees[i]);
+		}
+	}
+
+	/* ************************************************************************* */
+	bool KdTree::intersectCone(const float origin[3], const float dir[3], const float tanAngle,
+			size_t& index, float& depth) const {
+		if (nodes_.empty()) return false;
+
+		float best = FLT_MAX;
+		float tnear;
+		if (!hitsBox(nodes_[0], origin, dir, tanAngle, tnear)) return false;
+
+		// nodes and their entry depths, the nearer child is visited first
+		uint32_t stack[128];
+		float stackDepth[128];
+		int top = 0;
+		stack[top] = 0; stackDepth[top++] = tnear;
+		while (top > 0) {
+			top--;
+			if (stackDepth[top] >= best) continue;
+			const Node& node = nodes_[stack[top]];
+
+			if (node.count > 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					const Vertex& p = vertex(indices_[i]);
+					float v[3] = {p.X - origin[0], p.Y - origin[1], p.Z - origin[2]};
+					float t = v[0] * dir[0] + v[1] * dir[1] + v[2] * dir[2];
+					if (t <= 0.f || t >= best) continue;
+					float perp2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2] - t * t;
+					if (perp2 <= tanAngle * tanAngle * t * t) {
+						best = t;
+						index = indices_[i];
+					}
+				}
+				continue;
+			}
+
+			float t0, t1;
+			bool hit0 = hitsBox(nodes_[node.first], origin, dir, tanAngle, t0);
+			bool hit1 = hitsBox(nodes_[node.first + 1], origin, dir, tanAngle, t1);
+			if (hit0 && hit1 && t0 < t1) {
+				stack[top] = node.first + 1; stackDepth[top++] = t1;
+				stack[top] = node.first;     stackDepth[top++] = t0;
+			} else {
+				if (hit0) { stack[top] = node.first;     stackDepth[top++] = t0; }
+				if (hit1) { stack[top] = node.first + 1; stackDepth[top++] = t1; }
+			}
+		}
+
+		if (best == FLT_MAX) return false;
+		depth = best;
+		return true;
+	}
+
+	/* ************************************************************************* */
+	bool KdTree::intersectFrusta(const float origin[3], const float dir[3], size_t& index, float& depth) const {
+		if (nodes_.empty() || numVertices_ != 5) return false;
+
+		float best = FLT_MAX;
+		uint32_t stack[128];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = nodes_[stack[--top]];
+			float tnear;
+			if (!hitsBox(node, origin, dir, 0.f, tnear) || tnear >= best) continue;
+
+			if (node.count == 0) {
+				stack[top++] = node.first + 1;
+				stack[top++] = node.first;
+				continue;
+			}
+
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				const Vertex* v = &vertex(indices_[i]);
+				// four sides and the image plane
+				const int faces[6][3] = {{0, 1, 2}, {0, 2, 3}, {0, 3, 4}, {0, 4, 1}, {1, 2, 3}, {1, 3, 4}};
+				for (int f=0; f<6; f++) {
+					float t;
+					if (hitsTriangle(origin, dir, v[faces[f][0]], v[faces[f][1]], v[faces[f][2]], t) && t < best) {
+						best = t;
+						index = indices_[i];
+					}
+				}
+			}
+		}
+
+		if (best == FLT_MAX) return false;
+		depth = best;
+		return true;
+	}
+
+	/* ************************************************************************* */
+	size_t KdTree::nearest(const float query[3], const size_t k, uint32_t* indices, float* sqDistances) const {
+		if (nodes_.empty() || k == 0) return 0;
+
+		// the current neighbors are kept sorted, k is small enough for insertion
+		const bool copied = !leafPoints_.empty();
+		size_t found = 0;
+		uint32_t stack[128];
+		float stackDistance[128];
+		int top = 0;
+		stack[top] = 0; stackDistance[top++] = boxDistance(nodes_[0], query);
+		while (top > 0) {
+			top--;
+			if (found == k && stackDistance[top] >= sqDistances[k-1]) continue;
+			const Node& node = nodes_[stack[top]];
+
+			if (node.count > 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					const Vertex& p = copied ? leafPoints_[i] : vertex(indices_[i]);
+					float v[3] = {p.X - query[0], p.Y - query[1], p.Z - query[2]};
+					float d2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+					if (found == k && d2 >= sqDistances[k-1]) continue;
+
+					size_t j = found < k ? found++ : k - 1;
+					for (; j > 0 && sqDistances[j-1] > d2; j--) {
+						sqDistances[j] = sqDistances[j-1];
+						indices[j] = indices[j-1];
+					}
+					sqDistances[j] = d2;
+					indices[j] = indices_[i];
+				}
+				continue;
+			}
+
+			// the nearer child goes on top
+			float d0 = boxDistance(nodes_[node.first], query);
+			float d1 = boxDistance(nodes_[node.first + 1], query);
+			if (d0 < d1) {
+				stack[top] = node.first + 1; stackDistance[top++] = d1;
+				stack[top] = node.first;     stackDistance[top++] = d0;
+			} else {
+				stack[top] = node.first;     stackDistance[top++] = d0;
+				stack[top] = node.first + 1; stackDistance[top++] = d1;
+			}
+		}
+
+		return found;
+	}
+
+} // namespace sfmviewer
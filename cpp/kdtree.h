@@ -0,0 +1,90 @@
+/*
+ * kdtree.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a kd-tree with bounding boxes over 3D points or camera frusta
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "render.h"
+
+namespace sfmviewer {
+
+	class KdTree {
+
+	public:
+		// a node of the tree, the children of an interior node are stored next to each other
+		struct Node {
+			float bmin[3], bmax[3];  // the bounding box of everything below the node
+			uint32_t first;          // the left child of interior nodes, the first index of leaves
+			uint32_t count;          // the number of indices in a leaf, 0 for interior nodes
+		};
+
+		KdTree() : vertices_(NULL), stride_(1), numVertices_(1) {}
+
+		// build the tree over {numPoints} points, which have to stay alive while the tree is used. {copyPoints}
+		// keeps a copy of the points in leaf order, which saves a cache miss per visited point in nearest
+		void build(const Vertex* points, const size_t numPoints, const size_t leafSize = 16,
+				const bool copyPoints = false);
+
+		// build the tree over camera frusta, split by the optical centers but bounded by all five vertices
+		void build(const CameraVertices* cameras, const size_t numCameras, const size_t leafSize = 4);
+
+		// release the tree
+		void clear();
+
+		bool empty() const { return nodes_.empty(); }
+
+		// the number of indexed points or cameras
+		size_t size() const { return indices_.size(); }
+
+		// find the point closest to {origin} inside the cone around the unit ray {dir} whose radius grows
+		// by {tanAngle} per unit depth, returns false if there is none in front of the origin
+		bool intersectCone(const float origin[3], const float dir[3], const float tanAngle,
+				size_t& index, float& depth) const;
+
+		// find the first camera frustum hit by the unit ray {dir}, the side and image faces count
+		bool intersectFrusta(const float origin[3], const float dir[3], size_t& index, float& depth) const;
+
+		// find the {k} items whose first vertices are closest to {query}, nearest first, with their squared
+		// distances; returns how many were found, which is less than {k} only if the tree is smaller
+		size_t nearest(const float query[3], const size_t k, uint32_t* indices, float* sqDistances) const;
+
+		const std::vector<Node>& nodes() const { return nodes_; }
+		const std::vector<uint32_t>& indices() const { return indices_; }
+
+		// the points in the order of indices(), empty unless they were copied at build time
+		const std::vector<Vertex>& leafPoints() const { return leafPoints_; }
+
+	protected:
+		// the first vertex of the i-th item
+		const Vertex& vertex(const size_t i, const int k = 0) const { return vertices_[i * stride_ + k]; }
+
+		// build over items of {numVertices} vertices that are {stride} vertices apart
+		void build(const Vertex* vertices, const size_t stride, const int numVertices, const size_t numItems,
+				const size_t leafSize);
+
+		// compute the bounding box of the items in [begin, end)
+		void computeBounds(Node& node, const uint32_t* begin, const uint32_t* end) const;
+
+		// split the items of a node along the longest axis of its box, returns the first item on the right
+		uint32_t* split(const Node& node, uint32_t* begin, uint32_t* end) const;
+
+		// build the subtree of the items in [begin, end) below {root} with local node indices
+		void buildSubtree(std::vector<Node>& nodes, const size_t root, uint32_t* begin, uint32_t* end,
+				const size_t leafSize) const;
+
+		const Vertex* vertices_;
+		size_t stride_;
+		int numVertices_;
+		std::vector<uint32_t> indices_;
+		std::vector<Node> nodes_;
+		std::vector<Vertex> leafPoints_;
+	};
+
+} // namespace sfmviewer
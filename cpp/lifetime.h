@@ -0,0 +1,21 @@
+/*
+ * lifetime.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the steps of a playback in which an item is seen, shared by the timelines and the renderer
+ */
+
+#pragma once
+
+namespace sfmviewer {
+
+	// the first and the last step of a playback in which a point or camera is seen, see drawLifetimeBuffer. the
+	// two floats are the vertex attribute of the lifetime shader, so they have to stay the only members
+	struct Lifetime{
+		float first, last;
+		Lifetime(float first0, float last0) : first(first0), last(last0) {}
+		Lifetime() {}
+	};
+
+} // namespace sfmviewer
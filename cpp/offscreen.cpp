@@ -0,0 +1,62 @@
+/*
+ * offscreen.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: an opengl canvas without a window, e.g. for benchmarks and batch rendering
+ */
+
+#include <stdexcept>
+#include <QtOpenGL>
+
+#include "offscreen.h"
+#include "render.h"
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	OffscreenRenderer::OffscreenRenderer(int width, int height) : width_(width), height_(height) {
+		QGLFormat format(QGL::SampleBuffers);
+		format.setDepth(true);
+		pbuffer_ = new QGLPixelBuffer(QSize(width, height), format);
+		if (!pbuffer_->isValid())
+			return;
+
+		pbuffer_->makeCurrent();
+		setGLDefaults();
+		setGLProjection(width, height);
+	}
+
+	/* ************************************************************************* */
+	OffscreenRenderer::~OffscreenRenderer() {
+		if (pbuffer_->isValid() && pbuffer_->makeCurrent())
+			releaseDrawCache();
+		delete pbuffer_;
+	}
+
+	/* ************************************************************************* */
+	bool OffscreenRenderer::isValid() const {
+		return pbuffer_->isValid();
+	}
+
+	/* ************************************************************************* */
+	void OffscreenRenderer::makeCurrent() {
+		if (!pbuffer_->makeCurrent())
+			throw std::runtime_error("OffscreenRenderer::makeCurrent: no valid pixel buffer");
+	}
+
+	/* ************************************************************************* */
+	void OffscreenRenderer::render(const QuatPose& pose, const Callback& fun_draw) {
+		makeCurrent();
+		setGLModelView(pose);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		fun_draw();
+		glFinish();
+	}
+
+	/* ************************************************************************* */
+	QImage OffscreenRenderer::image() const {
+		return pbuffer_->toImage();
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,50 @@
+/*
+ * offscreen.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: an opengl canvas without a window, e.g. for benchmarks and batch rendering
+ */
+
+#pragma once
+
+#include <QImage>
+
+#include "scene.h"
+
+QT_FORWARD_DECLARE_CLASS(QGLPixelBuffer)
+
+namespace sfmviewer {
+
+	class OffscreenRenderer {
+
+	public:
+		// create a {width} x {height} pixel buffer, the opengl states match GLCanvas
+		OffscreenRenderer(int width, int height);
+
+		~OffscreenRenderer();
+
+		// whether the platform could create the pixel buffer
+		bool isValid() const;
+
+		int width() const { return width_; }
+		int height() const { return height_; }
+
+		// make the pixel buffer the current opengl context
+		void makeCurrent();
+
+		// draw one frame seen from {pose} and block until the GPU has finished it
+		void render(const QuatPose& pose, const Callback& fun_draw);
+
+		// read back the last rendered frame
+		QImage image() const;
+
+	private:
+		int width_;
+		int height_;
+
+		// the offscreen opengl context
+		QGLPixelBuffer* pbuffer_;
+	};
+
+} // namespace sfmviewer
@@ -0,0 +1,82 @@
+/*
+ * picking.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: find the point or the camera under the mouse cursor
+ */
+
+#include <math.h>
+
+#include "picking.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	void computePickRay(const QuatPose& pose, const int x, const int y, const int width, const int height,
+			float origin[3], float dir[3]) {
+		// the ray in opengl eye coordinates, then flipped to the camera coordinates (see m_convert)
+		float tanHalf = tan(default_fovy * M_PI / 360.);
+		float ex = (2.f * (x + 0.5f) / width - 1.f) * tanHalf * width / height;
+		float ey = (1.f - 2.f * (y + 0.5f) / height) * tanHalf;
+		float pc[3] = {ex, -ey, 1.f};
+
+		// the camera pose (R,t) maps camera coordinates to the world
+		float r[3][3];
+		build_rotmatrix(r, pose.m_quat);
+		float norm = 0.f;
+		for (int i=0; i<3; i++) {
+			origin[i] = pose.m_shift[i];
+			dir[i] = r[i][0] * pc[0] + r[i][1] * pc[1] + r[i][2] * pc[2];
+			norm += dir[i] * dir[i];
+		}
+		norm = sqrt(norm);
+		for (int i=0; i<3; i++)
+			dir[i] /= norm;
+	}
+
+	/* ************************************************************************* */
+	void Picker::setStructure(const vector<Vertex>& structure) {
+		points_ = structure.empty() ? NULL : &structure[0];
+		pointTree_.build(points_, structure.size());
+	}
+
+	/* ************************************************************************* */
+	void Picker::setCameras(const vector<CameraVertices>& cameras) {
+		cameras_ = cameras.empty() ? NULL : &cameras[0];
+		cameraTree_.build(cameras_, cameras.size());
+	}
+
+	/* ************************************************************************* */
+	PickResult Picker::pick(const QuatPose& pose, const int x, const int y, const int width, const int height,
+			const float pixelTolerance) const {
+		float origin[3], dir[3];
+		computePickRay(pose, x, y, width, height, origin, dir);
+
+		// the size of a pixel at unit depth
+		float tanAngle = pixelTolerance * 2.f * tan(default_fovy * M_PI / 360.) / height;
+
+		PickResult result;
+		size_t index;
+		float depth;
+		if (pointTree_.intersectCone(origin, dir, tanAngle, index, depth)) {
+			result.type = PickResult::POINT;
+			result.index = index;
+			result.position = points_[index];
+			result.depth = depth;
+		}
+
+		// a camera in front of the point wins
+		if (cameraTree_.intersectFrusta(origin, dir, index, depth) &&
+				(result.type == PickResult::NOTHING || depth < result.depth)) {
+			result.type = PickResult::CAMERA;
+			result.index = index;
+			result.position = cameras_[index].v[0];
+			result.depth = depth;
+		}
+		return result;
+	}
+
+} // namespace sfmviewer
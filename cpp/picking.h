@@ -0,0 +1,55 @@
+/*
+ * picking.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: find the point or the camera under the mouse cursor
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "kdtree.h"
+
+namespace sfmviewer {
+
+	// what a click hit
+	struct PickResult {
+		enum Type { NOTHING, POINT, CAMERA };
+		Type type;
+		size_t index;     // the index of the point or the camera
+		Vertex position;  // the point, or the optical center of the camera
+		float depth;      // the distance along the ray
+
+		PickResult() : type(NOTHING), index(0), position(0.f, 0.f, 0.f), depth(0.f) {}
+	};
+
+	// the unit ray through the pixel (x,y) of a {width} x {height} canvas seen from {pose},
+	// with the perspective set by setGLProjection
+	void computePickRay(const QuatPose& pose, const int x, const int y, const int width, const int height,
+			float origin[3], float dir[3]);
+
+	class Picker {
+
+	public:
+		Picker() : points_(NULL), cameras_(NULL) {}
+
+		// index the points, which have to stay alive and unchanged until the next call
+		void setStructure(const std::vector<Vertex>& structure);
+
+		// index the camera frusta, which have to stay alive and unchanged until the next call
+		void setCameras(const std::vector<CameraVertices>& cameras);
+
+		// the nearest point within {pixelTolerance} pixels of the cursor or the first frustum under it
+		PickResult pick(const QuatPose& pose, const int x, const int y, const int width, const int height,
+				const float pixelTolerance = 3.f) const;
+
+	private:
+		const Vertex* points_;
+		const CameraVertices* cameras_;
+		KdTree pointTree_;
+		KdTree cameraTree_;
+	};
+
+} // namespace sfmviewer
@@ -0,0 +1,301 @@
+/*
+ * pointfilter.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: load-time filters that thin out dense point clouds
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "pointfilter.h"
+#include "kdtree.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	static const int cellBits = 21;
+	static const int64_t cellRange = (int64_t)1 << (cellBits - 1);
+	static const uint32_t voxelBits = 24;
+	static const uint32_t voxelMask = (1u << voxelBits) - 1;
+
+	/* ************************************************************************* */
+	// the cell coordinate along one axis, clamped to 21 bits so that three of them fit into a key
+	static inline uint64_t cellCoordinate(const float x, const float invSize) {
+		double c = floor((double)x * invSize);
+		if (!(c >= -cellRange)) c = -cellRange;  // also catches NaN
+		if (c > cellRange - 1) c = cellRange - 1;
+		return (uint64_t)((int64_t)c + cellRange);
+	}
+
+	/* ************************************************************************* */
+	static inline uint64_t cellKey(const Vertex& p, const float invSize) {
+		return (cellCoordinate(p.X, invSize) << (2 * cellBits)) | (cellCoordinate(p.Y, invSize) << cellBits) |
+				cellCoordinate(p.Z, invSize);
+	}
+
+	/* ************************************************************************* */
+	// the top bits of the splitmix64 finalizer, neighboring cells end up in unrelated partitions
+	static inline int partitionOf(uint64_t key) {
+		key ^= key >> 30; key *= 0xbf58476d1ce4e5b9ULL;
+		key ^= key >> 27; key *= 0x94d049bb133111ebULL;
+		key ^= key >> 31;
+		return (int)(key >> 56);
+	}
+
+	/* ************************************************************************* */
+	void PointMapping::keepRows(const vector<uint32_t>& rows) {
+		vector<uint32_t> newOffsets(1, 0), newSources;
+		newOffsets.reserve(rows.size() + 1);
+		for (size_t r=0; r<rows.size(); r++) {
+			newSources.insert(newSources.end(), sources.begin() + offsets[rows[r]], sources.begin() + offsets[rows[r] + 1]);
+			newOffsets.push_back(newSources.size());
+		}
+		offsets.swap(newOffsets);
+		sources.swap(newSources);
+	}
+
+	/* ************************************************************************* */
+	VoxelGrid::VoxelGrid(const float voxelSize, const bool keepSources) :
+		keepSources_(keepSources), hasColors_(false), numSources_(0), partitions_(numPartitions) {
+		if (voxelSize <= 0.f)
+			throw std::runtime_error("VoxelGrid: the voxel size has to be positive");
+		invSize_ = 1.f / voxelSize;
+	}
+
+	/* ************************************************************************* */
+	size_t VoxelGrid::numVoxels() const {
+		size_t total = 0;
+		for (int p=0; p<numPartitions; p++)
+			total += partitions_[p].voxels.size();
+		return total;
+	}
+
+	/* ************************************************************************* */
+	void VoxelGrid::add(const Vertex* points, const SFMColor* colors, const size_t n) {
+		if (n == 0) return;
+		if (numSources_ == 0)
+			hasColors_ = colors != NULL;
+		else if (hasColors_ != (colors != NULL))
+			throw std::runtime_error("VoxelGrid::add: either all or none of the chunks need colors");
+		if (numSources_ + n > 0xffffffffULL)
+			throw std::runtime_error("VoxelGrid::add: too many source points for 32-bit indices");
+
+		keys_.resize(n);
+#pragma omp parallel for schedule(static)
+		for (long i=0; i<(long)n; i++)
+			keys_[i] = cellKey(points[i], invSize_);
+
+		// counting sort of the points by partition, each block is scanned in order so that
+		// the points of one partition keep their source order
+		int numBlocks = 1;
+#ifdef _OPENMP
+		numBlocks = omp_get_max_threads();
+#endif
+		vector<size_t> cursors(numBlocks * numPartitions, 0);
+#pragma omp parallel for schedule(static)
+		for (int b=0; b<numBlocks; b++) {
+			size_t* count = &cursors[b * numPartitions];
+			for (size_t i = n * b / numBlocks; i < n * (b + 1) / numBlocks; i++)
+				count[partitionOf(keys_[i])]++;
+		}
+
+		vector<size_t> starts(numPartitions + 1);
+		size_t total = 0;
+		for (int p=0; p<numPartitions; p++) {
+			starts[p] = total;
+			for (int b=0; b<numBlocks; b++) {
+				size_t count = cursors[b * numPartitions + p];
+				cursors[b * numPartitions + p] = total;
+				total += count;
+			}
+		}
+		starts[numPartitions] = total;
+
+		order_.resize(n);
+#pragma omp parallel for schedule(static)
+		for (int b=0; b<numBlocks; b++) {
+			size_t* cursor = &cursors[b * numPartitions];
+			for (size_t i = n * b / numBlocks; i < n * (b + 1) / numBlocks; i++)
+				order_[cursor[partitionOf(keys_[i])]++] = i;
+		}
+
+		// every partition is accumulated by a single thread
+		if (keepSources_) voxelOf_.resize(numSources_ + n);
+		// a partition out of voxel indices stops without adding the cell, so the lookup never names a missing voxel
+		vector<char> overflow(numPartitions, 0);
+#pragma omp parallel for schedule(dynamic)
+		for (int p=0; p<numPartitions; p++) {
+			Partition& partition = partitions_[p];
+			for (size_t j=starts[p]; j<starts[p+1]; j++) {
+				const uint32_t i = order_[j];
+				const Vertex& point = points[i];
+				boost::unordered_map<uint64_t, uint32_t>::iterator found = partition.lookup.find(keys_[i]);
+				if (found == partition.lookup.end()) {
+					if (partition.voxels.size() > voxelMask) { overflow[p] = 1; break; }
+					found = partition.lookup.insert(make_pair(keys_[i], (uint32_t)partition.voxels.size())).first;
+					Voxel voxel;
+					voxel.sum[0] = voxel.sum[1] = voxel.sum[2] = 0.;
+					voxel.color[0] = voxel.color[1] = voxel.color[2] = voxel.color[3] = 0.f;
+					voxel.count = 0;
+					voxel.first = numSources_ + i;
+					partition.voxels.push_back(voxel);
+				}
+
+				const uint32_t index = found->second;
+				Voxel& voxel = partition.voxels[index];
+				voxel.sum[0] += point.X; voxel.sum[1] += point.Y; voxel.sum[2] += point.Z;
+				if (colors) {
+					const SFMColor& color = colors[i];
+					voxel.color[0] += color.r; voxel.color[1] += color.g;
+					voxel.color[2] += color.b; voxel.color[3] += color.alpha;
+				}
+				voxel.count++;
+				if (keepSources_) voxelOf_[numSources_ + i] = ((uint32_t)p << voxelBits) | index;
+			}
+		}
+		if (find(overflow.begin(), overflow.end(), 1) != overflow.end())
+			throw std::runtime_error("VoxelGrid::add: too many voxels, try a larger voxel size");
+
+		numSources_ += n;
+	}
+
+	/* ************************************************************************* */
+	void VoxelGrid::finish(vector<Vertex>& structure, vector<SFMColor>& colors, PointMapping* mapping) const {
+		if (mapping && !keepSources_)
+			throw std::runtime_error("VoxelGrid::finish: the sources were not kept for the mapping");
+
+		// the voxels of all partitions in the order of their first source point
+		vector<pair<uint32_t, uint32_t> > firsts;
+		firsts.reserve(numVoxels());
+		for (int p=0; p<numPartitions; p++)
+			for (size_t v=0; v<partitions_[p].voxels.size(); v++)
+				firsts.push_back(make_pair(partitions_[p].voxels[v].first, ((uint32_t)p << voxelBits) | v));
+		sort(firsts.begin(), firsts.end());
+
+		const size_t numVoxels = firsts.size();
+		structure.resize(numVoxels);
+		colors.clear();
+		if (hasColors_) colors.resize(numVoxels, SFMColor(0.f, 0.f, 0.f, 1.f));
+#pragma omp parallel for schedule(static)
+		for (long k=0; k<(long)numVoxels; k++) {
+			const uint32_t id = firsts[k].second;
+			const Voxel& voxel = partitions_[id >> voxelBits].voxels[id & voxelMask];
+			const double inv = 1. / voxel.count;
+			structure[k] = Vertex(voxel.sum[0] * inv, voxel.sum[1] * inv, voxel.sum[2] * inv);
+			if (hasColors_)
+				colors[k] = SFMColor(voxel.color[0] * inv, voxel.color[1] * inv, voxel.color[2] * inv, voxel.color[3] * inv);
+		}
+
+		if (!mapping) return;
+
+		// the output index of every voxel and the row sizes
+		vector<vector<uint32_t> > rank(numPartitions);
+		for (int p=0; p<numPartitions; p++)
+			rank[p].resize(partitions_[p].voxels.size());
+		mapping->offsets.resize(numVoxels + 1);
+		mapping->offsets[0] = 0;
+		for (size_t k=0; k<numVoxels; k++) {
+			const uint32_t id = firsts[k].second;
+			rank[id >> voxelBits][id & voxelMask] = k;
+			mapping->offsets[k+1] = mapping->offsets[k] + partitions_[id >> voxelBits].voxels[id & voxelMask].count;
+		}
+
+		// scatter the sources in increasing order into their rows
+		vector<uint32_t> cursor(mapping->offsets.begin(), mapping->offsets.end() - 1);
+		mapping->sources.resize(numSources_);
+		for (size_t i=0; i<numSources_; i++) {
+			const uint32_t id = voxelOf_[i];
+			mapping->sources[cursor[rank[id >> voxelBits][id & voxelMask]]++] = i;
+		}
+	}
+
+	/* ************************************************************************* */
+	void voxelDownsample(const vector<Vertex>& structure, const vector<SFMColor>& pointColors,
+			const float voxelSize, vector<Vertex>& outStructure, vector<SFMColor>& outColors, PointMapping* mapping) {
+		if (!pointColors.empty() && pointColors.size() != structure.size())
+			throw std::runtime_error("voxelDownsample: the numbers of points and colors differ");
+
+		VoxelGrid grid(voxelSize, mapping != NULL);
+		if (!structure.empty())
+			grid.add(&structure[0], pointColors.empty() ? NULL : &pointColors[0], structure.size());
+		grid.finish(outStructure, outColors, mapping);
+	}
+
+	/* ************************************************************************* */
+	void meanNeighborDistances(const vector<Vertex>& structure, const size_t k, vector<float>& distances) {
+		const size_t n = structure.size();
+		distances.assign(n, 0.f);
+		if (n < 2 || k == 0) return;
+
+		KdTree tree;
+		tree.build(&structure[0], n, 8, true);
+		const vector<Vertex>& points = tree.leafPoints();
+		const vector<uint32_t>& order = tree.indices();
+
+#pragma omp parallel
+		{
+			// one more neighbor than asked for, as every point finds itself
+			vector<uint32_t> indices(k + 1);
+			vector<float> sqDistances(k + 1);
+
+			// the queries go in leaf order, so that consecutive ones visit the same nodes
+#pragma omp for schedule(dynamic, 4096)
+			for (long j=0; j<(long)n; j++) {
+				const uint32_t i = order[j];
+				size_t found = tree.nearest(&points[j].X, k + 1, &indices[0], &sqDistances[0]);
+
+				// skip the point itself, or the farthest neighbor if duplicates hid it
+				double sum = 0.;
+				size_t count = 0;
+				for (size_t m=0; m<found && count<k; m++) {
+					if (indices[m] == i) continue;
+					sum += sqrt(sqDistances[m]);
+					count++;
+				}
+				distances[i] = count ? sum / count : 0.f;
+			}
+		}
+	}
+
+	/* ************************************************************************* */
+	void removeOutliers(vector<Vertex>& structure, vector<SFMColor>& pointColors, const size_t k,
+			const float sigma, vector<uint32_t>* kept) {
+		if (!pointColors.empty() && pointColors.size() != structure.size())
+			throw std::runtime_error("removeOutliers: the numbers of points and colors differ");
+
+		vector<float> distances;
+		meanNeighborDistances(structure, k, distances);
+
+		const size_t n = structure.size();
+		double sum = 0., sum2 = 0.;
+#pragma omp parallel for reduction(+:sum, sum2)
+		for (long i=0; i<(long)n; i++) {
+			sum += distances[i];
+			sum2 += (double)distances[i] * distances[i];
+		}
+		const double mean = n ? sum / n : 0.;
+		const double stddev = n ? sqrt(max(sum2 / n - mean * mean, 0.)) : 0.;
+		const float threshold = mean + sigma * stddev;
+
+		// compact in place, the order of the points is kept
+		if (kept) kept->clear();
+		size_t m = 0;
+		for (size_t i=0; i<n; i++) {
+			if (distances[i] > threshold) continue;
+			structure[m] = structure[i];
+			if (!pointColors.empty()) pointColors[m] = pointColors[i];
+			if (kept) kept->push_back(i);
+			m++;
+		}
+		structure.resize(m);
+		if (!pointColors.empty()) pointColors.resize(m, SFMColor(0.f, 0.f, 0.f, 1.f));
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,98 @@
+/*
+ * pointfilter.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: load-time filters that thin out dense point clouds
+ */
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+
+#include "render.h"
+
+namespace sfmviewer {
+
+	// which source points a filtered point came from, in compressed rows: the sources of
+	// point i are sources[offsets[i]] ... sources[offsets[i+1]-1] in increasing order
+	struct PointMapping {
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> sources;
+
+		size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+		uint32_t numSources(const size_t i) const { return offsets[i+1] - offsets[i]; }
+
+		// keep only the listed rows, e.g. after more points were filtered out
+		void keepRows(const std::vector<uint32_t>& rows);
+	};
+
+	// averages the points and colors falling into each cell of a regular grid. the points may be
+	// added in chunks while a file is read, so that the raw cloud never has to be in memory at once
+	class VoxelGrid {
+	public:
+
+		// {voxelSize} is the edge length of the cells, {keepSources} remembers the cell of every
+		// source point for the mapping, which costs four bytes per source point
+		VoxelGrid(const float voxelSize, const bool keepSources = true);
+
+		// add {n} points, {colors} may be NULL, the source indices continue from the last chunk. throws if a
+		// partition runs out of voxel indices, the grid then holds a part of the chunk and stays safe to read
+		void add(const Vertex* points, const SFMColor* colors, const size_t n);
+
+		// the number of points added and the number of occupied cells so far
+		size_t numSources() const { return numSources_; }
+		size_t numVoxels() const;
+
+		// the averaged points ordered by their first source point, {colors} stays empty if no
+		// colors were added, {mapping} is only filled if the sources were kept
+		void finish(std::vector<Vertex>& structure, std::vector<SFMColor>& colors,
+				PointMapping* mapping = NULL) const;
+
+		// the cells are spread over this many hash tables which are filled in parallel
+		static const int numPartitions = 256;
+
+	private:
+
+		struct Voxel {
+			double sum[3];
+			float color[4];
+			uint32_t count;
+			uint32_t first;
+		};
+
+		struct Partition {
+			boost::unordered_map<uint64_t, uint32_t> lookup;  // cell key to the index in voxels
+			std::vector<Voxel> voxels;
+		};
+
+		float invSize_;
+		bool keepSources_;
+		bool hasColors_;
+		size_t numSources_;
+		std::vector<Partition> partitions_;
+
+		// the partition in the top 8 bits and the voxel in the lower 24 bits for every source point
+		std::vector<uint32_t> voxelOf_;
+
+		// scratch space of add, kept to avoid reallocating for every chunk
+		std::vector<uint64_t> keys_;
+		std::vector<uint32_t> order_;
+	};
+
+	// downsample a whole cloud in one go, see VoxelGrid
+	void voxelDownsample(const std::vector<Vertex>& structure, const std::vector<SFMColor>& pointColors,
+			const float voxelSize, std::vector<Vertex>& outStructure, std::vector<SFMColor>& outColors,
+			PointMapping* mapping = NULL);
+
+	// the mean distance of every point to its {k} nearest neighbors, searched in parallel on a kd-tree
+	void meanNeighborDistances(const std::vector<Vertex>& structure, const size_t k, std::vector<float>& distances);
+
+	// statistical outlier removal: drop the points whose mean distance to their {k} nearest neighbors is more than
+	// {sigma} standard deviations above the average, {kept} receives the original indices of the remaining points
+	void removeOutliers(std::vector<Vertex>& structure, std::vector<SFMColor>& pointColors, const size_t k,
+			const float sigma, std::vector<uint32_t>* kept = NULL);
+
+} // namespace sfmviewer
@@ -0,0 +1,127 @@
+/*
+ * polyline.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: level of detail for long polylines such as camera trajectories
+ */
+
+#include <math.h>
+#include <limits>
+#include <algorithm>
+
+#include "polyline.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	PolylineLod::PolylineLod(const size_t chunkSize) : chunkSize_(max(chunkSize, (size_t)2)) {
+	}
+
+	/* ************************************************************************* */
+	void PolylineLod::update(const vector<Vertex>& points, const size_t begin) {
+		const size_t n = points.size();
+
+		// the last vertex of the previous update was the end of a chunk, so its chunk has to be redone
+		const size_t firstChunk = begin > 0 && begin <= n ? (begin - 1) / chunkSize_ : 0;
+		const size_t numChunks = n < 2 ? 0 : (n - 2) / chunkSize_ + 1;
+		errors_.resize(n);
+		if (n == 1) errors_[0] = numeric_limits<float>::infinity();
+
+		// the ends of the chunks are shared by their neighbors, so they are set here rather than in the chunks
+		for (size_t c=firstChunk; c<numChunks; c++)
+			errors_[c * chunkSize_] = numeric_limits<float>::infinity();
+		if (numChunks > 0) errors_[n - 1] = numeric_limits<float>::infinity();
+
+#pragma omp parallel for schedule(dynamic)
+		for (long c=firstChunk; c<(long)numChunks; c++)
+			simplificationErrors(&points[0], c * chunkSize_, min((c + 1) * chunkSize_, n - 1), &errors_[0]);
+
+		// the levels are brought up to date when they are asked for
+		const size_t valid = firstChunk * chunkSize_;
+		for (map<int, Level>::iterator it = levels_.begin(); it != levels_.end(); ++it)
+			it->second.valid = min(it->second.valid, valid);
+	}
+
+	/* ************************************************************************* */
+	int PolylineLod::level(const float tolerance) {
+		if (!(tolerance > 0.f)) return numeric_limits<int>::min();
+		int exponent;
+		frexp(tolerance, &exponent);
+		return exponent - 1;
+	}
+
+	/* ************************************************************************* */
+	const vector<uint32_t>& PolylineLod::simplify(const float tolerance, size_t* firstChanged) {
+		const int exponent = level(tolerance);
+		const float threshold = exponent == numeric_limits<int>::min() ? -1.f : ldexp(1.f, exponent);
+
+		map<int, Level>::iterator it = levels_.find(exponent);
+		if (it == levels_.end()) {
+			Level empty = {vector<uint32_t>(), 0};
+			it = levels_.insert(make_pair(exponent, empty)).first;
+		}
+
+		// drop the indices of the vertices that changed and append the new ones
+		Level& level = it->second;
+		vector<uint32_t>::iterator keep = lower_bound(level.indices.begin(), level.indices.end(), (uint32_t)level.valid);
+		const size_t changed = keep - level.indices.begin();
+		level.indices.erase(keep, level.indices.end());
+		for (size_t i=level.valid; i<errors_.size(); i++)
+			if (errors_[i] > threshold)
+				level.indices.push_back(i);
+		level.valid = errors_.size();
+
+		if (firstChanged) *firstChanged = changed;
+		return level.indices;
+	}
+
+	/* ************************************************************************* */
+	// the squared distance of {p} to the segment from {a} to {b}
+	static inline float segmentDistance2(const Vertex& p, const Vertex& a, const Vertex& b) {
+		const float dx = b.X - a.X, dy = b.Y - a.Y, dz = b.Z - a.Z;
+		const float wx = p.X - a.X, wy = p.Y - a.Y, wz = p.Z - a.Z;
+		const float len2 = dx * dx + dy * dy + dz * dz;
+		float t = len2 > 0.f ? (wx * dx + wy * dy + wz * dz) / len2 : 0.f;
+		t = min(max(t, 0.f), 1.f);
+		const float ex = wx - t * dx, ey = wy - t * dy, ez = wz - t * dz;
+		return ex * ex + ey * ey + ez * ez;
+	}
+
+	/* ************************************************************************* */
+	// the vertices [first, last] still to be split, under a split with {error}
+	struct PolylineSegment {
+		size_t first, last;
+		float error;
+	};
+
+	/* ************************************************************************* */
+	void simplificationErrors(const Vertex* points, const size_t begin, const size_t end, float* errors) {
+		// split the segments at their farthest vertex, which is kept as long as the tolerance is below its
+		// distance and the tolerances of the splits above it
+		vector<PolylineSegment> stack;
+		PolylineSegment all = {begin, end, numeric_limits<float>::infinity()};
+		stack.push_back(all);
+		while (!stack.empty()) {
+			const PolylineSegment s = stack.back();
+			stack.pop_back();
+			if (s.last - s.first < 2) continue;
+
+			size_t farthest = s.first + 1;
+			float maxDistance2 = -1.f;
+			for (size_t i=s.first+1; i<s.last; i++) {
+				const float d2 = segmentDistance2(points[i], points[s.first], points[s.last]);
+				if (d2 > maxDistance2) { maxDistance2 = d2; farthest = i; }
+			}
+
+			const float error = min(sqrtf(maxDistance2), s.error);
+			errors[farthest] = error;
+			PolylineSegment left = {s.first, farthest, error}, right = {farthest, s.last, error};
+			stack.push_back(left);
+			stack.push_back(right);
+		}
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,58 @@
+/*
+ * polyline.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: level of detail for long polylines such as camera trajectories
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "render.h"
+
+namespace sfmviewer {
+
+	// the Douglas-Peucker simplifications of a growing polyline at every tolerance. the polyline is cut into
+	// chunks whose ends are always kept, the chunks are simplified in parallel and appending vertices only
+	// simplifies the last chunk again. the simplification at a tolerance is materialized when it is asked for
+	class PolylineLod {
+	public:
+		PolylineLod(const size_t chunkSize = 4096);
+
+		// simplify {points} again from the vertex {begin} on, the vertices before it are assumed unchanged
+		void update(const std::vector<Vertex>& points, const size_t begin = 0);
+
+		// the number of vertices in the last update
+		size_t size() const { return errors_.size(); }
+
+		// the largest tolerance at which Douglas-Peucker keeps vertex {i}, infinite for the ends of the chunks
+		float error(const size_t i) const { return errors_[i]; }
+
+		// the indices of the vertices kept at {tolerance} in increasing order. the tolerance is rounded down to a
+		// power of two, so that the answer can be kept for the next frames. {firstChanged} receives the first
+		// position that differs from the last answer at the same level
+		const std::vector<uint32_t>& simplify(const float tolerance, size_t* firstChanged = NULL);
+
+		// the level of simplify that answers for {tolerance}
+		static int level(const float tolerance);
+
+	private:
+		struct Level {
+			std::vector<uint32_t> indices;
+			size_t valid;     // the vertices whose indices are up to date
+		};
+
+		size_t chunkSize_;
+		std::vector<float> errors_;
+		std::map<int, Level> levels_;  // by the exponent of the tolerance
+	};
+
+	// the Douglas-Peucker errors of the vertices (begin, end) of a polyline, see PolylineLod::error. the errors of
+	// the two ends are left to the caller, they are infinite as the ends are always kept
+	void simplificationErrors(const Vertex* points, const size_t begin, const size_t end, float* errors);
+
+} // namespace sfmviewer
@@ -0,0 +1,75 @@
+/*
+ * poster.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: rendering images larger than the viewport tile by tile
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "poster.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	void posterTiles(const int width, const int height, const int tileSize, vector<PosterTile>& tiles) {
+		if (width <= 0 || height <= 0 || tileSize <= 0)
+			throw std::runtime_error("posterTiles: invalid size");
+		tiles.clear();
+		for (int y=0; y<height; y+=tileSize)
+			for (int x=0; x<width; x+=tileSize) {
+				PosterTile tile = {x, y, min(tileSize, width - x), min(tileSize, height - y)};
+				tiles.push_back(tile);
+			}
+	}
+
+	/* ************************************************************************* */
+	void setGLPosterProjection(const int width, const int height, const PosterTile& tile, const int margin) {
+		// the frustum of gluPerspective in setGLProjection, cut at the pixel boundaries of the tile
+		const double top = default_near * tan(default_fovy * M_PI / 360.);
+		const double right = top * width / height;
+		const int bottom = height - tile.y - tile.height;  // opengl counts the rows from the bottom
+		const double x0 = tile.x - margin, x1 = tile.x + tile.width + margin;
+		const double y0 = bottom - margin, y1 = bottom + tile.height + margin;
+
+		glMatrixMode(GL_PROJECTION);
+		glViewport(0, 0, tile.width + 2 * margin, tile.height + 2 * margin);
+		glLoadIdentity();
+		glFrustum(right * (2. * x0 / width - 1.), right * (2. * x1 / width - 1.),
+				top * (2. * y0 / height - 1.), top * (2. * y1 / height - 1.), default_near, default_far);
+		glMatrixMode(GL_MODELVIEW);
+	}
+
+	/* ************************************************************************* */
+	void renderPosterTiles(OffscreenRenderer& renderer, const QuatPose& pose, const Callback& fun_draw,
+			const int width, const int height, const vector<PosterTile>& tiles, uint32_t* pixels, const int margin) {
+		vector<uint32_t> rows;
+		renderer.makeCurrent();
+		for (size_t i=0; i<tiles.size(); i++) {
+			const PosterTile& tile = tiles[i];
+			if (tile.width + 2 * margin > renderer.width() || tile.height + 2 * margin > renderer.height())
+				throw std::runtime_error("renderPosterTiles: the tiles and margins do not fit into the renderer");
+
+			setGLPosterProjection(width, height, tile, margin);
+			renderer.render(pose, fun_draw);
+
+			// the rows come from the bottom, the pixel buffer has no meaningful alpha
+			rows.resize((size_t)tile.width * tile.height);
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+			glReadPixels(margin, margin, tile.width, tile.height, GL_BGRA, GL_UNSIGNED_BYTE, &rows[0]);
+			for (int r=0; r<tile.height; r++) {
+				const uint32_t* src = &rows[(size_t)(tile.height - 1 - r) * tile.width];
+				uint32_t* dst = pixels + (size_t)(tile.y + r) * width + tile.x;
+				for (int c=0; c<tile.width; c++)
+					dst[c] = src[c] | 0xff000000u;
+			}
+		}
+		setGLProjection(renderer.width(), renderer.height());
+	}
+
+} // namespace sfmviewer
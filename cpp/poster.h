@@ -0,0 +1,42 @@
+/*
+ * poster.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: rendering images larger than the viewport tile by tile
+ */
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "offscreen.h"
+
+namespace sfmviewer {
+
+	// the widest point or line in pixels that is drawn completely across the seams of the tiles
+	const int poster_margin = 16;
+
+	// a rectangle of a poster in pixels from the top left
+	struct PosterTile {
+		int x, y, width, height;
+	};
+
+	// cut a {width} x {height} poster into tiles of at most {tileSize} x {tileSize} pixels, row by row
+	void posterTiles(const int width, const int height, const int tileSize, std::vector<PosterTile>& tiles);
+
+	// load the part of the perspective of setGLProjection for a {width} x {height} canvas that {tile} sees,
+	// widened by {margin} pixels on every side, and a viewport of the tile and the margins. the tile covers
+	// exactly the pixels it covers in the whole poster, so that the seams are invisible
+	void setGLPosterProjection(const int width, const int height, const PosterTile& tile, const int margin);
+
+	// render {tiles} of a {width} x {height} poster seen from {pose} one after the other into {pixels}, which
+	// holds the whole poster as in QImage::Format_RGB32. the renderer needs the size of the tiles plus the
+	// margins. the margins are drawn but not kept, so that points and lines whose center is in the neighbor
+	// tile are not clipped at the seam
+	void renderPosterTiles(OffscreenRenderer& renderer, const QuatPose& pose, const Callback& fun_draw,
+			const int width, const int height, const std::vector<PosterTile>& tiles, uint32_t* pixels,
+			const int margin = poster_margin);
+
+} // namespace sfmviewer
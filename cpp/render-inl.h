@@ -8,8 +8,11 @@
 
 #pragma once
 
+#include <string.h>
+#include <stdexcept>
 #include <boost/foreach.hpp>
 #include "render.h"
+#include "camerabatch.h"
 #include "trackball.h"
 
 
@@ -19,29 +22,63 @@ namespace sfmviewer {
 
 	/* ************************************************************************* */
 	template <class KeyPointIterator>
-	void drawStructure(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
-			const std::vector<SFMColor>& pointColors = std::vector<SFMColor>()) {
-		vector<Vertex> structure;
+	void copyStructure(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
+			std::vector<Vertex>& structure) {
+		structure.clear();
 		structure.reserve(numPoints);
 		while (keyPointBegin != keyPointEnd) {
 			structure.push_back(Vertex(keyPointBegin->second.x(), keyPointBegin->second.y(), keyPointBegin->second.z()));
 			keyPointBegin++;
 		}
-		drawStructure(structure, pointColors);
 	}
 
 	/* ************************************************************************* */
+	// converts the points straight into the gpu buffer in parallel chunks, unless the {generation} says they are
+	// the same as last frame
 	template <class KeyPointIterator>
-	void drawStructure(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
-			const SFMColor& color) {
-		vector<Vertex> structure;
-		structure.reserve(numPoints);
-		std::vector<SFMColor> pointColors(numPoints, color);
-		while (keyPointBegin != keyPointEnd) {
-			structure.push_back(Vertex(keyPointBegin->second.x(), keyPointBegin->second.y(), keyPointBegin->second.z()));
-			keyPointBegin++;
+	void drawStructureAdapter(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
+			const std::vector<SFMColor>* pointColors, const SFMColor& color, const uint64_t generation) {
+		if (keyPointBegin == keyPointEnd) return;
+		if (pointColors && pointColors->size() != numPoints)
+			throw std::runtime_error("DrawStructure: no. of colors != no. of points");
+
+		CachedPoints cache(&*keyPointBegin, numPoints, pointColors ? &(*pointColors)[0] : NULL, generation);
+		if (Vertex* points = cache.points()) {
+			// a single walk over the container finds the starts of the chunks
+			const size_t chunkSize = 1 << 16;
+			vector<KeyPointIterator> starts;
+			size_t count = 0;
+			for (KeyPointIterator it = keyPointBegin; it != keyPointEnd; ++it, ++count)
+				if (count % chunkSize == 0) starts.push_back(it);
+			if (count != numPoints) {
+				invalidateDrawCache(&*keyPointBegin);
+				throw std::runtime_error("DrawStructure: no. of points in the container != numPoints");
+			}
+
+#pragma omp parallel for schedule(dynamic)
+			for (long c=0; c<(long)starts.size(); c++) {
+				KeyPointIterator it = starts[c];
+				const size_t end = min(count, (c + 1) * chunkSize);
+				for (size_t i = c * chunkSize; i < end; i++, ++it)
+					points[i] = Vertex(it->second.x(), it->second.y(), it->second.z());
+			}
 		}
-		drawStructure(structure, pointColors);
+		cache.draw(color);
+	}
+
+	/* ************************************************************************* */
+	template <class KeyPointIterator>
+	void drawStructure(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
+			const std::vector<SFMColor>& pointColors, const uint64_t generation) {
+		drawStructureAdapter(keyPointBegin, keyPointEnd, numPoints, pointColors.empty() ? NULL : &pointColors,
+				default_point_color, generation);
+	}
+
+	/* ************************************************************************* */
+	template <class KeyPointIterator>
+	void drawStructure(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
+			const SFMColor& color, const uint64_t generation) {
+		drawStructureAdapter(keyPointBegin, keyPointEnd, numPoints, NULL, color, generation);
 	}
 
 	/* ************************************************************************* */
@@ -91,14 +128,38 @@ namespace sfmviewer {
 		return cam_vertices;
 	}
 
+	/* ************************************************************************* */
+	// gather the poses and intrinsics of keyed cameras into {batch}, the skew of the calibration is ignored
+	template<class KeyCameraIterator>
+	void fillCameraBatch(KeyCameraIterator keyCameraBegin, KeyCameraIterator keyCameraEnd, const size_t numCameras,
+			CameraBatch& batch) {
+		batch.resize(numCameras);
+		size_t k = 0;
+		for (; keyCameraBegin != keyCameraEnd && k < numCameras; ++keyCameraBegin, k++) {
+			const Matrix r = keyCameraBegin->second.pose().rotation().matrix();
+			float R[3][3];
+			for (int i=0; i<3; i++)
+				for (int j=0; j<3; j++)
+					R[i][j] = r(i,j);
+			float center[3];
+			center[0] = keyCameraBegin->second.pose().x();
+			center[1] = keyCameraBegin->second.pose().y();
+			center[2] = keyCameraBegin->second.pose().z();
+			batch.set(k, R, center, keyCameraBegin->second.calibration().fx(), keyCameraBegin->second.calibration().fy(),
+					keyCameraBegin->second.calibration().px(), keyCameraBegin->second.calibration().py());
+		}
+		if (k != numCameras || keyCameraBegin != keyCameraEnd)
+			throw std::runtime_error("fillCameraBatch: numCameras does not match the cameras");
+	}
+
 	/* ************************************************************************* */
 	template<class KeyCameraIterator, class Camera, class Point2, class Point3>
 	vector<CameraVertices> calcCameraVertices(KeyCameraIterator keyCameraBegin, KeyCameraIterator keyCameraEnd, const size_t numCameras,
 			const int img_w, const int img_h, const float scale) {
+		CameraBatch batch;
+		fillCameraBatch(keyCameraBegin, keyCameraEnd, numCameras, batch);
 		vector<CameraVertices> vertices_all;
-		vertices_all.reserve(numCameras);
-		while(keyCameraBegin != keyCameraEnd)
-			vertices_all.push_back(calcCameraVertices<Camera, Point2, Point3>((keyCameraBegin++)->second, img_w, img_h, scale));
+		calcCameraVertices(batch, img_w, img_h, scale, vertices_all);
 		return vertices_all;
 	}
 
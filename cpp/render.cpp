@@ -6,16 +6,22 @@
  *  Description: the rendering functions for different elements
  */
 
+#include <string.h>
+#include <map>
 #include <stdexcept>
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <QGLBuffer>
+#include <QGLShaderProgram>
 
 #include "render.h"
 #include "trackball.h"
-#include "bunny.h"
+#include "selection.h"
+#include "assets.h"
 
 using namespace std;
 
-#define SFM_POINT_COLOR          0.0f, 0.0f, 0.0f, 1.0f
+#define SFM_BACKGROUND_COLOR     1.0f, 1.0f, 1.0f, 1.0f
 #define SFM_CAMERA_COLOR  240.f/255.f, 140.0f/255.f, 24.0f/255.f,  1.0f
 
 #define DRAWONERECT(X1,Y1,Z1,X2,Y2,Z2,X3,Y3,Z3,X4,Y4,Z4) \
@@ -32,8 +38,118 @@ using namespace std;
 namespace sfmviewer {
 
 	/* ************************************************************************* */
-	void drawStructure(const vector<Vertex>& structure,
-			const vector<SFMColor>& pointColors) {
+	// the conversion matrix from OpenGL default coordinate system
+	//  to the camera coordiante system:
+	// [ 1  0  0  0] * [ x ] = [ x ]
+	//   0 -1  0  0      y      -y
+	//   0  0 -1  0      z      -z
+	//   0  0  0  1      1       1
+	const GLfloat m_convert[4][4] = {
+			{1.,  0.,  0., 0.},
+			{0., -1.,  0., 0.},
+			{0.,	0., -1., 0.},
+			{0.,  0.,  0., 1.}};
+
+	/* ************************************************************************* */
+	void setGLDefaults() {
+		// remove back faces
+		glEnable( GL_CULL_FACE);
+		glEnable( GL_DEPTH_TEST);
+		glEnable(GL_MULTISAMPLE);
+
+		// speedups
+		glEnable(GL_DITHER);
+		glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_FASTEST);
+		glHint(GL_POLYGON_SMOOTH_HINT, GL_FASTEST);
+		glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+		glEnable( GL_POINT_SMOOTH);
+
+		glClearColor(SFM_BACKGROUND_COLOR);
+	}
+
+	/* ************************************************************************* */
+	void setGLProjection(int width, int height) {
+		// the calibration matrix only depends on the window aspect ratio
+		glMatrixMode( GL_PROJECTION);
+
+		// set the viewport size
+		glViewport(0, 0, width, height);
+
+		glLoadIdentity();
+		gluPerspective(default_fovy, (GLfloat) width / height, default_near, default_far); // the 3rd parameter
+		glMatrixMode( GL_MODELVIEW);
+	}
+
+	/* ************************************************************************* */
+	void setGLModelView(const QuatPose& pose) {
+		glMatrixMode( GL_MODELVIEW);
+		glLoadIdentity();
+		GLfloat prj[4][4];
+		build_tran_matrix(pose, prj);
+		glMultTransposeMatrixf((GLfloat*)m_convert); // second, convert the camera coordinates to the opengl camera coordinates
+		glMultTransposeMatrixf((GLfloat*)prj);       // first, project the points in the world coordinates to the camera coorrdinates
+	}
+
+	/* ************************************************************************* */
+	VertexBuffer::~VertexBuffer() {
+		delete buffer_;
+	}
+
+	/* ************************************************************************* */
+	void VertexBuffer::allocate(const size_t bytes, const uint64_t version) {
+		if (!buffer_) {
+			buffer_ = new QGLBuffer(indices_ ? QGLBuffer::IndexBuffer : QGLBuffer::VertexBuffer);
+			buffer_->setUsagePattern(QGLBuffer::StaticDraw);
+			if (!buffer_->create())
+				throw std::runtime_error("VertexBuffer::allocate: buffer objects are not supported");
+		}
+		buffer_->bind();
+		if (bytes != bytes_) buffer_->allocate(bytes);
+		buffer_->release();
+		bytes_ = bytes;
+		version_ = version;
+	}
+
+	/* ************************************************************************* */
+	void VertexBuffer::write(const size_t offset, const void* data, const size_t bytes) {
+		if (!buffer_ || offset + bytes > bytes_)
+			throw std::runtime_error("VertexBuffer::write: out of the allocated range");
+		if (bytes == 0) return;
+		buffer_->bind();
+		buffer_->write(offset, data, bytes);
+		buffer_->release();
+	}
+
+	/* ************************************************************************* */
+	bool VertexBuffer::bind() const {
+		return buffer_ && buffer_->bind();
+	}
+
+	/* ************************************************************************* */
+	void VertexBuffer::release() const {
+		if (buffer_) buffer_->release();
+	}
+
+	/* ************************************************************************* */
+	void* VertexBuffer::map() {
+		if (!buffer_ || !buffer_->bind()) return NULL;
+		void* data = buffer_->map(QGLBuffer::WriteOnly);
+		buffer_->release();
+		return data;
+	}
+
+	/* ************************************************************************* */
+	bool VertexBuffer::unmap() {
+		if (!buffer_ || !buffer_->bind()) return false;
+		bool intact = buffer_->unmap();
+		buffer_->release();
+		return intact;
+	}
+
+	/* ************************************************************************* */
+	// draw points from client memory or, with a bound buffer object, from offsets into it
+	static void drawPointArrays(const GLvoid* vertices, const GLvoid* colors, const size_t numPoints,
+			const SFMColor& color = default_point_color) {
 
 		// enable blending
 		glEnable( GL_BLEND);
@@ -42,28 +158,408 @@ namespace sfmviewer {
 		// point rendering setting
 		glPointSize(1.0);
 
-		if (!structure.empty()) {
+		if (numPoints > 0) {
 			// set points to draw
 			glEnableClientState( GL_VERTEX_ARRAY);
-			glVertexPointer(3, GL_FLOAT, 0, (GLvoid*) &structure[0]);
+			glVertexPointer(3, GL_FLOAT, 0, vertices);
 
 			// set colors if available
-			if (!pointColors.empty()) {
-				if (pointColors.size() != structure.size())
-					throw std::runtime_error("DrawStructure: no. of colors != no. of points");
+			if (colors) {
 				glEnableClientState( GL_COLOR_ARRAY);
-				glColorPointer(4, GL_FLOAT, 0, (GLvoid*) &pointColors[0]);
+				glColorPointer(4, GL_FLOAT, 0, colors);
 			} else
-				glColor4f(SFM_POINT_COLOR);
+				glColor4f(color.r, color.g, color.b, color.alpha);
 
 			// draw the points
-			glDrawArrays(GL_POINTS, 0, structure.size());
+			glDrawArrays(GL_POINTS, 0, numPoints);
+			glDisableClientState(GL_COLOR_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
 		}
 
 		glDisable(GL_BLEND);
 	}
 
+	/* ************************************************************************* */
+	void drawBuffer(const GLenum mode, const VertexBuffer& buffer, const size_t vertexOffset, const size_t colorOffset,
+			const size_t count) {
+		if (count == 0 || !buffer.bind()) return;
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glVertexPointer(3, GL_FLOAT, 0, (const GLvoid*)vertexOffset);
+		glColorPointer(4, GL_FLOAT, 0, (const GLvoid*)colorOffset);
+		glDrawArrays(mode, 0, count);
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		buffer.release();
+	}
+
+	/* ************************************************************************* */
+	// the buffer holding a vector drawn in an earlier frame, and the size and the generation it was uploaded for
+	struct CachedArrays {
+		VertexBuffer buffer;
+		size_t size;
+		uint64_t generation;
+		uint64_t lastUse;
+	};
+
+	// the address of the data and of the colors, or a hash of a fixed color
+	typedef pair<const void*, uint64_t> ArrayKey;
+	typedef map<ArrayKey, boost::shared_ptr<CachedArrays> > ArrayCache;
+
+	// the vectors of one opengl context by their addresses, so that drawing a vector in different colors
+	// keeps a buffer for each
+	struct ContextCache {
+		ArrayCache arrays;
+		uint64_t tick;
+		bool unsupported;
+		ContextCache() : tick(0), unsupported(false) {}
+	};
+
+	static const size_t maxCachedArrays = 64;
+	static map<const QGLContext*, ContextCache> drawCaches;
+
+	/* ************************************************************************* */
+	// the key of the vectors drawn in a fixed {color} instead of their own colors
+	static uint64_t colorKey(const SFMColor& color) {
+		uint32_t bits[4];
+		memcpy(bits, &color, sizeof(bits));
+		uint64_t hash = 14695981039346656037ULL;
+		for (int i=0; i<4; i++)
+			hash = (hash ^ bits[i]) * 1099511628211ULL;
+		return hash;
+	}
+
+	/* ************************************************************************* */
+	// the cached buffer of the vector {key} with {size} elements, {upload} tells whether the caller has to fill
+	// it because the size or the {generation} changed. returns NULL if the context has no buffer objects
+	static VertexBuffer* cachedArrays(const ArrayKey& key, const size_t size, const uint64_t generation, bool& upload) {
+		ContextCache& cache = drawCaches[QGLContext::currentContext()];
+		if (cache.unsupported) return NULL;
+
+		boost::shared_ptr<CachedArrays>& entry = cache.arrays[key];
+		if (!entry) {
+			// make room by dropping the vector that was not drawn for the longest time
+			if (cache.arrays.size() > maxCachedArrays) {
+				ArrayCache::iterator oldest = cache.arrays.end();
+				for (ArrayCache::iterator it = cache.arrays.begin(); it != cache.arrays.end(); ++it)
+					if (it->second && (oldest == cache.arrays.end() || it->second->lastUse < oldest->second->lastUse))
+						oldest = it;
+				cache.arrays.erase(oldest);
+			}
+			entry.reset(new CachedArrays);
+			entry->size = 0;
+			entry->generation = uncached;
+		}
+
+		entry->lastUse = ++cache.tick;
+		upload = !entry->buffer.isCurrent(1) || entry->size != size || entry->generation != generation;
+		if (upload) {
+			entry->size = size;
+			entry->generation = generation;
+		}
+		return &entry->buffer;
+	}
+
+	/* ************************************************************************* */
+	// upload {vertices} followed by {colors} into {buffer}, either may be NULL to be written later.
+	// marks the context as unsupported if it fails
+	static bool uploadCachedArrays(VertexBuffer& buffer, const void* vertices, const size_t vertexBytes,
+			const void* colors, const size_t colorBytes) {
+		try {
+			buffer.allocate(vertexBytes + colorBytes, 1);
+		} catch (const std::runtime_error&) {
+			ContextCache& cache = drawCaches[QGLContext::currentContext()];
+			cache.unsupported = true;
+			cache.arrays.clear();
+			return false;
+		}
+		if (vertices) buffer.write(0, vertices, vertexBytes);
+		if (colors) buffer.write(vertexBytes, colors, colorBytes);
+		return true;
+	}
+
+	/* ************************************************************************* */
+	void invalidateDrawCache(const void* data) {
+		for (map<const QGLContext*, ContextCache>::iterator it = drawCaches.begin(); it != drawCaches.end(); ++it) {
+			for (ArrayCache::iterator entry = it->second.arrays.begin(); entry != it->second.arrays.end(); ++entry)
+				if (entry->second && (data == NULL || entry->first.first == data))
+					entry->second->generation = uncached;
+		}
+	}
+
+	/* ************************************************************************* */
+	void releaseDrawCache() {
+		drawCaches.erase(QGLContext::currentContext());
+	}
+
+	/* ************************************************************************* */
+	void drawStructure(const vector<Vertex>& structure,
+			const vector<SFMColor>& pointColors, const uint64_t generation) {
+		if (!pointColors.empty() && pointColors.size() != structure.size())
+			throw std::runtime_error("DrawStructure: no. of colors != no. of points");
+		if (structure.empty()) return;
+
+		// reuse the buffer of an earlier frame if the caller says the points and colors are the same
+		const size_t numPoints = structure.size();
+		const SFMColor* colors = pointColors.empty() ? NULL : &pointColors[0];
+		bool upload;
+		VertexBuffer* buffer = generation == uncached ? NULL :
+				cachedArrays(ArrayKey(&structure[0], (uintptr_t)colors), numPoints, generation, upload);
+		if (buffer && (!upload || uploadCachedArrays(*buffer, &structure[0], numPoints * sizeof(Vertex),
+				colors, colors ? numPoints * sizeof(SFMColor) : 0)))
+			drawStructure(*buffer, numPoints, colors != NULL);
+		else
+			drawPointArrays(&structure[0], colors, numPoints);
+	}
+
+	/* ************************************************************************* */
+	// looks up the bits of the points in the selection textures by gl_VertexID
+	static const char* selection_vertex_shader =
+			"#version 120\n"
+			"#extension GL_EXT_gpu_shader4 : require\n"
+			"uniform sampler2D selected;\n"
+			"uniform sampler2D hidden;\n"
+			"uniform int useHidden;\n"
+			"uniform int rowLength;\n"
+			"uniform vec4 highlight;\n"
+			"varying vec4 color;\n"
+			"bool bitOf(sampler2D mask, int i) {\n"
+			"  int byteIndex = i / 8;\n"
+			"  int value = int(texelFetch2D(mask, ivec2(byteIndex % rowLength, byteIndex / rowLength), 0).r * 255.0 + 0.5);\n"
+			"  return ((value >> (i % 8)) & 1) != 0;\n"
+			"}\n"
+			"void main() {\n"
+			"  gl_Position = ftransform();\n"
+			"  color = bitOf(selected, gl_VertexID) ? highlight : gl_Color;\n"
+			"  if (useHidden != 0 && bitOf(hidden, gl_VertexID))\n"
+			"    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n" // outside of the clip volume
+			"}\n";
+
+	static const char* color_fragment_shader =
+			"varying vec4 color;\n"
+			"void main() {\n"
+			"  gl_FragColor = color;\n"
+			"}\n";
+
+	// colors the vertices by their number with a blue-cyan-yellow-red ramp
+	static const char* trajectory_vertex_shader =
+			"#version 120\n"
+			"#extension GL_EXT_gpu_shader4 : require\n"
+			"uniform float lastVertex;\n"
+			"varying vec4 color;\n"
+			"void main() {\n"
+			"  gl_Position = ftransform();\n"
+			"  float t = float(gl_VertexID) / max(lastVertex, 1.0);\n"
+			"  color = vec4(clamp(1.5 - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0), 1.0);\n"
+			"}\n";
+
+	// hides the vertices before the first step of their lifetime and fades them out after the last one
+	static const char* lifetime_vertex_shader =
+			"#version 120\n"
+			"attribute vec2 lifetime;\n"
+			"uniform float currentStep;\n"
+			"uniform float fade;\n"
+			"varying vec4 color;\n"
+			"void main() {\n"
+			"  gl_Position = ftransform();\n"
+			"  color = currentStep <= lifetime.y ? gl_Color : vec4(gl_Color.rgb, gl_Color.a * fade);\n"
+			"  if (currentStep < lifetime.x)\n"
+			"    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n" // outside of the clip volume
+			"}\n";
+
+	typedef map<const QGLContext*, QGLShaderProgram*> ContextPrograms;
+
+	/* ************************************************************************* */
+	// the program of {vertexShader} in the current opengl context, NULL if the context can not run it
+	static QGLShaderProgram* contextProgram(ContextPrograms& programs, const char* vertexShader) {
+		const QGLContext* context = QGLContext::currentContext();
+		ContextPrograms::const_iterator it = programs.find(context);
+		if (it != programs.end()) return it->second;
+
+		QGLShaderProgram* program = new QGLShaderProgram;
+		if (!program->addShaderFromSourceCode(QGLShader::Vertex, vertexShader) ||
+				!program->addShaderFromSourceCode(QGLShader::Fragment, color_fragment_shader) ||
+				!program->link()) {
+			delete program;
+			program = NULL;
+		}
+		programs[context] = program;
+		return program;
+	}
+
+	/* ************************************************************************* */
+	static QGLShaderProgram* selectionProgram() {
+		static ContextPrograms programs;
+		return contextProgram(programs, selection_vertex_shader);
+	}
+
+	/* ************************************************************************* */
+	static QGLShaderProgram* trajectoryProgram() {
+		static ContextPrograms programs;
+		return contextProgram(programs, trajectory_vertex_shader);
+	}
+
+	/* ************************************************************************* */
+	static QGLShaderProgram* lifetimeProgram() {
+		static ContextPrograms programs;
+		return contextProgram(programs, lifetime_vertex_shader);
+	}
+
+	/* ************************************************************************* */
+	// bind the selection textures and the shader, returns NULL if the context can not run it
+	static QGLShaderProgram* bindSelection(const Selection& selected, const Selection* hidden, const SFMColor& highlight) {
+		QGLShaderProgram* program = selectionProgram();
+		if (!program) return NULL;
+
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, selected.texture());
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, hidden ? hidden->texture() : selected.texture());
+		glActiveTexture(GL_TEXTURE0);
+
+		program->bind();
+		program->setUniformValue("selected", 1);
+		program->setUniformValue("hidden", 2);
+		program->setUniformValue("useHidden", hidden ? 1 : 0);
+		program->setUniformValue("rowLength", Selection::textureWidth);
+		program->setUniformValue("highlight", highlight.r, highlight.g, highlight.b, highlight.alpha);
+		return program;
+	}
+
+	/* ************************************************************************* */
+	void drawStructure(const vector<Vertex>& structure, const vector<SFMColor>& pointColors,
+			const Selection& selected, const Selection* hidden, const SFMColor& highlight, const uint64_t generation) {
+		if (selected.size() != structure.size() || (hidden && hidden->size() != structure.size()))
+			throw std::runtime_error("DrawStructure: no. of selection bits != no. of points");
+
+		QGLShaderProgram* program = bindSelection(selected, hidden, highlight);
+		drawStructure(structure, pointColors, generation);
+		if (program) program->release();
+	}
+
+	/* ************************************************************************* */
+	void drawStructure(const VertexBuffer& buffer, const size_t numPoints, const bool hasColors,
+			const Selection* selected, const Selection* hidden, const SFMColor& highlight) {
+		if ((selected && selected->size() != numPoints) || (hidden && hidden->size() != numPoints))
+			throw std::runtime_error("DrawStructure: no. of selection bits != no. of points");
+		if (numPoints == 0 || !buffer.bind()) return;
+
+		QGLShaderProgram* program = NULL;
+		if (selected) program = bindSelection(*selected, hidden, highlight);
+		drawPointArrays((const GLvoid*)0, hasColors ? (const GLvoid*)(numPoints * sizeof(Vertex)) : NULL, numPoints);
+		if (program) program->release();
+		buffer.release();
+	}
+
+	/* ************************************************************************* */
+	void drawStructure(const VertexBuffer& buffer, const size_t numPoints, const SFMColor& color) {
+		if (numPoints == 0 || !buffer.bind()) return;
+		drawPointArrays((const GLvoid*)0, NULL, numPoints, color);
+		buffer.release();
+	}
+
+	/* ************************************************************************* */
+	void drawTrajectory(const VertexBuffer& vertices, const size_t numVertices, const VertexBuffer& indices,
+			const size_t numIndices, const SFMColor& color, const GLfloat linewidth) {
+		if (numIndices < 2 || !vertices.bind()) return;
+		if (!indices.bind()) {
+			vertices.release();
+			return;
+		}
+
+		QGLShaderProgram* program = trajectoryProgram();
+		if (program) {
+			program->bind();
+			program->setUniformValue("lastVertex", (GLfloat)(numVertices - 1));
+		} else
+			glColor4f(color.r, color.g, color.b, color.alpha);
+
+		glLineWidth(linewidth);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(3, GL_FLOAT, 0, (const GLvoid*)0);
+		glDrawElements(GL_LINE_STRIP, numIndices, GL_UNSIGNED_INT, (const GLvoid*)0);
+		glDisableClientState(GL_VERTEX_ARRAY);
+
+		if (program) program->release();
+		indices.release();
+		vertices.release();
+	}
+
+	/* ************************************************************************* */
+	void drawLifetimeBuffer(const GLenum mode, const VertexBuffer& buffer, const size_t vertexOffset,
+			const size_t colorOffset, const size_t lifetimeOffset, const size_t count, const GLfloat step,
+			const GLfloat fade) {
+		if (count == 0 || !buffer.bind()) return;
+
+		QGLShaderProgram* program = lifetimeProgram();
+		int location = -1;
+		if (program) {
+			program->bind();
+			program->setUniformValue("currentStep", step);
+			program->setUniformValue("fade", fade);
+			location = program->attributeLocation("lifetime");
+			if (location >= 0) {
+				program->enableAttributeArray(location);
+				program->setAttributeBuffer(location, GL_FLOAT, lifetimeOffset, 2);
+			}
+		}
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glVertexPointer(3, GL_FLOAT, 0, (const GLvoid*)vertexOffset);
+		glColorPointer(4, GL_FLOAT, 0, (const GLvoid*)colorOffset);
+		glDrawArrays(mode, 0, count);
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+
+		if (location >= 0) program->disableAttributeArray(location);
+		if (program) program->release();
+		buffer.release();
+	}
+
+	/* ************************************************************************* */
+	CachedPoints::CachedPoints(const void* key, const size_t numPoints, const SFMColor* pointColors,
+			const uint64_t generation) : key_(key), buffer_(NULL), points_(NULL), mapped_(false), numPoints_(numPoints),
+			pointColors_(pointColors) {
+		bool upload = true;
+		if (generation != uncached)
+			buffer_ = cachedArrays(ArrayKey(key, (uintptr_t)pointColors), numPoints, generation, upload);
+		if (buffer_ && !upload) return;
+
+		// the colors go in right away, the points are written by the caller into the mapped buffer
+		const size_t vertexBytes = numPoints * sizeof(Vertex);
+		if (buffer_ && !uploadCachedArrays(*buffer_, NULL, vertexBytes, pointColors,
+				pointColors ? numPoints * sizeof(SFMColor) : 0))
+			buffer_ = NULL;
+		if (buffer_ && (points_ = (Vertex*)buffer_->map()) != NULL) {
+			mapped_ = true;
+			return;
+		}
+		staging_.resize(numPoints);
+		points_ = numPoints ? &staging_[0] : NULL;
+	}
+
+	/* ************************************************************************* */
+	CachedPoints::~CachedPoints() {
+		if (mapped_) buffer_->unmap();
+	}
+
+	/* ************************************************************************* */
+	void CachedPoints::draw(const SFMColor& color) {
+		if (mapped_) {
+			mapped_ = false;
+			if (!buffer_->unmap()) invalidateDrawCache(key_);
+		} else if (buffer_ && points_)
+			buffer_->write(0, points_, numPoints_ * sizeof(Vertex));
+
+		if (!buffer_)
+			drawPointArrays(points_, pointColors_, numPoints_, color);
+		else if (pointColors_)
+			drawStructure(*buffer_, numPoints_, true);
+		else
+			drawStructure(*buffer_, numPoints_, color);
+	}
+
 	/* ************************************************************************* */
 	inline void drawOneLine(GLfloat X1, GLfloat Y1, GLfloat Z1, GLfloat X2,
 			GLfloat Y2, GLfloat Z2, const SFMColor& color, GLfloat linewidth = 1) {
@@ -100,7 +596,73 @@ namespace sfmviewer {
 	}
 
 	/* ************************************************************************* */
-	void drawCameras(const vector<CameraVertices>& cameras, const vector<SFMColor>& cameraColors, const bool fill) {
+	void fillCameraArrays(const vector<CameraVertices>& cameras, const SFMColor* cameraColors,
+			const SFMColor& color, vector<Vertex>& vertices, vector<SFMColor>& colors) {
+		const int edges[8][2] = {{0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 2}, {2, 3}, {3, 4}, {4, 1}};
+		const size_t numCameras = cameras.size();
+		vertices.resize(20 * numCameras);
+		colors.assign(20 * numCameras, color);
+#pragma omp parallel for schedule(static)
+		for (long i=0; i<(long)numCameras; i++) {
+			const Vertex* v = cameras[i].v;
+			for (int e=0; e<8; e++) {
+				vertices[16 * i + 2 * e]     = v[edges[e][0]];
+				vertices[16 * i + 2 * e + 1] = v[edges[e][1]];
+			}
+			for (int k=0; k<4; k++)
+				vertices[16 * numCameras + 4 * i + k] = v[k + 1];
+			if (cameraColors) {
+				fill(colors.begin() + 16 * i, colors.begin() + 16 * (i + 1), cameraColors[i]);
+				fill(colors.begin() + 16 * numCameras + 4 * i, colors.begin() + 16 * numCameras + 4 * (i + 1),
+						cameraColors[i]);
+			}
+		}
+	}
+
+	/* ************************************************************************* */
+	void drawCameras(const VertexBuffer& buffer, const size_t numCameras, const bool fill) {
+		const size_t colorOffset = 20 * numCameras * sizeof(Vertex);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glLineWidth(1.);
+		drawBuffer(GL_LINES, buffer, 0, colorOffset, 16 * numCameras);
+		if (fill)
+			drawBuffer(GL_QUADS, buffer, 16 * numCameras * sizeof(Vertex),
+					colorOffset + 16 * numCameras * sizeof(SFMColor), 4 * numCameras);
+		glDisable(GL_BLEND);
+	}
+
+	/* ************************************************************************* */
+	// draw from the cache if there is a {generation} and the context has buffer objects, returns false otherwise
+	static bool drawCachedCameras(const vector<CameraVertices>& cameras, const SFMColor* cameraColors,
+			const SFMColor& color, const bool fill, const uint64_t generation) {
+		if (generation == uncached) return false;
+		const size_t numCameras = cameras.size();
+		const uint64_t colors = cameraColors ? (uintptr_t)cameraColors : colorKey(color);
+		bool upload;
+		VertexBuffer* buffer = cachedArrays(ArrayKey(&cameras[0], colors), numCameras, generation, upload);
+		if (!buffer) return false;
+		if (upload) {
+			vector<Vertex> vertices;
+			vector<SFMColor> colors;
+			fillCameraArrays(cameras, cameraColors, color, vertices, colors);
+			if (!uploadCachedArrays(*buffer, &vertices[0], vertices.size() * sizeof(Vertex),
+					&colors[0], colors.size() * sizeof(SFMColor)))
+				return false;
+		}
+		drawCameras(*buffer, numCameras, fill);
+		return true;
+	}
+
+	/* ************************************************************************* */
+	void drawCameras(const vector<CameraVertices>& cameras, const vector<SFMColor>& cameraColors, const bool fill,
+			const uint64_t generation) {
+		if (cameras.empty()) return;
+		if (!cameraColors.empty() && cameraColors.size() != cameras.size())
+			throw std::runtime_error("DrawCameras: no. of colors != no. of cameras");
+		if (drawCachedCameras(cameras, cameraColors.empty() ? NULL : &cameraColors[0], default_camera_color, fill,
+				generation))
+			return;
 
 		GLfloat linewidth = 1;
 		for (size_t i=0; i<cameras.size(); i++) {
@@ -112,7 +674,10 @@ namespace sfmviewer {
 	}
 
 	/* ************************************************************************* */
-	void drawCameras(const vector<CameraVertices>& cameras, const SFMColor& color, const bool fill) {
+	void drawCameras(const vector<CameraVertices>& cameras, const SFMColor& color, const bool fill,
+			const uint64_t generation) {
+		if (cameras.empty() || drawCachedCameras(cameras, NULL, color, fill, generation)) return;
+
 		GLfloat linewidth = 1;
 		for (size_t i=0; i<cameras.size(); i++) {
 				drawCamera(cameras[i].v, color, linewidth, fill);
@@ -181,14 +746,28 @@ namespace sfmviewer {
 
 	/* ************************************************************************* */
 	void drawBunny() {
-		vector<Vertex> structure;
-		Vertex v;
-		for (int i = 0; i < bunny_nr_vertex; i++) {
-			v.X = (GLfloat) bunny_vertices[i][0];
-			v.Y = -(GLfloat) bunny_vertices[i][1];
-			v.Z = (GLfloat) bunny_vertices[i][2];
-			structure.push_back(v);
+		// uploaded once per context straight from the baked bytes, a context that failed keeps a NULL buffer
+		// and draws from client memory without trying again
+		typedef map<const QGLContext*, boost::shared_ptr<VertexBuffer> > BufferMap;
+		static BufferMap buffers;
+		const BakedAsset& bunny = baked_bunny_structure;
+		const QGLContext* context = QGLContext::currentContext();
+		BufferMap::iterator it = buffers.find(context);
+		if (it == buffers.end()) {
+			boost::shared_ptr<VertexBuffer> buffer(new VertexBuffer);
+			try {
+				buffer->allocate(bunny.bytes, 1);
+				buffer->write(0, bunny.data, bunny.bytes);
+			} catch (const std::runtime_error&) {
+				buffer.reset();
+			}
+			it = buffers.insert(make_pair(context, buffer)).first;
 		}
-		drawStructure(structure);
+
+		const boost::shared_ptr<VertexBuffer>& buffer = it->second;
+		if (buffer)
+			drawStructure(*buffer, bunny.count, false);
+		else
+			drawPointArrays(bunny.data, NULL, bunny.count);
 	}
 } // namespace sfmviewer
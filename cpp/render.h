@@ -10,11 +10,19 @@
 
 #include <OpenGL/gl.h>
 #include <OpenGL/glu.h>
+#include <stdint.h>
 #include <QRectF>
 #include <QImage>
 
+#include "trackball.h"
+#include "lifetime.h"
+
+class QGLBuffer;
+
 namespace sfmviewer {
 
+	class Selection;
+
   // the data structure for 3D points
 	struct Vertex{
 		GLfloat X,Y,Z;
@@ -28,32 +36,177 @@ namespace sfmviewer {
 		SFMColor(GLfloat r0, GLfloat g0, GLfloat b0, GLfloat alpha0) : r(r0), g(g0), b(b0), alpha(alpha0) {}
 	};
 
+	const SFMColor default_point_color(0.f, 0.f, 0.f, 1.f);
 	const SFMColor default_camera_color(240.f/255.f, 140.0f/255.f, 24.0f/255.f, 1.f);
+	const SFMColor default_selection_color(1.f, 0.f, 0.f, 1.f);
+
+	// the perspective of the opengl camera
+	const GLfloat default_fovy = 60.0f;
+	const GLfloat default_near = 0.01f;
+	const GLfloat default_far  = 5000.0f;
+
+	// the generation of the arrays that drawStructure and drawCameras draw straight from client memory, see
+	// invalidateDrawCache
+	const uint64_t uncached = 0;
 
 	// a camera is composed of five vertices
 	struct CameraVertices{
 		Vertex v[5];
 	};
 
+	// set up the opengl states shared by all the canvases
+	void setGLDefaults();
+
+	// set the viewport and the perspective projection of a {width} x {height} canvas
+	void setGLProjection(int width, int height);
+
+	// load the modelview matrix that looks at the world from {pose}
+	void setGLModelView(const QuatPose& pose);
+
+	// a vertex buffer object in the current opengl context that remembers which version of the data it holds,
+	// so that unchanged data is not uploaded again. with {indices} it holds the indices of glDrawElements
+	class VertexBuffer {
+	public:
+		explicit VertexBuffer(const bool indices = false) : buffer_(NULL), indices_(indices), version_(0), bytes_(0) {}
+		~VertexBuffer();
+
+		// whether the buffer holds {version} of the data
+		bool isCurrent(const uint64_t version) const { return buffer_ && version_ == version; }
+
+		// make room for {bytes} bytes of {version}, the content is undefined until written
+		void allocate(const size_t bytes, const uint64_t version);
+
+		// copy {bytes} bytes from {data} to the byte {offset} of the buffer
+		void write(const size_t offset, const void* data, const size_t bytes);
+
+		// bind the buffer, so that the gl*Pointer calls take offsets into it, returns false if there is none
+		bool bind() const;
+		void release() const;
+
+		// map the allocated buffer for writing, NULL if the driver can not map buffers
+		void* map();
+
+		// end the mapping, returns false if the content was lost meanwhile and has to be written again
+		bool unmap();
+
+		size_t bytes() const { return bytes_; }
+
+	private:
+		VertexBuffer(const VertexBuffer&);
+		VertexBuffer& operator=(const VertexBuffer&);
+
+		QGLBuffer* buffer_;
+		bool indices_;
+		uint64_t version_;
+		size_t bytes_;
+	};
+
+	// draw {count} vertices of {mode} from the bound {buffer}, which holds the vertices at the byte {vertexOffset}
+	// and one color per vertex at the byte {colorOffset}
+	void drawBuffer(const GLenum mode, const VertexBuffer& buffer, const size_t vertexOffset, const size_t colorOffset,
+			const size_t count);
+
+	// draw a line strip through {numIndices} of the {numVertices} vertices in {vertices}, picked by the 32 bit
+	// {indices}. the line goes from blue at the first vertex to red at the last one, or is drawn in {color} if the
+	// context can not run the shader
+	void drawTrajectory(const VertexBuffer& vertices, const size_t numVertices, const VertexBuffer& indices,
+			const size_t numIndices, const SFMColor& color, const GLfloat linewidth = 1.f);
+
+	// draw {count} vertices of {mode} as drawBuffer does, with the lifetime of every vertex at the byte
+	// {lifetimeOffset}. a shader hides the vertices before their first step, draws them in their colors up to
+	// their last step and with the alpha scaled by {fade} afterwards, so that playing the steps only changes
+	// {step}. everything is drawn if the context can not run the shader
+	void drawLifetimeBuffer(const GLenum mode, const VertexBuffer& buffer, const size_t vertexOffset,
+			const size_t colorOffset, const size_t lifetimeOffset, const size_t count, const GLfloat step,
+			const GLfloat fade = 0.25f);
+
 	// draw the 3D structure using sfmviewer's own data structure
 	void drawStructure(const std::vector<Vertex>& structure,
-			const std::vector<SFMColor>& pointColors = std::vector<SFMColor>());
+			const std::vector<SFMColor>& pointColors = std::vector<SFMColor>(), const uint64_t generation = uncached);
+
+	// draw the 3D structure with the selected points in {highlight} and without the hidden ones,
+	// the selections are read by a shader so that the colors stay untouched
+	void drawStructure(const std::vector<Vertex>& structure, const std::vector<SFMColor>& pointColors,
+			const Selection& selected, const Selection* hidden = NULL, const SFMColor& highlight = default_selection_color,
+			const uint64_t generation = uncached);
+
+	// draw {numPoints} points from {buffer}, which holds the vertices followed by the colors if {hasColors},
+	// with an optional selection as above
+	void drawStructure(const VertexBuffer& buffer, const size_t numPoints, const bool hasColors,
+			const Selection* selected = NULL, const Selection* hidden = NULL,
+			const SFMColor& highlight = default_selection_color);
+
+	// draw {numPoints} points from {buffer} in a single {color}
+	void drawStructure(const VertexBuffer& buffer, const size_t numPoints, const SFMColor& color);
+
+	// the buffer of an adapter that converts the points of an external container straight into gpu memory, see
+	// drawStructure in render-inl.h. it shares the cache of the vectors given to drawStructure
+	class CachedPoints {
+	public:
+		// look up the buffer of the container whose first element is at {key}, the {generation} of the points
+		// tells whether they changed since the last frame, the {pointColors} are copied from client memory
+		CachedPoints(const void* key, const size_t numPoints, const SFMColor* pointColors, const uint64_t generation);
+		~CachedPoints();
+
+		// where the points have to be written before draw, NULL if the buffer is up to date
+		Vertex* points() { return points_; }
+
+		// draw the points in their colors or, without them, in {color}
+		void draw(const SFMColor& color = default_point_color);
+
+	private:
+		CachedPoints(const CachedPoints&);
+		CachedPoints& operator=(const CachedPoints&);
+
+		const void* key_;
+		VertexBuffer* buffer_;
+		Vertex* points_;
+		bool mapped_;
+		std::vector<Vertex> staging_;  // the points if the buffer can not be mapped or does not exist
+		size_t numPoints_;
+		const SFMColor* pointColors_;
+	};
 
-	// draw the 3D structure using external data structure, such as gtsam::LieValue::const_iterator
+	// copy the points of an external data structure into sfmviewer's own data structure
+	template <class KeyPointIterator>
+	void copyStructure(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
+			std::vector<Vertex>& structure);
+
+	// draw the 3D structure using external data structure, such as gtsam::LieValue::const_iterator. the container
+	// has to hold exactly {numPoints} points, it is only walked if the {generation} changed
 	template <class KeyPointIterator>
 	void drawStructure(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
-			const std::vector<SFMColor>& pointColors = std::vector<SFMColor>());
+			const std::vector<SFMColor>& pointColors = std::vector<SFMColor>(), const uint64_t generation = uncached);
 
 	template <class KeyPointIterator>
 	void drawStructure(KeyPointIterator keyPointBegin, KeyPointIterator keyPointEnd, const size_t numPoints,
-			const SFMColor& color);
+			const SFMColor& color, const uint64_t generation = uncached);
 
 	// draw cameras with flexible colors
 	void drawCameras(const std::vector<CameraVertices>& cameras,
-			const std::vector<SFMColor>& cameraColors = std::vector<SFMColor>(), const bool fill = true);
+			const std::vector<SFMColor>& cameraColors = std::vector<SFMColor>(), const bool fill = true,
+			const uint64_t generation = uncached);
 
 	// draw cameras with a fixed color
-	void drawCameras(const std::vector<CameraVertices>& cameras, const SFMColor& color, const bool fill = true);
+	void drawCameras(const std::vector<CameraVertices>& cameras, const SFMColor& color, const bool fill = true,
+			const uint64_t generation = uncached);
+
+	// the arrays of drawCameras: the eight edges of every frustum as lines followed by the image rectangles as
+	// quads, in {color} or in the camera's entry of {cameraColors} if that is not NULL
+	void fillCameraArrays(const std::vector<CameraVertices>& cameras, const SFMColor* cameraColors,
+			const SFMColor& color, std::vector<Vertex>& vertices, std::vector<SFMColor>& colors);
+
+	// draw {numCameras} cameras from {buffer}, which holds the arrays of fillCameraArrays, vertices first
+	void drawCameras(const VertexBuffer& buffer, const size_t numCameras, const bool fill = true);
+
+	// given a {generation} other than uncached, drawStructure and drawCameras keep the vectors in buffer objects of
+	// the current context and upload them again only if the address, the size or the generation changed, so the
+	// caller has to pass a new generation whenever it changed the elements in place. call this to upload the
+	// vector starting at {data} again on its next draw, or all with NULL
+	void invalidateDrawCache(const void* data = NULL);
+
+	// drop the buffers that drawStructure and drawCameras keep for the current context, before it is destroyed
+	void releaseDrawCache();
 
 	// draw a rgb cameras
 	template<class Pose3>
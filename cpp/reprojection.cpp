@@ -0,0 +1,267 @@
+/*
+ * reprojection.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the reprojection errors of the 2d observations of a reconstruction, per point and colored
+ */
+
+#include <string.h>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "reprojection.h"
+#include "trackball.h"
+
+#define LINESIZE 81920
+
+using namespace std;
+
+namespace sfmviewer {
+
+	// a projection fills one cache line
+	typedef char ProjectionIsCacheLine[sizeof(float) * 16 == 64 ? 1 : -1];
+
+	/* ************************************************************************* */
+	bool loadObservations(const string& filename, vector<Observation>& observations) {
+		ifstream is(filename.c_str());
+		if (!is) return false;
+		int id, numObservations;
+		while (is >> id >> numObservations) {
+			for (int i=0; i<numObservations; i++) {
+				int point;
+				float u, v;
+				if (!(is >> point >> u >> v))
+					throw std::runtime_error("loadObservations: truncated observations in " + filename);
+				if (id < 1 || point < 1)
+					throw std::runtime_error("loadObservations: invalid id in " + filename);
+				observations.push_back(Observation(id - 1, point - 1, u, v));
+			}
+			is.ignore(LINESIZE, '\n');
+		}
+		return true;
+	}
+
+	/* ************************************************************************* */
+	// the focal length of a horizontal field of view {fov} in degrees, as in CameraBatch::set
+	static float focalLength(const float fov, const int img_w) {
+		return 0.5f * img_w / tan(fov * M_PI / 360.);
+	}
+
+	/* ************************************************************************* */
+	bool projectPoint(const QuatPose& pose, const float fov, const int img_w, const int img_h, const Vertex& point,
+			float& u, float& v) {
+		float R[3][3];
+		build_rotmatrix(R, pose.m_quat);
+		const float d[3] = {point.X - pose.m_shift[0], point.Y - pose.m_shift[1], point.Z - pose.m_shift[2]};
+		float p[3];
+		for (int i=0; i<3; i++)
+			p[i] = R[0][i] * d[0] + R[1][i] * d[1] + R[2][i] * d[2];
+		if (p[2] <= 0.f) return false;
+		const float focal = focalLength(fov, img_w);
+		u = focal * p[0] / p[2] + 0.5f * img_w;
+		v = focal * p[1] / p[2] + 0.5f * img_h;
+		return true;
+	}
+
+	/* ************************************************************************* */
+	ReprojectionErrors::ReprojectionErrors(const vector<Observation>& observations, const size_t numPoints,
+			const size_t numCameras, const float fov, const int img_w, const int img_h)
+	: trackOffsets_(numPoints + 1, 0), cameraOffsets_(numCameras + 1, 0), fov_(fov), img_w_(img_w), img_h_(img_h),
+	  totalSquared_(0.), numValid_(0) {
+		for (size_t i=0; i<observations.size(); i++) {
+			if (observations[i].point >= numPoints || observations[i].camera >= numCameras)
+				throw std::runtime_error("ReprojectionErrors: observation out of range");
+			trackOffsets_[observations[i].point + 1]++;
+			cameraOffsets_[observations[i].camera + 1]++;
+		}
+		for (size_t p=0; p<numPoints; p++)
+			trackOffsets_[p + 1] += trackOffsets_[p];
+		for (size_t c=0; c<numCameras; c++)
+			cameraOffsets_[c + 1] += cameraOffsets_[c];
+
+		// counting sort by point and by camera
+		obsCameras_.resize(observations.size());
+		obsPixels_.resize(2 * observations.size());
+		cameraPoints_.resize(observations.size());
+		vector<uint32_t> nextObs(trackOffsets_.begin(), trackOffsets_.end() - 1);
+		vector<uint32_t> nextPoint(cameraOffsets_.begin(), cameraOffsets_.end() - 1);
+		for (size_t i=0; i<observations.size(); i++) {
+			const Observation& o = observations[i];
+			const uint32_t j = nextObs[o.point]++;
+			obsCameras_[j] = o.camera;
+			obsPixels_[2*j] = o.u;
+			obsPixels_[2*j+1] = o.v;
+			cameraPoints_[nextPoint[o.camera]++] = o.point;
+		}
+
+		residuals_.assign(observations.size(), -1.f);
+		meanErrors_.assign(numPoints, -1.f);
+		maxErrors_.assign(numPoints, -1.f);
+		squared_.assign(numPoints, 0.);
+		valid_.assign(numPoints, 0);
+		dirty_.assign(numPoints, 0);
+	}
+
+	/* ************************************************************************* */
+	void ReprojectionErrors::setProjection(const size_t c) {
+		Projection& p = projections_[c];
+		float R[3][3];
+		build_rotmatrix(R, poses_[c].m_quat);
+		for (int i=0; i<3; i++) {
+			for (int j=0; j<3; j++)
+				p.r[3*i+j] = R[i][j];
+			p.t[i] = poses_[c].m_shift[i];
+		}
+		p.fx = p.fy = focalLength(fov_, img_w_);
+		p.cx = 0.5f * img_w_;
+		p.cy = 0.5f * img_h_;
+	}
+
+	/* ************************************************************************* */
+	// reproject the tracks of changed_ and update the totals, returns the number of observations
+	size_t ReprojectionErrors::computeTracks() {
+		for (size_t k=0; k<changed_.size(); k++) {
+			totalSquared_ -= squared_[changed_[k]];
+			numValid_ -= valid_[changed_[k]];
+		}
+
+		long numReprojected = 0;
+#pragma omp parallel for schedule(dynamic, 256) reduction(+:numReprojected)
+		for (long k=0; k<(long)changed_.size(); k++) {
+			const int p = changed_[k];
+			const Vertex& X = structure_[p];
+			double squared = 0.;
+			float sum = 0.f, maxError = -1.f;
+			uint32_t valid = 0;
+			for (uint32_t j=trackOffsets_[p]; j<trackOffsets_[p + 1]; j++) {
+				const Projection& c = projections_[obsCameras_[j]];
+				const float d0 = X.X - c.t[0], d1 = X.Y - c.t[1], d2 = X.Z - c.t[2];
+				const float z = c.r[2] * d0 + c.r[5] * d1 + c.r[8] * d2;
+				if (z <= 0.f) {
+					residuals_[j] = -1.f;
+					continue;
+				}
+				const float x = c.r[0] * d0 + c.r[3] * d1 + c.r[6] * d2;
+				const float y = c.r[1] * d0 + c.r[4] * d1 + c.r[7] * d2;
+				const float du = c.fx * x / z + c.cx - obsPixels_[2*j];
+				const float dv = c.fy * y / z + c.cy - obsPixels_[2*j+1];
+				const float error = sqrtf(du * du + dv * dv);
+				residuals_[j] = error;
+				squared += (double)error * error;
+				sum += error;
+				maxError = max(maxError, error);
+				valid++;
+			}
+			meanErrors_[p] = valid ? sum / valid : -1.f;
+			maxErrors_[p] = maxError;
+			squared_[p] = squared;
+			valid_[p] = valid;
+			numReprojected += trackOffsets_[p + 1] - trackOffsets_[p];
+		}
+
+		for (size_t k=0; k<changed_.size(); k++) {
+			totalSquared_ += squared_[changed_[k]];
+			numValid_ += valid_[changed_[k]];
+		}
+		return numReprojected;
+	}
+
+	/* ************************************************************************* */
+	void ReprojectionErrors::compute(const vector<QuatPose>& poses, const vector<Vertex>& structure) {
+		if (poses.size() != numCameras() || structure.size() != numPoints())
+			throw std::runtime_error("ReprojectionErrors::compute: the scene does not match the observations");
+		poses_ = poses;
+		structure_ = structure;
+		projections_.resize(numCameras());
+		for (size_t c=0; c<numCameras(); c++)
+			setProjection(c);
+
+		changed_.resize(numPoints());
+		for (size_t p=0; p<numPoints(); p++)
+			changed_[p] = p;
+		totalSquared_ = 0.;
+		numValid_ = 0;
+		squared_.assign(numPoints(), 0.);
+		valid_.assign(numPoints(), 0);
+		computeTracks();
+	}
+
+	/* ************************************************************************* */
+	size_t ReprojectionErrors::update(const vector<QuatPose>& poses, const vector<Vertex>& structure) {
+		if (poses_.size() != poses.size() || structure_.size() != structure.size()) {
+			compute(poses, structure);
+			return numObservations();
+		}
+
+		// the cameras and the points that moved since the last call
+		vector<int> movedCameras, movedPoints;
+		for (size_t c=0; c<poses.size(); c++)
+			if (memcmp(&poses[c], &poses_[c], sizeof(QuatPose)) != 0) movedCameras.push_back(c);
+		for (size_t p=0; p<structure.size(); p++)
+			if (memcmp(&structure[p], &structure_[p], sizeof(Vertex)) != 0) movedPoints.push_back(p);
+		return update(poses, structure, movedCameras, movedPoints);
+	}
+
+	/* ************************************************************************* */
+	size_t ReprojectionErrors::update(const vector<QuatPose>& poses, const vector<Vertex>& structure,
+			const vector<int>& movedCameras, const vector<int>& movedPoints) {
+		if (poses_.size() != poses.size() || structure_.size() != structure.size()) {
+			compute(poses, structure);
+			return numObservations();
+		}
+		for (size_t k=0; k<movedCameras.size(); k++)
+			if (movedCameras[k] < 0 || (size_t)movedCameras[k] >= poses.size())
+				throw std::runtime_error("ReprojectionErrors::update: moved camera out of range");
+		for (size_t k=0; k<movedPoints.size(); k++)
+			if (movedPoints[k] < 0 || (size_t)movedPoints[k] >= structure.size())
+				throw std::runtime_error("ReprojectionErrors::update: moved point out of range");
+
+		// the points seen by the cameras that moved and the points that moved themselves
+		changed_.clear();
+		for (size_t k=0; k<movedCameras.size(); k++) {
+			const int c = movedCameras[k];
+			poses_[c] = poses[c];
+			setProjection(c);
+			for (uint32_t i=cameraOffsets_[c]; i<cameraOffsets_[c + 1]; i++)
+				if (!dirty_[cameraPoints_[i]]) {
+					dirty_[cameraPoints_[i]] = 1;
+					changed_.push_back(cameraPoints_[i]);
+				}
+		}
+		for (size_t k=0; k<movedPoints.size(); k++) {
+			const int p = movedPoints[k];
+			structure_[p] = structure[p];
+			if (!dirty_[p]) {
+				dirty_[p] = 1;
+				changed_.push_back(p);
+			}
+		}
+		for (size_t k=0; k<changed_.size(); k++)
+			dirty_[changed_[k]] = 0;
+
+		return computeTracks();
+	}
+
+	/* ************************************************************************* */
+	SFMColor errorColor(const float error, const float maxError, const SFMColor& unobserved) {
+		if (error < 0.f) return unobserved;
+		static const float stops[5][3] = {{0.f, 0.f, 1.f}, {0.f, 1.f, 1.f}, {0.f, 1.f, 0.f}, {1.f, 1.f, 0.f}, {1.f, 0.f, 0.f}};
+		const float t = maxError > 0.f ? min(error / maxError, 1.f) * 4.f : 4.f;
+		const int i = min((int)t, 3);
+		const float f = t - i;
+		return SFMColor(stops[i][0] + f * (stops[i+1][0] - stops[i][0]), stops[i][1] + f * (stops[i+1][1] - stops[i][1]),
+				stops[i][2] + f * (stops[i+1][2] - stops[i][2]), 1.f);
+	}
+
+	/* ************************************************************************* */
+	void errorColors(const vector<float>& errors, const float maxError, const SFMColor& unobserved,
+			vector<SFMColor>& colors) {
+		colors.assign(errors.size(), unobserved);
+#pragma omp parallel for schedule(static)
+		for (long i=0; i<(long)errors.size(); i++)
+			colors[i] = errorColor(errors[i], maxError, unobserved);
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,126 @@
+/*
+ * reprojection.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the reprojection errors of the 2d observations of a reconstruction, per point and colored
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdint.h>
+
+#include "render.h"
+
+namespace sfmviewer {
+
+	// point {point} seen by camera {camera} at pixel (u,v)
+	struct Observation {
+		uint32_t camera, point;
+		float u, v;
+		Observation(uint32_t camera0, uint32_t point0, float u0, float v0) : camera(camera0), point(point0), u(u0), v(v0) {}
+		Observation() {}
+	};
+
+	// load the observations of every camera, one line per camera as in the visibility files: the camera id, the
+	// number of observations and then the point id and the pixel of every observation. the ids start at 1.
+	// returns false if the file is not readable
+	bool loadObservations(const std::string& filename, std::vector<Observation>& observations);
+
+	// the pixel where camera {pose} with the horizontal field of view {fov} in degrees and an image of {img_w} x
+	// {img_h} sees {point}, as CameraBatch::set models it. returns false if the point is behind the camera
+	bool projectPoint(const QuatPose& pose, const float fov, const int img_w, const int img_h, const Vertex& point,
+			float& u, float& v);
+
+	// the distances in pixels between the observations and the projections of their points, and their mean and
+	// maximum per point. the observations are kept as tracks, the ones of every point in a row, so that the
+	// points are spread over the threads without any two writing the same data. update recomputes only the tracks
+	// of the points that moved or are seen by a camera that moved, so an optimizer thread can call it on every
+	// iteration of a bundle adjustment and recolor only changedPoints before publishing, see SceneChannel
+	class ReprojectionErrors {
+	public:
+		ReprojectionErrors() : trackOffsets_(1, 0), cameraOffsets_(1, 0), fov_(120.f), img_w_(1600), img_h_(1600), totalSquared_(0.), numValid_(0) {}
+
+		// the errors of {observations} of {numPoints} points in {numCameras} cameras with the intrinsics of
+		// projectPoint, throws if an observation is out of range. nothing is computed before compute or update
+		ReprojectionErrors(const std::vector<Observation>& observations, const size_t numPoints, const size_t numCameras,
+				const float fov = 120.f, const int img_w = 1600, const int img_h = 1600);
+
+		size_t numObservations() const { return obsCameras_.size(); }
+		size_t numPoints() const { return trackOffsets_.size() - 1; }
+		size_t numCameras() const { return cameraOffsets_.size() - 1; }
+
+		// recompute all the errors from {poses} and {structure}
+		void compute(const std::vector<QuatPose>& poses, const std::vector<Vertex>& structure);
+
+		// recompute the errors that {poses} and {structure} changed since the last call, returns the number of
+		// observations reprojected. the first call computes everything. finding the changes compares all the
+		// poses and points with those of the last call, which costs as much as a pass over the scene however
+		// few moved, an optimizer that knows what it moved passes that to the overload below instead
+		size_t update(const std::vector<QuatPose>& poses, const std::vector<Vertex>& structure);
+
+		// as above for the cameras {movedCameras} and the points {movedPoints} only, the others are taken to be
+		// where they were. costs only the tracks of those, throws if an index is out of range
+		size_t update(const std::vector<QuatPose>& poses, const std::vector<Vertex>& structure,
+				const std::vector<int>& movedCameras, const std::vector<int>& movedPoints);
+
+		// the points whose errors the last compute or update recomputed
+		const std::vector<int>& changedPoints() const { return changed_; }
+
+		// the error of every observation, the ones of point p are [trackBegin(p), trackBegin(p+1)), and -1 if
+		// the point is behind the camera. those are left out of the statistics
+		const std::vector<float>& residuals() const { return residuals_; }
+		size_t trackBegin(const size_t p) const { return trackOffsets_[p]; }
+
+		// the mean and maximum error of every point, -1 for the points without any observation in front of a camera
+		const std::vector<float>& meanErrors() const { return meanErrors_; }
+		const std::vector<float>& maxErrors() const { return maxErrors_; }
+
+		// the root mean square of all the errors
+		double rms() const { return numValid_ ? sqrt(totalSquared_ / numValid_) : 0.; }
+
+	private:
+		// a camera in one cache line: the rotation from camera to world, the optical center and the intrinsics
+		struct Projection {
+			float r[9], t[3];
+			float fx, fy, cx, cy;
+		};
+
+		std::vector<uint32_t> trackOffsets_;   // the observations of point p are [trackOffsets_[p], trackOffsets_[p+1])
+		std::vector<uint32_t> obsCameras_;
+		std::vector<float> obsPixels_;         // u and v of every observation
+		std::vector<uint32_t> cameraOffsets_;  // the points seen by camera c are cameraPoints_[cameraOffsets_[c], ...)
+		std::vector<uint32_t> cameraPoints_;
+
+		float fov_;
+		int img_w_, img_h_;
+		std::vector<QuatPose> poses_;          // the poses and points of the last call
+		std::vector<Vertex> structure_;
+		std::vector<Projection> projections_;
+
+		std::vector<float> residuals_;
+		std::vector<float> meanErrors_, maxErrors_;
+		std::vector<double> squared_;          // the sum of the squared errors of every point
+		std::vector<uint32_t> valid_;          // the observations of every point in front of the camera
+		double totalSquared_;
+		size_t numValid_;
+
+		std::vector<char> dirty_;
+		std::vector<int> changed_;
+
+		void setProjection(const size_t c);
+		size_t computeTracks();
+	};
+
+	// the color of {error} on a blue, cyan, green, yellow, red scale up to {maxError}, and {unobserved} for
+	// negative errors
+	SFMColor errorColor(const float error, const float maxError, const SFMColor& unobserved);
+
+	// the colors of all the {errors}
+	void errorColors(const std::vector<float>& errors, const float maxError, const SFMColor& unobserved,
+			std::vector<SFMColor>& colors);
+
+} // namespace sfmviewer
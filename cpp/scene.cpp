@@ -0,0 +1,489 @@
+/*
+ * scene.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a retained scene made of typed layers that know when their content changed
+ */
+
+#include <math.h>
+#include <float.h>
+#include <stdexcept>
+#include <algorithm>
+
+#include "scene.h"
+#include "selection.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	// upload {vertices} followed by {colors} into {buffer} as {version}
+	static void uploadArrays(VertexBuffer& buffer, const vector<Vertex>& vertices, const vector<SFMColor>& colors,
+			const uint64_t version) {
+		const size_t vertexBytes = vertices.size() * sizeof(Vertex);
+		buffer.allocate(vertexBytes + colors.size() * sizeof(SFMColor), version);
+		if (!vertices.empty()) buffer.write(0, &vertices[0], vertexBytes);
+		if (!colors.empty()) buffer.write(vertexBytes, &colors[0], colors.size() * sizeof(SFMColor));
+	}
+
+	/* ************************************************************************* */
+	// remember the {changed} elements of a buffer built from the current {version}, returns false if the buffer
+	// has to be built again anyway or more than {size} elements piled up, then the whole buffer is uploaded
+	static bool addChanged(const vector<int>& changed, const uint64_t builtVersion, const uint64_t version,
+			const size_t size, vector<int>& pending) {
+		if (builtVersion != version || pending.size() + changed.size() > size) {
+			pending.clear();
+			return false;
+		}
+		pending.insert(pending.end(), changed.begin(), changed.end());
+		return true;
+	}
+
+	/* ************************************************************************* */
+	// sort the {changed} elements and drop the repeated ones, they have to be below {size}
+	static void sortChanged(vector<int>& changed, const size_t size) {
+		sort(changed.begin(), changed.end());
+		changed.erase(unique(changed.begin(), changed.end()), changed.end());
+		if (!changed.empty() && (changed.front() < 0 || (size_t)changed.back() >= size))
+			throw std::runtime_error("sortChanged: index out of range");
+	}
+
+	/* ************************************************************************* */
+	// write the {colors} of the sorted {changed} elements into {buffer}, which holds {perElement} colors of every
+	// element from the byte {offset} on. consecutive elements are written at once
+	static void writeColors(VertexBuffer& buffer, const vector<SFMColor>& colors, const vector<int>& changed,
+			const size_t offset, const size_t perElement) {
+		vector<SFMColor> run;
+		for (size_t k=0; k<changed.size(); ) {
+			const size_t first = changed[k];
+			while (k + 1 < changed.size() && changed[k + 1] == changed[k] + 1) k++;
+			const size_t last = changed[k++];
+
+			run.clear();
+			for (size_t i=first; i<=last; i++) run.insert(run.end(), perElement, colors[i]);
+			buffer.write(offset + first * perElement * sizeof(SFMColor), &run[0], run.size() * sizeof(SFMColor));
+		}
+	}
+
+	/* ************************************************************************* */
+	void PointLayer::colorsChanged(const vector<int>& changed) {
+		// the buffer stays current apart from the colors draw writes
+		const size_t numPoints = structure_ ? structure_->size() : 0;
+		if (addChanged(changed, builtVersion_, version(), numPoints, changed_)) builtVersion_++;
+		touch();
+	}
+
+	/* ************************************************************************* */
+	void PointLayer::draw() {
+		if (!structure_) return;
+		const size_t numPoints = structure_->size();
+		const bool hasColors = pointColors_ && !pointColors_->empty();
+		if (hasColors && pointColors_->size() != numPoints)
+			throw std::runtime_error("PointLayer::draw: no. of colors != no. of points");
+
+		if (builtVersion_ != version()) {
+			builtVersion_ = version();
+			uploadArrays(buffer_, *structure_, hasColors ? *pointColors_ : vector<SFMColor>(), builtVersion_);
+		} else if (!changed_.empty() && hasColors) {
+			sortChanged(changed_, numPoints);
+			writeColors(buffer_, *pointColors_, changed_, numPoints * sizeof(Vertex), 1);
+		}
+		changed_.clear();
+
+		drawStructure(buffer_, numPoints, hasColors, selected_, hidden_, highlight_);
+	}
+
+	/* ************************************************************************* */
+	void CameraLayer::colorsChanged(const vector<int>& changed) {
+		const size_t numCameras = cameras_ ? cameras_->size() : 0;
+		if (addChanged(changed, builtVersion_, version(), numCameras, changed_)) builtVersion_++;
+		touch();
+	}
+
+	/* ************************************************************************* */
+	void CameraLayer::draw() {
+		if (!cameras_) return;
+		const bool hasColors = cameraColors_ && !cameraColors_->empty();
+		if (hasColors && cameraColors_->size() != cameras_->size())
+			throw std::runtime_error("CameraLayer::draw: no. of colors != no. of cameras");
+
+		if (builtVersion_ != version()) {
+			builtVersion_ = version();
+			vector<Vertex> vertices;
+			vector<SFMColor> colors;
+			numCameras_ = cameras_->size();
+			fillCameraArrays(*cameras_, hasColors ? &(*cameraColors_)[0] : NULL, color_, vertices, colors);
+			uploadArrays(buffer_, vertices, colors, builtVersion_);
+		} else if (!changed_.empty() && hasColors) {
+			// the colors of the edges and then of the image rectangles, see fillCameraArrays
+			sortChanged(changed_, numCameras_);
+			const size_t colorOffset = 20 * numCameras_ * sizeof(Vertex);
+			writeColors(buffer_, *cameraColors_, changed_, colorOffset, 16);
+			writeColors(buffer_, *cameraColors_, changed_, colorOffset + 16 * numCameras_ * sizeof(SFMColor), 4);
+		}
+		changed_.clear();
+
+		drawCameras(buffer_, numCameras_, fill_);
+	}
+
+	/* ************************************************************************* */
+	void AxisLayer::draw() {
+		if (!poses_) return;
+
+		// the columns of the rotation are the axes of the camera in the world
+		if (!buffer_.isCurrent(version())) {
+			numPoses_ = poses_->size();
+			const SFMColor axisColors[3] = {SFMColor(1.f, 0.f, 0.f, 1.f), SFMColor(0.f, 1.f, 0.f, 1.f),
+					SFMColor(0.f, 0.f, 1.f, 1.f)};
+			vector<Vertex> vertices(6 * numPoses_);
+			vector<SFMColor> colors(6 * numPoses_, axisColors[0]);
+#pragma omp parallel for schedule(static)
+			for (long i=0; i<(long)numPoses_; i++) {
+				const QuatPose& pose = (*poses_)[i];
+				float r[3][3];
+				build_rotmatrix(r, pose.m_quat);
+				for (int a=0; a<3; a++) {
+					vertices[6 * i + 2 * a] = Vertex(pose.x(), pose.y(), pose.z());
+					vertices[6 * i + 2 * a + 1] = Vertex(pose.x() + scale_ * r[0][a], pose.y() + scale_ * r[1][a],
+							pose.z() + scale_ * r[2][a]);
+					colors[6 * i + 2 * a] = colors[6 * i + 2 * a + 1] = axisColors[a];
+				}
+			}
+			uploadArrays(buffer_, vertices, colors, version());
+		}
+
+		glLineWidth(linewidth_);
+		drawBuffer(GL_LINES, buffer_, 0, 6 * numPoses_ * sizeof(Vertex), 6 * numPoses_);
+	}
+
+	/* ************************************************************************* */
+	void LineLayer::draw() {
+		if (!endpoints_) return;
+		const bool hasColors = colors_ && !colors_->empty();
+		if (hasColors && colors_->size() != endpoints_->size())
+			throw std::runtime_error("LineLayer::draw: no. of colors != no. of endpoints");
+
+		if (!buffer_.isCurrent(version())) {
+			numVertices_ = endpoints_->size() / 2 * 2;
+			uploadArrays(buffer_, *endpoints_, hasColors ? *colors_ : vector<SFMColor>(endpoints_->size(), color_),
+					version());
+		}
+
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glLineWidth(linewidth_);
+		drawBuffer(GL_LINES, buffer_, 0, endpoints_->size() * sizeof(Vertex), numVertices_);
+		glDisable(GL_BLEND);
+	}
+
+	/* ************************************************************************* */
+	// the edges with more shared points first
+	static bool moreShared(const CovisibilityEdge& e1, const CovisibilityEdge& e2) {
+		return e1.shared > e2.shared;
+	}
+
+	/* ************************************************************************* */
+	void CovisibilityLayer::setThreshold(const uint32_t minShared) {
+		// the buffer stays current, the view changes
+		if (builtVersion_ == version()) builtVersion_++;
+		threshold_ = minShared;
+		touch();
+	}
+
+	/* ************************************************************************* */
+	void CovisibilityLayer::draw() {
+		if (!centers_ || !edges_) return;
+
+		if (builtVersion_ != version()) {
+			builtVersion_ = version();
+			vector<CovisibilityEdge> sorted(*edges_);
+			for (size_t i=0; i<sorted.size(); i++)
+				if (sorted[i].a >= centers_->size() || sorted[i].b >= centers_->size())
+					throw std::runtime_error("CovisibilityLayer::draw: camera index out of range");
+			stable_sort(sorted.begin(), sorted.end(), moreShared);
+			const size_t numEdges = sorted.size();
+			maxShared_ = numEdges ? sorted[0].shared : 0;
+
+			vector<Vertex> vertices(2 * numEdges);
+			vector<SFMColor> colors(2 * numEdges, default_camera_color);
+			weights_.resize(numEdges);
+#pragma omp parallel for schedule(static)
+			for (long i=0; i<(long)numEdges; i++) {
+				const CovisibilityEdge& edge = sorted[i];
+				vertices[2 * i] = (*centers_)[edge.a];
+				vertices[2 * i + 1] = (*centers_)[edge.b];
+				const float strength = (float)edge.shared / maxShared_;
+				colors[2 * i] = colors[2 * i + 1] = SFMColor(0.8f * (1.f - strength), 0.8f * (1.f - strength), 1.f,
+						0.3f + 0.7f * strength);
+				weights_[i] = edge.shared;
+			}
+			uploadArrays(buffer_, vertices, colors, version());
+		}
+
+		// the edges above the threshold are a prefix of the buffer
+		const size_t numDrawn = upper_bound(weights_.begin(), weights_.end(), threshold_, greater<uint32_t>())
+				- weights_.begin();
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glLineWidth(linewidth_);
+		drawBuffer(GL_LINES, buffer_, 0, weights_.size() * 2 * sizeof(Vertex), 2 * numDrawn);
+		glDisable(GL_BLEND);
+	}
+
+	/* ************************************************************************* */
+	void TrajectoryLayer::appended() {
+		if (builtVersion_ == version() || appendVersion_ == version())
+			appendVersion_ = version() + 1;
+		touch();
+	}
+
+	/* ************************************************************************* */
+	void TrajectoryLayer::update() {
+		const size_t n = poses_->size();
+		const bool append = builtVersion_ > 0 && appendVersion_ == version() && n >= centers_.size();
+		const size_t begin = append ? centers_.size() : 0;
+		builtVersion_ = version();
+
+		centers_.resize(n);
+#pragma omp parallel for schedule(static)
+		for (long i=begin; i<(long)n; i++)
+			centers_[i] = Vertex((*poses_)[i].x(), (*poses_)[i].y(), (*poses_)[i].z());
+
+		if (begin == 0) {
+			lower_ = Vertex(FLT_MAX, FLT_MAX, FLT_MAX);
+			upper_ = Vertex(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		}
+		for (size_t i=begin; i<n; i++) {
+			const Vertex& c = centers_[i];
+			lower_ = Vertex(min(lower_.X, c.X), min(lower_.Y, c.Y), min(lower_.Z, c.Z));
+			upper_ = Vertex(max(upper_.X, c.X), max(upper_.Y, c.Y), max(upper_.Z, c.Z));
+		}
+		lod_.update(centers_, begin);
+
+		// the buffers grow by doubling, so that appending uploads only the new centers most of the time
+		const size_t bytes = n * sizeof(Vertex);
+		if (begin == 0 || bytes > vertices_.bytes()) {
+			vertices_.allocate(begin == 0 ? bytes : max(bytes, 2 * vertices_.bytes()), version());
+			if (n > 0) vertices_.write(0, &centers_[0], bytes);
+		} else if (n > begin)
+			vertices_.write(begin * sizeof(Vertex), &centers_[begin], bytes - begin * sizeof(Vertex));
+		if (begin == 0) levels_.clear();
+	}
+
+	/* ************************************************************************* */
+	// the size of a pixel in world units at the point of the box [{lower}, {upper}] that is nearest to the eye
+	static float pixelSize(const Vertex& lower, const Vertex& upper) {
+		GLdouble modelview[16], projection[16];
+		GLint viewport[4];
+		glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+		glGetDoublev(GL_PROJECTION_MATRIX, projection);
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		if (viewport[3] <= 0 || projection[5] == 0.) return 0.f;
+
+		// the modelview is a rotation with a uniform scale {s} followed by a translation
+		const double* m = modelview;
+		const double s2 = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+		if (projection[15] == 1.)  // orthographic
+			return 2. / (projection[5] * viewport[3] * sqrt(s2));
+
+		// the distance of the eye to the box, at least the near plane
+		double eye[3], distance2 = 0.;
+		const double box[2][3] = {{lower.X, lower.Y, lower.Z}, {upper.X, upper.Y, upper.Z}};
+		for (int j=0; j<3; j++) {
+			eye[j] = -(m[4*j] * m[12] + m[4*j+1] * m[13] + m[4*j+2] * m[14]) / s2;
+			const double outside = max(box[0][j] - eye[j], eye[j] - box[1][j]);
+			if (outside > 0.) distance2 += outside * outside;
+		}
+		const double nearPlane = projection[14] / (projection[10] - 1.);
+		const double distance = max(sqrt(distance2), nearPlane / sqrt(s2));
+		return 2. * distance / (projection[5] * viewport[3]);
+	}
+
+	/* ************************************************************************* */
+	void TrajectoryLayer::draw() {
+		if (!poses_) return;
+		if (builtVersion_ != version()) update();
+		numDrawn_ = 0;
+		if (centers_.size() < 2) return;
+
+		// the simplification for this view, uploaded where it differs from the last frame at the same level
+		const float tolerance = pixelTolerance_ * pixelSize(lower_, upper_);
+		size_t firstChanged;
+		const vector<uint32_t>& indices = lod_.simplify(tolerance, &firstChanged);
+		boost::shared_ptr<IndexLevel>& level = levels_[PolylineLod::level(tolerance)];
+		if (!level) {
+			level.reset(new IndexLevel);
+			firstChanged = 0;
+		}
+		const size_t bytes = indices.size() * sizeof(uint32_t);
+		if (bytes > level->buffer.bytes()) {
+			level->buffer.allocate(max(bytes, 2 * level->buffer.bytes()), version());
+			level->buffer.write(0, &indices[0], bytes);
+		} else if (firstChanged < indices.size())
+			level->buffer.write(firstChanged * sizeof(uint32_t), &indices[firstChanged], bytes - firstChanged * sizeof(uint32_t));
+		level->size = indices.size();
+
+		drawTrajectory(vertices_, centers_.size(), level->buffer, level->size, default_camera_color, linewidth_);
+		numDrawn_ = level->size;
+	}
+
+	/* ************************************************************************* */
+	void LifetimeLayer::setStep(const GLfloat step) {
+		// the buffers stay current, the view changes
+		if (builtVersion_ == version()) builtVersion_++;
+		step_ = step;
+		touch();
+	}
+
+	/* ************************************************************************* */
+	void LifetimeLayer::draw() {
+		if (!structure_ || !pointLifetimes_ || !cameras_ || !cameraLifetimes_) return;
+
+		if (builtVersion_ != version()) {
+			builtVersion_ = version();
+			const bool hasPointColors = pointColors_ && !pointColors_->empty();
+			const bool hasCameraColors = cameraColors_ && !cameraColors_->empty();
+			if (pointLifetimes_->size() != structure_->size() || (hasPointColors && pointColors_->size() != structure_->size()))
+				throw std::runtime_error("LifetimeLayer::draw: no. of colors or lifetimes != no. of points");
+			if (cameraLifetimes_->size() != cameras_->size() || (hasCameraColors && cameraColors_->size() != cameras_->size()))
+				throw std::runtime_error("LifetimeLayer::draw: no. of colors or lifetimes != no. of cameras");
+
+			// the points, their colors and their lifetimes
+			numPoints_ = structure_->size();
+			const size_t vertexBytes = numPoints_ * sizeof(Vertex), colorBytes = numPoints_ * sizeof(SFMColor);
+			points_.allocate(vertexBytes + colorBytes + numPoints_ * sizeof(Lifetime), builtVersion_);
+			if (numPoints_) {
+				points_.write(0, &(*structure_)[0], vertexBytes);
+				if (hasPointColors)
+					points_.write(vertexBytes, &(*pointColors_)[0], colorBytes);
+				else {
+					const vector<SFMColor> colors(numPoints_, default_point_color);
+					points_.write(vertexBytes, &colors[0], colorBytes);
+				}
+				points_.write(vertexBytes + colorBytes, &(*pointLifetimes_)[0], numPoints_ * sizeof(Lifetime));
+			}
+
+			// the eight edges of the frusta as in fillCameraArrays, every vertex with the lifetime of its camera
+			numCameras_ = cameras_->size();
+			const int edges[8][2] = {{0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 2}, {2, 3}, {3, 4}, {4, 1}};
+			vector<Vertex> vertices(16 * numCameras_);
+			vector<SFMColor> colors(16 * numCameras_, default_camera_color);
+			vector<Lifetime> lifetimes(16 * numCameras_);
+			for (size_t i=0; i<numCameras_; i++) {
+				const Vertex* v = (*cameras_)[i].v;
+				for (int e=0; e<8; e++) {
+					vertices[16 * i + 2 * e]     = v[edges[e][0]];
+					vertices[16 * i + 2 * e + 1] = v[edges[e][1]];
+				}
+				if (hasCameraColors)
+					fill(colors.begin() + 16 * i, colors.begin() + 16 * (i + 1), (*cameraColors_)[i]);
+				fill(lifetimes.begin() + 16 * i, lifetimes.begin() + 16 * (i + 1), (*cameraLifetimes_)[i]);
+			}
+			const size_t edgeBytes = vertices.size() * sizeof(Vertex), edgeColorBytes = colors.size() * sizeof(SFMColor);
+			frusta_.allocate(edgeBytes + edgeColorBytes + lifetimes.size() * sizeof(Lifetime), builtVersion_);
+			if (numCameras_) {
+				frusta_.write(0, &vertices[0], edgeBytes);
+				frusta_.write(edgeBytes, &colors[0], edgeColorBytes);
+				frusta_.write(edgeBytes + edgeColorBytes, &lifetimes[0], lifetimes.size() * sizeof(Lifetime));
+			}
+		}
+
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glPointSize(1.f);
+		const size_t pointColors = numPoints_ * sizeof(Vertex);
+		drawLifetimeBuffer(GL_POINTS, points_, 0, pointColors, pointColors + numPoints_ * sizeof(SFMColor), numPoints_,
+				step_, fade_);
+		glLineWidth(1.f);
+		const size_t frustumColors = 16 * numCameras_ * sizeof(Vertex);
+		drawLifetimeBuffer(GL_LINES, frusta_, 0, frustumColors, frustumColors + 16 * numCameras_ * sizeof(SFMColor),
+				16 * numCameras_, step_, fade_);
+		glDisable(GL_BLEND);
+	}
+
+	/* ************************************************************************* */
+	void LiveLayer::draw() {
+		if (!channel_) return;
+		if (channel_->acquire()) {
+			SceneSnapshot& latest = channel_->front();
+			snapshot_.structure.swap(latest.structure);
+			snapshot_.pointColors.swap(latest.pointColors);
+			snapshot_.poses.swap(latest.poses);
+			skipped_ += channel_->serial() - serial_ - 1;
+			serial_ = channel_->serial();
+			points_.touch();
+			axes_.touch();
+			touch();
+		}
+		points_.draw();
+		axes_.draw();
+	}
+
+	/* ************************************************************************* */
+	void OverlayLayer::draw() {
+		if (!fun_draw_) return;
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadIdentity();
+		gluOrtho2D(0, viewport[2], viewport[3], 0);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+		glDisable(GL_DEPTH_TEST);
+
+		fun_draw_();
+
+		glEnable(GL_DEPTH_TEST);
+		glPopMatrix();
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+	}
+
+	/* ************************************************************************* */
+	LayerPtr Scene::add(const LayerPtr& layer) {
+		if (!layer)
+			throw std::runtime_error("Scene::add: empty layer");
+		layers_.push_back(layer);
+		edits_++;
+		return layer;
+	}
+
+	/* ************************************************************************* */
+	bool Scene::remove(const LayerPtr& layer) {
+		vector<LayerPtr>::iterator it = find(layers_.begin(), layers_.end(), layer);
+		if (it == layers_.end()) return false;
+
+		// keep the scene version growing although the layer no longer counts
+		edits_ += layer->version() + layer->toggles() + 1;
+		layers_.erase(it);
+		return true;
+	}
+
+	/* ************************************************************************* */
+	void Scene::clear() {
+		while (!layers_.empty())
+			remove(layers_.back());
+	}
+
+	/* ************************************************************************* */
+	uint64_t Scene::version() const {
+		uint64_t version = edits_;
+		for (size_t i=0; i<layers_.size(); i++)
+			version += layers_[i]->version() + layers_[i]->toggles();
+		return version;
+	}
+
+	/* ************************************************************************* */
+	void Scene::draw() {
+		for (size_t i=0; i<layers_.size(); i++)
+			if (layers_[i]->visible())
+				layers_[i]->draw();
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,331 @@
+/*
+ * scene.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a retained scene made of typed layers that know when their content changed
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "render.h"
+#include "polyline.h"
+#include "channel.h"
+#include "covisibility.h"
+
+namespace sfmviewer {
+
+	typedef boost::function<void ()> Callback;
+
+	// a part of the scene. the version grows whenever the content changes, so that whatever was derived
+	// from an older version, such as gpu buffers, can be rebuilt lazily
+	class Layer {
+	public:
+		Layer() : version_(1), toggles_(0), visible_(true) {}
+		virtual ~Layer() {}
+
+		// draw the layer into the current opengl context
+		virtual void draw() = 0;
+
+		// the version of the content
+		uint64_t version() const { return version_; }
+
+		// tell the layer that the data it draws has changed
+		void touch() { version_++; }
+
+		bool visible() const { return visible_; }
+		void setVisible(const bool visible) { if (visible != visible_) { visible_ = visible; toggles_++; } }
+
+		// how often the visibility was switched
+		uint64_t toggles() const { return toggles_; }
+
+	private:
+		uint64_t version_;
+		uint64_t toggles_;
+		bool visible_;
+	};
+
+	typedef boost::shared_ptr<Layer> LayerPtr;
+
+	// 3D points with optional per-point colors and selections. the vectors are referenced, not copied,
+	// so they have to outlive the layer and touch() or colorsChanged() has to be called after changing them
+	class PointLayer : public Layer {
+	public:
+		PointLayer(const std::vector<Vertex>* structure, const std::vector<SFMColor>* pointColors = NULL)
+		: structure_(structure), pointColors_(pointColors), selected_(NULL), hidden_(NULL),
+		  highlight_(default_selection_color), builtVersion_(0) {}
+
+		// tell the layer that only the colors of the {changed} points changed, so that the next draw uploads
+		// just those. the indices may repeat
+		void colorsChanged(const std::vector<int>& changed);
+
+		// highlight the {selected} points and leave out the {hidden} ones, see drawStructure
+		void setSelection(const Selection* selected, const Selection* hidden = NULL,
+				const SFMColor& highlight = default_selection_color) {
+			selected_ = selected; hidden_ = hidden; highlight_ = highlight;
+		}
+
+		void draw();
+
+	private:
+		const std::vector<Vertex>* structure_;
+		const std::vector<SFMColor>* pointColors_;
+		const Selection* selected_;
+		const Selection* hidden_;
+		SFMColor highlight_;
+		uint64_t builtVersion_;     // the version the buffer was built from
+		std::vector<int> changed_;  // the points whose colors have to be written into it
+		VertexBuffer buffer_;
+	};
+
+	// camera frusta in one color or one color per camera, see drawCameras
+	class CameraLayer : public Layer {
+	public:
+		CameraLayer(const std::vector<CameraVertices>* cameras, const std::vector<SFMColor>* cameraColors = NULL,
+				const bool fill = true)
+		: cameras_(cameras), cameraColors_(cameraColors), color_(default_camera_color), fill_(fill), builtVersion_(0),
+		  numCameras_(0) {}
+
+		CameraLayer(const std::vector<CameraVertices>* cameras, const SFMColor& color, const bool fill = true)
+		: cameras_(cameras), cameraColors_(NULL), color_(color), fill_(fill), builtVersion_(0), numCameras_(0) {}
+
+		// tell the layer that only the colors of the {changed} cameras changed, see PointLayer::colorsChanged
+		void colorsChanged(const std::vector<int>& changed);
+
+		void draw();
+
+	private:
+		const std::vector<CameraVertices>* cameras_;
+		const std::vector<SFMColor>* cameraColors_;
+		SFMColor color_;
+		bool fill_;
+		uint64_t builtVersion_;
+		std::vector<int> changed_;
+		VertexBuffer buffer_;
+		size_t numCameras_;
+	};
+
+	// red, green and blue lines along the x, y and z axes of every pose, see drawRGBCameras
+	class AxisLayer : public Layer {
+	public:
+		AxisLayer(const std::vector<QuatPose>* poses, const float scale = 1.f, const GLfloat linewidth = 1.f)
+		: poses_(poses), scale_(scale), linewidth_(linewidth), numPoses_(0) {}
+
+		void draw();
+
+	private:
+		const std::vector<QuatPose>* poses_;
+		float scale_;
+		GLfloat linewidth_;
+		VertexBuffer buffer_;
+		size_t numPoses_;
+	};
+
+	// line segments between consecutive pairs of {endpoints}, with one color per endpoint or a fixed color
+	class LineLayer : public Layer {
+	public:
+		LineLayer(const std::vector<Vertex>* endpoints, const std::vector<SFMColor>* colors,
+				const GLfloat linewidth = 1.f)
+		: endpoints_(endpoints), colors_(colors), color_(0.f, 0.f, 0.f, 1.f), linewidth_(linewidth), numVertices_(0) {}
+
+		LineLayer(const std::vector<Vertex>* endpoints, const SFMColor& color, const GLfloat linewidth = 1.f)
+		: endpoints_(endpoints), colors_(NULL), color_(color), linewidth_(linewidth), numVertices_(0) {}
+
+		void draw();
+
+	private:
+		const std::vector<Vertex>* endpoints_;
+		const std::vector<SFMColor>* colors_;
+		SFMColor color_;
+		GLfloat linewidth_;
+		VertexBuffer buffer_;
+		size_t numVertices_;
+	};
+
+	// the edges of a covisibility graph between the camera {centers}, darker the more points they share. the edges
+	// are uploaded once sorted by their weight, so that a threshold only changes how many of them are drawn
+	class CovisibilityLayer : public Layer {
+	public:
+		CovisibilityLayer(const std::vector<Vertex>* centers, const std::vector<CovisibilityEdge>* edges,
+				const GLfloat linewidth = 1.f)
+		: centers_(centers), edges_(edges), linewidth_(linewidth), threshold_(1), builtVersion_(0), maxShared_(0) {}
+
+		// draw only the edges of at least {minShared} shared points, without uploading anything
+		void setThreshold(const uint32_t minShared);
+		uint32_t threshold() const { return threshold_; }
+
+		// the largest weight of the edges in the last upload
+		uint32_t maxShared() const { return maxShared_; }
+
+		void draw();
+
+	private:
+		const std::vector<Vertex>* centers_;
+		const std::vector<CovisibilityEdge>* edges_;
+		GLfloat linewidth_;
+		uint32_t threshold_;
+		uint64_t builtVersion_;          // the version the buffer was built from
+		std::vector<uint32_t> weights_;  // of the uploaded edges in decreasing order
+		uint32_t maxShared_;
+		VertexBuffer buffer_;
+	};
+
+	// the optical centers of a long sequence of poses as a line colored by time, see drawTrajectory. the line is
+	// simplified with PolylineLod to {pixelTolerance} pixels in the current view. after appending poses to the
+	// vector, call appended() instead of touch() so that only the new poses are processed and uploaded
+	class TrajectoryLayer : public Layer {
+	public:
+		TrajectoryLayer(const std::vector<QuatPose>* poses, const float pixelTolerance = 1.f,
+				const GLfloat linewidth = 1.f)
+		: poses_(poses), pixelTolerance_(pixelTolerance), linewidth_(linewidth), builtVersion_(0), appendVersion_(0),
+		  numDrawn_(0) {}
+
+		// tell the layer that poses were appended and the others stayed the same
+		void appended();
+
+		void draw();
+
+		// the number of vertices drawn in the last frame
+		size_t numDrawn() const { return numDrawn_; }
+
+	private:
+		// the index buffer of one level of detail and how many indices it holds
+		struct IndexLevel {
+			VertexBuffer buffer;
+			size_t size;
+			IndexLevel() : buffer(true), size(0) {}
+		};
+
+		// bring the centers, their simplification and the vertex buffer up to date
+		void update();
+
+		const std::vector<QuatPose>* poses_;
+		float pixelTolerance_;
+		GLfloat linewidth_;
+		uint64_t builtVersion_;    // the version the centers are computed from
+		uint64_t appendVersion_;   // the version that only appended poses to builtVersion_
+		std::vector<Vertex> centers_;
+		Vertex lower_, upper_;     // the bounding box of the centers
+		PolylineLod lod_;
+		VertexBuffer vertices_;
+		std::map<int, boost::shared_ptr<IndexLevel> > levels_;
+		size_t numDrawn_;
+	};
+
+	// the points and the camera frusta of an incremental reconstruction, each with the lifetime of the steps it is
+	// seen in, see drawLifetimeBuffer. everything is uploaded once and a step of the playback only sets a uniform,
+	// so playing costs the same for any size of the scene. the vectors are referenced, not copied, so they have
+	// to outlive the layer and touch() has to be called after changing them. the colors may be NULL or empty
+	class LifetimeLayer : public Layer {
+	public:
+		LifetimeLayer(const std::vector<Vertex>* structure, const std::vector<SFMColor>* pointColors,
+				const std::vector<Lifetime>* pointLifetimes, const std::vector<CameraVertices>* cameras,
+				const std::vector<SFMColor>* cameraColors, const std::vector<Lifetime>* cameraLifetimes,
+				const GLfloat fade = 0.25f)
+		: structure_(structure), pointColors_(pointColors), pointLifetimes_(pointLifetimes), cameras_(cameras),
+		  cameraColors_(cameraColors), cameraLifetimes_(cameraLifetimes), fade_(fade), step_(0.f), builtVersion_(0),
+		  numPoints_(0), numCameras_(0) {}
+
+		// show the scene at {step}, without uploading anything
+		void setStep(const GLfloat step);
+		GLfloat step() const { return step_; }
+
+		void draw();
+
+	private:
+		const std::vector<Vertex>* structure_;
+		const std::vector<SFMColor>* pointColors_;
+		const std::vector<Lifetime>* pointLifetimes_;
+		const std::vector<CameraVertices>* cameras_;
+		const std::vector<SFMColor>* cameraColors_;
+		const std::vector<Lifetime>* cameraLifetimes_;
+		GLfloat fade_;
+		GLfloat step_;
+		uint64_t builtVersion_;  // the version the buffers were built from
+		VertexBuffer points_;
+		VertexBuffer frusta_;
+		size_t numPoints_, numCameras_;
+	};
+
+	// the points and the camera axes another thread, e.g. an optimizer, publishes into {channel}. draw takes the
+	// latest complete snapshot without locking, so the canvas redraws at its own rate, see
+	// GLCanvas::setRefreshInterval, however often the producer publishes. the channel has to outlive the layer
+	class LiveLayer : public Layer {
+	public:
+		LiveLayer(SceneChannel* channel, const float axisScale = 1.f, const GLfloat linewidth = 1.f)
+		: channel_(channel), points_(&snapshot_.structure, &snapshot_.pointColors),
+		  axes_(&snapshot_.poses, axisScale, linewidth), serial_(0), skipped_(0) {}
+
+		void draw();
+
+		// the number of the snapshot drawn last, see TripleBuffer::serial
+		uint64_t serial() const { return serial_; }
+
+		// the published snapshots that were never drawn
+		uint64_t skipped() const { return skipped_; }
+
+	private:
+		SceneChannel* channel_;
+		SceneSnapshot snapshot_;  // swapped with the acquired one, so that nothing is copied
+		PointLayer points_;
+		AxisLayer axes_;
+		uint64_t serial_;
+		uint64_t skipped_;
+	};
+
+	// anything drawn by a callback in the old immediate style, it can not tell when it changes
+	class CallbackLayer : public Layer {
+	public:
+		CallbackLayer(const Callback& fun_draw = Callback()) : fun_draw_(fun_draw) {}
+
+		void setCallback(const Callback& fun_draw) { fun_draw_ = fun_draw; touch(); }
+
+		void draw() { if (fun_draw_) fun_draw_(); }
+
+	protected:
+		Callback fun_draw_;
+	};
+
+	// a callback drawing in window pixels with (0,0) at the top left and without depth test, e.g. labels and legends
+	class OverlayLayer : public CallbackLayer {
+	public:
+		OverlayLayer(const Callback& fun_draw = Callback()) : CallbackLayer(fun_draw) {}
+
+		void draw();
+	};
+
+	// the layers of a canvas, drawn in the order they were added
+	class Scene {
+	public:
+		Scene() : edits_(0) {}
+
+		// append a layer and return it
+		LayerPtr add(const LayerPtr& layer);
+
+		// remove a layer, returns false if it was not in the scene
+		bool remove(const LayerPtr& layer);
+
+		void clear();
+
+		size_t size() const { return layers_.size(); }
+		const LayerPtr& operator[](const size_t i) const { return layers_[i]; }
+
+		// changes whenever a layer is added, removed, changed, shown or hidden
+		uint64_t version() const;
+
+		// draw the visible layers
+		void draw();
+
+	private:
+		std::vector<LayerPtr> layers_;
+		uint64_t edits_;
+	};
+
+} // namespace sfmviewer
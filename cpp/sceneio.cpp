@@ -0,0 +1,145 @@
+/*
+ * sceneio.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: loading, saving and synthesizing reconstructions without gtsam
+ */
+
+#include <math.h>
+#include <fstream>
+#include <stdexcept>
+
+#include "sceneio.h"
+#include "camerabatch.h"
+#include "camerapath.h"
+
+#define LINESIZE 81920
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	void SceneData::calcCameras(vector<CameraVertices>& cameras, const float scale) const {
+		CameraBatch batch;
+		batch.resize(poses.size());
+		for (size_t i=0; i<poses.size(); i++)
+			batch.set(i, poses[i], fov, img_w, img_h);
+		calcCameraVertices(batch, img_w, img_h, scale, cameras);
+	}
+
+	/* ************************************************************************* */
+	bool loadSceneData(const string& filename, SceneData& data) {
+		ifstream is(filename.c_str());
+		if (!is) return false;
+
+		string tag;
+		while (is >> tag) {
+
+			// load 3D points
+			if (tag == "POINT3") {
+				double x, y, z, r, g, b;
+				is >> x >> y >> z >> r >> g >> b;
+				data.structure.push_back(Vertex(x, y, z));
+				data.pointColors.push_back(SFMColor(r, g, b, 1.0));
+			}
+
+			// load 3D camera
+			if (tag == "POSE3") {
+				float m[4][4] = {{0.}};
+				is >> m[0][3] >> m[1][3] >> m[2][3]
+				   >> m[0][0] >> m[0][1] >> m[0][2]
+				   >> m[1][0] >> m[1][1] >> m[1][2]
+				   >> m[2][0] >> m[2][1] >> m[2][2];
+				QuatPose pose(m[0][3], m[1][3], m[2][3], 0., 0., 0., 1.);
+				rotation_to_quaternion(m, pose.m_quat);
+				data.poses.push_back(pose);
+			}
+
+			is.ignore(LINESIZE, '\n');
+		}
+		return true;
+	}
+
+	/* ************************************************************************* */
+	void saveSceneData(const string& filename, const SceneData& data) {
+		ofstream os(filename.c_str());
+		if (!os)
+			throw runtime_error("saveSceneData: can not write " + filename);
+		os.precision(9);
+
+		for (size_t i=0; i<data.structure.size(); i++) {
+			const Vertex& v = data.structure[i];
+			os << "POINT3 " << v.X << " " << v.Y << " " << v.Z;
+			if (i < data.pointColors.size())
+				os << " " << data.pointColors[i].r << " " << data.pointColors[i].g << " " << data.pointColors[i].b << "\n";
+			else
+				os << " 0 0 0\n";
+		}
+
+		for (size_t i=0; i<data.poses.size(); i++) {
+			const QuatPose& pose = data.poses[i];
+			float r[3][3];
+			build_rotmatrix(r, pose.m_quat);
+			os << "POSE3 " << pose.x() << " " << pose.y() << " " << pose.z();
+			for (int row=0; row<3; row++)
+				os << " " << r[row][0] << " " << r[row][1] << " " << r[row][2];
+			os << "\n";
+		}
+	}
+
+	/* ************************************************************************* */
+	// xorshift random numbers, so that the same seed gives the same scene everywhere
+	static inline float uniform(unsigned int& state) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (state & 0xffffff) / (float)0x1000000;
+	}
+
+	/* ************************************************************************* */
+	void generateSyntheticScene(const size_t numPoints, const size_t numCameras, SceneData& data,
+			const unsigned int seed) {
+		unsigned int state = seed ? seed : 1;
+
+		// the scene sits at the center of the default orbit, the y axis points down
+		const float center_x = 0.f, center_z = 200.f, dome_radius = 100.f, ground_radius = 150.f;
+
+		data.structure.resize(numPoints);
+		data.pointColors.resize(numPoints, SFMColor(0.f, 0.f, 0.f, 1.f));
+		for (size_t i=0; i<numPoints; i++) {
+			float x, y, z;
+			if (i % 3 == 0) {
+				// a third of the points lie on the ground disc
+				float r = ground_radius * sqrt(uniform(state)), a = 2.f * M_PI * uniform(state);
+				x = center_x + r * cos(a);
+				y = 0.5f * (uniform(state) - 0.5f);
+				z = center_z + r * sin(a);
+			} else {
+				// the rest lies on a noisy dome
+				float a = 2.f * M_PI * uniform(state), b = 0.5f * M_PI * uniform(state);
+				float r = dome_radius * (1.f + 0.02f * (uniform(state) - 0.5f));
+				x = center_x + r * cos(b) * cos(a);
+				y = -r * sin(b);
+				z = center_z + r * cos(b) * sin(a);
+			}
+			data.structure[i] = Vertex(x, y, z);
+
+			// shade by height
+			float h = -y / dome_radius;
+			data.pointColors[i] = SFMColor(0.3f + 0.6f * h, 0.4f + 0.3f * h, 0.5f - 0.3f * h, 1.f);
+		}
+
+		// cameras look at the dome from a few stacked orbits
+		const int numOrbits = 4;
+		data.poses.resize(numCameras);
+		for (size_t i=0; i<numCameras; i++) {
+			int ring = i % numOrbits;
+			OrbitPath orbit(center_x, center_z, 250.f + 25.f * ring, -50.f - 50.f * ring, (numCameras + numOrbits - 1) / numOrbits,
+					-M_PI_4 * (0.1 + 0.1 * ring));
+			data.poses[i] = orbit.pose(i / numOrbits);
+		}
+	}
+
+} // namespace sfmviewer
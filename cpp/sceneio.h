@@ -0,0 +1,42 @@
+/*
+ * sceneio.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: loading, saving and synthesizing reconstructions without gtsam
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "render.h"
+
+namespace sfmviewer {
+
+	// a reconstruction as it is stored in the POINT3 / POSE3 text files
+	struct SceneData {
+		std::vector<Vertex> structure;       // 3d points
+		std::vector<SFMColor> pointColors;   // the colors of 3d points
+		std::vector<QuatPose> poses;         // the camera poses, (R,t) maps camera to world coordinates
+		float fov;                           // the horizontal field of view of the cameras in degrees
+		int img_w, img_h;                    // the image size of the cameras
+
+		SceneData() : fov(120.f), img_w(1600), img_h(1600) {}
+
+		// backproject four corners of every camera, see calcCameraVertices in render.h
+		void calcCameras(std::vector<CameraVertices>& cameras, const float scale = 7.f) const;
+	};
+
+	// load POINT3 and POSE3 lines, the rotations are stored row by row, returns false if the file is not readable
+	bool loadSceneData(const std::string& filename, SceneData& data);
+
+	// save POINT3 and POSE3 lines readable by loadSceneData
+	void saveSceneData(const std::string& filename, const SceneData& data);
+
+	// generate a dome over a ground disc, watched by cameras on stacked orbits
+	void generateSyntheticScene(const size_t numPoints, const size_t numCameras, SceneData& data,
+			const unsigned int seed = 1);
+
+} // namespace sfmviewer
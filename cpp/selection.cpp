@@ -0,0 +1,300 @@
+/*
+ * selection.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: sets of points picked by rectangles or lassos, stored as bitsets
+ */
+
+#include <math.h>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "selection.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	// the pixel coordinates of world points, px = a.p / c.p and py = b.p / c.p with the depth c.p,
+	// the same perspective as setGLProjection with pixel (0,0) at the top left
+	struct ScreenProjection {
+		float a[4], b[4], c[4];
+
+		ScreenProjection(const QuatPose& pose, const int width, const int height) {
+			float r[3][3];
+			build_rotmatrix(r, pose.m_quat);
+			float f = 0.5f * height / tan(default_fovy * M_PI / 360.);
+			float cx = 0.5f * width, cy = 0.5f * height;
+
+			// the rows of [R' -R't]
+			float m[3][4];
+			for (int k=0; k<3; k++) {
+				m[k][0] = r[0][k]; m[k][1] = r[1][k]; m[k][2] = r[2][k];
+				m[k][3] = -(r[0][k] * pose.x() + r[1][k] * pose.y() + r[2][k] * pose.z());
+			}
+			for (int j=0; j<4; j++) {
+				a[j] = f * m[0][j] + cx * m[2][j];
+				b[j] = f * m[1][j] + cy * m[2][j];
+				c[j] = m[2][j];
+			}
+		}
+	};
+
+	/* ************************************************************************* */
+	// project up to 64 points, the bits tell which ones fall into [x0,x1) x [y0,y1) in front of the camera
+	static uint64_t projectWord(const Vertex* points, const size_t count, const ScreenProjection& P,
+			const float x0, const float y0, const float x1, const float y1, float px[64], float py[64]) {
+		uint64_t word = 0;
+		size_t i = 0;
+#ifdef __SSE2__
+		const __m128 a0 = _mm_set1_ps(P.a[0]), a1 = _mm_set1_ps(P.a[1]), a2 = _mm_set1_ps(P.a[2]), a3 = _mm_set1_ps(P.a[3]);
+		const __m128 b0 = _mm_set1_ps(P.b[0]), b1 = _mm_set1_ps(P.b[1]), b2 = _mm_set1_ps(P.b[2]), b3 = _mm_set1_ps(P.b[3]);
+		const __m128 c0 = _mm_set1_ps(P.c[0]), c1 = _mm_set1_ps(P.c[1]), c2 = _mm_set1_ps(P.c[2]), c3 = _mm_set1_ps(P.c[3]);
+		const __m128 near = _mm_set1_ps(default_near);
+		const __m128 xmin = _mm_set1_ps(x0), xmax = _mm_set1_ps(x1), ymin = _mm_set1_ps(y0), ymax = _mm_set1_ps(y1);
+		for (; i + 4 <= count; i += 4) {
+			// transpose four xyz vertices into x, y and z lanes
+			const float* p = &points[i].X;
+			__m128 v0 = _mm_loadu_ps(p), v1 = _mm_loadu_ps(p + 4), v2 = _mm_loadu_ps(p + 8);
+			__m128 x2y2x3y3 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2,1,3,2));
+			__m128 y0z0y1z1 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1,0,2,1));
+			__m128 x = _mm_shuffle_ps(v0, x2y2x3y3, _MM_SHUFFLE(2,0,3,0));
+			__m128 y = _mm_shuffle_ps(y0z0y1z1, x2y2x3y3, _MM_SHUFFLE(3,1,2,0));
+			__m128 z = _mm_shuffle_ps(y0z0y1z1, v2, _MM_SHUFFLE(3,0,3,1));
+
+			__m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, x), _mm_mul_ps(c1, y)), _mm_add_ps(_mm_mul_ps(c2, z), c3));
+			__m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, x), _mm_mul_ps(a1, y)), _mm_add_ps(_mm_mul_ps(a2, z), a3));
+			__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, x), _mm_mul_ps(b1, y)), _mm_add_ps(_mm_mul_ps(b2, z), b3));
+			u = _mm_div_ps(u, depth);
+			v = _mm_div_ps(v, depth);
+			_mm_storeu_ps(px + i, u);
+			_mm_storeu_ps(py + i, v);
+
+			__m128 inside = _mm_and_ps(_mm_cmpgt_ps(depth, near),
+					_mm_and_ps(_mm_and_ps(_mm_cmpge_ps(u, xmin), _mm_cmplt_ps(u, xmax)),
+							_mm_and_ps(_mm_cmpge_ps(v, ymin), _mm_cmplt_ps(v, ymax))));
+			word |= (uint64_t)_mm_movemask_ps(inside) << i;
+		}
+#endif
+		for (; i < count; i++) {
+			const Vertex& p = points[i];
+			float depth = P.c[0] * p.X + P.c[1] * p.Y + P.c[2] * p.Z + P.c[3];
+			px[i] = (P.a[0] * p.X + P.a[1] * p.Y + P.a[2] * p.Z + P.a[3]) / depth;
+			py[i] = (P.b[0] * p.X + P.b[1] * p.Y + P.b[2] * p.Z + P.b[3]) / depth;
+			if (depth > default_near && px[i] >= x0 && px[i] < x1 && py[i] >= y0 && py[i] < y1)
+				word |= (uint64_t)1 << i;
+		}
+		return word;
+	}
+
+	/* ************************************************************************* */
+	// the pixels inside a polygon by the even-odd rule, sampled at the pixel centers
+	struct LassoMask {
+		int left, top, width, height;
+		vector<unsigned char> mask;
+
+		LassoMask(const QPolygon& lasso, const QRect& bounds) :
+			left(bounds.left()), top(bounds.top()), width(bounds.width()), height(bounds.height()),
+			mask((size_t)max(width, 0) * max(height, 0), 0) {
+			vector<float> crossings;
+			for (int row=0; row<height; row++) {
+				float y = top + row + 0.5f;
+				crossings.clear();
+				for (int k=0; k<lasso.size(); k++) {
+					const QPoint& p = lasso[k];
+					const QPoint& q = lasso[(k + 1) % lasso.size()];
+					if ((p.y() <= y) != (q.y() <= y))
+						crossings.push_back(p.x() + (y - p.y()) * (q.x() - p.x()) / (float)(q.y() - p.y()));
+				}
+				sort(crossings.begin(), crossings.end());
+				for (size_t k=0; k + 1 < crossings.size(); k += 2) {
+					int from = max(0, (int)ceil(crossings[k] - 0.5f - left));
+					int to = min(width, (int)ceil(crossings[k+1] - 0.5f - left));
+					for (int col=from; col<to; col++)
+						mask[(size_t)row * width + col] = 1;
+				}
+			}
+		}
+
+		bool inside(const float px, const float py) const {
+			int col = (int)floor(px) - left, row = (int)floor(py) - top;
+			return col >= 0 && col < width && row >= 0 && row < height && mask[(size_t)row * width + col];
+		}
+	};
+
+	/* ************************************************************************* */
+	static inline uint64_t combine(const uint64_t old, const uint64_t word, const Selection::Mode mode) {
+		switch (mode) {
+		case Selection::ADD:      return old | word;
+		case Selection::SUBTRACT: return old & ~word;
+		default:                  return word;
+		}
+	}
+
+	/* ************************************************************************* */
+	Selection::Selection(const size_t numPoints) : size_(0), version_(0), texture_(0), textureRows_(0),
+			dirtyBegin_(0), dirtyEnd_(0) {
+		resize(numPoints);
+	}
+
+	/* ************************************************************************* */
+	Selection::~Selection() {
+		// the texture belongs to the opengl context, which may already be gone
+	}
+
+	/* ************************************************************************* */
+	void Selection::resize(const size_t numPoints) {
+		size_ = numPoints;
+		words_.assign((numPoints + 63) / 64, 0);
+		touch(0, words_.size());
+	}
+
+	/* ************************************************************************* */
+	void Selection::touch(const size_t begin, const size_t end) {
+		if (dirtyBegin_ >= dirtyEnd_) {
+			dirtyBegin_ = begin;
+			dirtyEnd_ = end;
+		} else {
+			dirtyBegin_ = min(dirtyBegin_, begin);
+			dirtyEnd_ = max(dirtyEnd_, end);
+		}
+		version_++;
+	}
+
+	/* ************************************************************************* */
+	void Selection::set(const size_t i, const bool on) {
+		uint64_t bit = (uint64_t)1 << (i & 63);
+		if (on)
+			words_[i >> 6] |= bit;
+		else
+			words_[i >> 6] &= ~bit;
+		touch(i >> 6, (i >> 6) + 1);
+	}
+
+	/* ************************************************************************* */
+	void Selection::keepRows(const vector<uint32_t>& rows) {
+		vector<uint64_t> words((rows.size() + 63) / 64, 0);
+		for (size_t k=0; k<rows.size(); k++)
+			if (rows[k] < size_ && test(rows[k]))
+				words[k >> 6] |= (uint64_t)1 << (k & 63);
+		size_ = rows.size();
+		words_.swap(words);
+		touch(0, words_.size());
+	}
+
+	/* ************************************************************************* */
+	void Selection::clear() {
+		fill(words_.begin(), words_.end(), 0);
+		touch(0, words_.size());
+	}
+
+	/* ************************************************************************* */
+	void Selection::merge(const Selection& other) {
+		size_t n = min(words_.size(), other.words_.size());
+		for (size_t w=0; w<n; w++)
+			words_[w] |= other.words_[w];
+		touch(0, n);
+	}
+
+	/* ************************************************************************* */
+	size_t Selection::count() const {
+		long long total = 0;
+#pragma omp parallel for reduction(+:total)
+		for (long long w=0; w<(long long)words_.size(); w++)
+			total += __builtin_popcountll(words_[w]);
+		return total;
+	}
+
+	/* ************************************************************************* */
+	void Selection::selectRect(const vector<Vertex>& structure, const QuatPose& pose, const int width, const int height,
+			const QRect& rect, const Mode mode) {
+		if (structure.size() != size_) resize(structure.size());
+		if (structure.empty()) return;
+
+		ScreenProjection P(pose, width, height);
+		QRect r = rect.normalized();
+		float x0 = r.left(), y0 = r.top(), x1 = r.right() + 1, y1 = r.bottom() + 1;
+
+		// every thread owns whole words
+#pragma omp parallel for schedule(static)
+		for (long long w=0; w<(long long)words_.size(); w++) {
+			float px[64], py[64];
+			size_t begin = w * 64;
+			uint64_t word = projectWord(&structure[begin], min((size_t)64, size_ - begin), P, x0, y0, x1, y1, px, py);
+			words_[w] = combine(words_[w], word, mode);
+		}
+		touch(0, words_.size());
+	}
+
+	/* ************************************************************************* */
+	void Selection::selectLasso(const vector<Vertex>& structure, const QuatPose& pose, const int width, const int height,
+			const QPolygon& lasso, const Mode mode) {
+		if (structure.size() != size_) resize(structure.size());
+		if (structure.empty() || lasso.size() < 3) {
+			if (mode == REPLACE) clear();
+			return;
+		}
+
+		ScreenProjection P(pose, width, height);
+		LassoMask mask(lasso, lasso.boundingRect().intersected(QRect(0, 0, width, height)));
+		float x0 = mask.left, y0 = mask.top, x1 = mask.left + mask.width, y1 = mask.top + mask.height;
+
+#pragma omp parallel for schedule(static)
+		for (long long w=0; w<(long long)words_.size(); w++) {
+			float px[64], py[64];
+			size_t begin = w * 64;
+			uint64_t candidates = projectWord(&structure[begin], min((size_t)64, size_ - begin), P, x0, y0, x1, y1, px, py);
+
+			// only the points inside the bounding box look up the mask
+			uint64_t word = 0;
+			while (candidates) {
+				int i = __builtin_ctzll(candidates);
+				candidates &= candidates - 1;
+				if (mask.inside(px[i], py[i]))
+					word |= (uint64_t)1 << i;
+			}
+			words_[w] = combine(words_[w], word, mode);
+		}
+		touch(0, words_.size());
+	}
+
+	/* ************************************************************************* */
+	GLuint Selection::texture() const {
+		size_t rows = max((size_t)1, (words_.size() * 8 + textureWidth - 1) / textureWidth);
+		if (texture_ == 0 || !glIsTexture(texture_) || rows != textureRows_) {
+			if (texture_ != 0 && glIsTexture(texture_))
+				glDeleteTextures(1, &texture_);
+			glGenTextures(1, &texture_);
+			glBindTexture(GL_TEXTURE_2D, texture_);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, textureWidth, rows, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+			textureRows_ = rows;
+			dirtyBegin_ = 0;
+			dirtyEnd_ = words_.size();
+		}
+		if (dirtyBegin_ >= dirtyEnd_)
+			return texture_;
+
+		// upload whole rows that cover the changed words, the bytes of a word are in little endian order
+		glBindTexture(GL_TEXTURE_2D, texture_);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		const unsigned char* bytes = (const unsigned char*)&words_[0];
+		size_t numBytes = words_.size() * 8;
+		size_t firstRow = dirtyBegin_ * 8 / textureWidth, lastRow = (dirtyEnd_ * 8 - 1) / textureWidth;
+		size_t fullRows = min(lastRow + 1, numBytes / textureWidth);
+		if (fullRows > firstRow)
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, textureWidth, fullRows - firstRow, GL_LUMINANCE, GL_UNSIGNED_BYTE,
+					bytes + firstRow * textureWidth);
+		if (lastRow >= fullRows)
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, lastRow, numBytes - lastRow * textureWidth, 1, GL_LUMINANCE, GL_UNSIGNED_BYTE,
+					bytes + lastRow * textureWidth);
+		dirtyBegin_ = dirtyEnd_ = 0;
+		return texture_;
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,94 @@
+/*
+ * selection.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: sets of points picked by rectangles or lassos, stored as bitsets
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <QRect>
+#include <QPolygon>
+
+#include "render.h"
+
+namespace sfmviewer {
+
+	// one bit per point, shared with the renderer as a texture
+	class Selection {
+
+	public:
+		// how a new region combines with the current selection
+		enum Mode { REPLACE, ADD, SUBTRACT };
+
+		Selection(const size_t numPoints = 0);
+
+		~Selection();
+
+		// resize to {numPoints} unselected points
+		void resize(const size_t numPoints);
+
+		size_t size() const { return size_; }
+
+		bool test(const size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
+
+		void set(const size_t i, const bool on = true);
+
+		// keep only the listed points, point k of the result is point {rows}[k], e.g. after outliers were removed
+		void keepRows(const std::vector<uint32_t>& rows);
+
+		// unselect all the points
+		void clear();
+
+		// add all the points selected in {other}
+		void merge(const Selection& other);
+
+		// the number of selected points
+		size_t count() const;
+
+		// select the points that project inside {rect} of a {width} x {height} canvas seen from {pose}
+		void selectRect(const std::vector<Vertex>& structure, const QuatPose& pose, const int width, const int height,
+				const QRect& rect, const Mode mode = REPLACE);
+
+		// select the points that project inside the closed polygon {lasso}
+		void selectLasso(const std::vector<Vertex>& structure, const QuatPose& pose, const int width, const int height,
+				const QPolygon& lasso, const Mode mode = REPLACE);
+
+		// copy the selected elements of {all} into {selected}
+		template<class T>
+		void extract(const std::vector<T>& all, std::vector<T>& selected) const {
+			selected.clear();
+			for (size_t i=0; i<all.size() && i<size_; i++)
+				if (test(i)) selected.push_back(all[i]);
+		}
+
+		// 64 points per word, the first point in the lowest bit
+		const std::vector<uint64_t>& words() const { return words_; }
+
+		// increases whenever the selection changes
+		size_t version() const { return version_; }
+
+		// a luminance texture holding the bits, only the changed rows are uploaded again
+		GLuint texture() const;
+
+		// the width of texture()
+		static const int textureWidth = 4096;
+
+	private:
+		// mark the words [begin, end) as changed
+		void touch(const size_t begin, const size_t end);
+
+		size_t size_;
+		std::vector<uint64_t> words_;
+		size_t version_;
+
+		// the texture in the current opengl context and the words that changed since the last upload
+		mutable GLuint texture_;
+		mutable size_t textureRows_;
+		mutable size_t dirtyBegin_, dirtyEnd_;
+	};
+
+} // namespace sfmviewer
@@ -0,0 +1,192 @@
+/*
+ * sharedscene.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a reconstruction in POSIX shared memory, loaded once and mapped by every viewer on the machine
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdexcept>
+
+#include "sharedscene.h"
+#include "camerabatch.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	// the beginning of a shared scene, followed by the points, their colors and the poses at the given offsets
+	struct SharedSceneHeader {
+		char magic[8];
+		uint32_t layout;         // the sizes of the array elements, so that mismatching builds do not attach
+		uint32_t complete;       // set after the arrays are written
+		uint64_t numPoints, numColors, numPoses;
+		uint64_t structureOffset, colorsOffset, posesOffset, bytes;
+		float fov;
+		int32_t img_w, img_h;
+	};
+
+	static const char shared_scene_magic[8] = {'S', 'F', 'M', 'S', 'C', 'E', 'N', 'E'};
+	static const uint32_t shared_scene_layout = sizeof(Vertex) | sizeof(SFMColor) << 8 | sizeof(QuatPose) << 16;
+
+	/* ************************************************************************* */
+	// the offset of an array after {offset}, at the start of a cache line
+	static uint64_t alignOffset(const uint64_t offset) {
+		return (offset + 63) / 64 * 64;
+	}
+
+	/* ************************************************************************* */
+	static string errorMessage(const string& func, const string& name) {
+		return func + ": " + name + ": " + strerror(errno);
+	}
+
+	/* ************************************************************************* */
+	void publishSharedScene(const string& name, const SceneData& data) {
+		if (!data.pointColors.empty() && data.pointColors.size() != data.structure.size())
+			throw std::runtime_error("publishSharedScene: no. of colors != no. of points");
+
+		SharedSceneHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, shared_scene_magic, sizeof(header.magic));
+		header.layout = shared_scene_layout;
+		header.numPoints = data.structure.size();
+		header.numColors = data.pointColors.size();
+		header.numPoses = data.poses.size();
+		header.structureOffset = alignOffset(sizeof(SharedSceneHeader));
+		header.colorsOffset = alignOffset(header.structureOffset + header.numPoints * sizeof(Vertex));
+		header.posesOffset = alignOffset(header.colorsOffset + header.numColors * sizeof(SFMColor));
+		header.bytes = header.posesOffset + header.numPoses * sizeof(QuatPose);
+		header.fov = data.fov;
+		header.img_w = data.img_w;
+		header.img_h = data.img_h;
+
+		// a new object, the viewers that attached to the old one keep it until they unmap it
+		shm_unlink(name.c_str());
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+		if (fd < 0)
+			throw std::runtime_error(errorMessage("publishSharedScene", name));
+		if (ftruncate(fd, header.bytes) != 0) {
+			close(fd);
+			shm_unlink(name.c_str());
+			throw std::runtime_error(errorMessage("publishSharedScene", name));
+		}
+		void* mapping = mmap(NULL, header.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			shm_unlink(name.c_str());
+			throw std::runtime_error(errorMessage("publishSharedScene", name));
+		}
+
+		char* base = (char*)mapping;
+		memcpy(base, &header, sizeof(header));
+		if (header.numPoints) memcpy(base + header.structureOffset, &data.structure[0], header.numPoints * sizeof(Vertex));
+		if (header.numColors) memcpy(base + header.colorsOffset, &data.pointColors[0], header.numColors * sizeof(SFMColor));
+		if (header.numPoses) memcpy(base + header.posesOffset, &data.poses[0], header.numPoses * sizeof(QuatPose));
+
+		// a viewer attaching meanwhile finds the scene incomplete instead of reading half of it
+		__sync_synchronize();
+		((SharedSceneHeader*)base)->complete = 1;
+		munmap(mapping, header.bytes);
+	}
+
+	/* ************************************************************************* */
+	bool removeSharedScene(const string& name) {
+		return shm_unlink(name.c_str()) == 0;
+	}
+
+	/* ************************************************************************* */
+	SharedScene::SharedScene(const string& name) : mapping_(NULL), bytes_(0) {
+		int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0)
+			throw std::runtime_error(errorMessage("SharedScene", name));
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SharedSceneHeader)) {
+			close(fd);
+			throw std::runtime_error("SharedScene: " + name + " is not a scene");
+		}
+		bytes_ = st.st_size;
+		mapping_ = mmap(NULL, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapping_ == MAP_FAILED)
+			throw std::runtime_error(errorMessage("SharedScene", name));
+
+		const SharedSceneHeader& header = *(const SharedSceneHeader*)mapping_;
+		string error;
+		if (memcmp(header.magic, shared_scene_magic, sizeof(header.magic)) != 0 || header.bytes != bytes_)
+			error = " is not a scene";
+		else if (header.layout != shared_scene_layout)
+			error = " was published by an incompatible build";
+		else if (!header.complete)
+			error = " is still being published";
+		else if ((header.numColors && header.numColors != header.numPoints)
+				|| header.structureOffset + header.numPoints * sizeof(Vertex) > bytes_
+				|| header.colorsOffset + header.numColors * sizeof(SFMColor) > bytes_
+				|| header.posesOffset + header.numPoses * sizeof(QuatPose) > bytes_)
+			error = " is corrupted";
+		if (!error.empty()) {
+			munmap(mapping_, bytes_);
+			throw std::runtime_error("SharedScene: " + name + error);
+		}
+		__sync_synchronize();
+
+		const char* base = (const char*)mapping_;
+		numPoints_ = header.numPoints;
+		numPoses_ = header.numPoses;
+		structure_ = (const Vertex*)(base + header.structureOffset);
+		pointColors_ = header.numColors ? (const SFMColor*)(base + header.colorsOffset) : NULL;
+		poses_ = (const QuatPose*)(base + header.posesOffset);
+		fov_ = header.fov;
+		img_w_ = header.img_w;
+		img_h_ = header.img_h;
+	}
+
+	/* ************************************************************************* */
+	SharedScene::~SharedScene() {
+		munmap(mapping_, bytes_);
+	}
+
+	/* ************************************************************************* */
+	void SharedSceneLayer::draw() {
+		if (!scene_) return;
+		const size_t numPoints = scene_->numPoints();
+		const bool hasColors = scene_->pointColors() != NULL;
+
+		// the points are written from the mapping without a copy in between
+		if (!points_.isCurrent(version())) {
+			const size_t vertexBytes = numPoints * sizeof(Vertex);
+			points_.allocate(vertexBytes + (hasColors ? numPoints * sizeof(SFMColor) : 0), version());
+			if (numPoints) points_.write(0, scene_->structure(), vertexBytes);
+			if (numPoints && hasColors) points_.write(vertexBytes, scene_->pointColors(), numPoints * sizeof(SFMColor));
+		}
+
+		if (!cameras_.isCurrent(version())) {
+			numCameras_ = scene_->numPoses();
+			CameraBatch batch;
+			batch.resize(numCameras_);
+			for (size_t i=0; i<numCameras_; i++)
+				batch.set(i, scene_->poses()[i], scene_->fov(), scene_->img_w(), scene_->img_h());
+			vector<CameraVertices> frusta;
+			calcCameraVertices(batch, scene_->img_w(), scene_->img_h(), cameraScale_, frusta);
+
+			vector<Vertex> vertices;
+			vector<SFMColor> colors;
+			fillCameraArrays(frusta, NULL, default_camera_color, vertices, colors);
+			const size_t vertexBytes = vertices.size() * sizeof(Vertex);
+			cameras_.allocate(vertexBytes + colors.size() * sizeof(SFMColor), version());
+			if (!vertices.empty()) {
+				cameras_.write(0, &vertices[0], vertexBytes);
+				cameras_.write(vertexBytes, &colors[0], colors.size() * sizeof(SFMColor));
+			}
+		}
+
+		drawStructure(points_, numPoints, hasColors);
+		drawCameras(cameras_, numCameras_);
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,81 @@
+/*
+ * sharedscene.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: a reconstruction in POSIX shared memory, loaded once and mapped by every viewer on the machine
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "scene.h"
+#include "sceneio.h"
+
+namespace sfmviewer {
+
+	// copy {data} into the shared memory object {name}, e.g. "/sfmviewer", which stays until removeSharedScene
+	// even after the process exits. an older object of the same name is replaced, the viewers that mapped it keep
+	// their copy
+	void publishSharedScene(const std::string& name, const SceneData& data);
+
+	// remove the shared memory object {name}, returns false if there was none
+	bool removeSharedScene(const std::string& name);
+
+	// a read-only mapping of a scene published by publishSharedScene. the arrays point into the pages shared
+	// by all the processes, so attaching costs neither parsing nor memory of its own
+	class SharedScene {
+	public:
+		// map the object {name}, throws if it does not exist or is not a complete scene
+		explicit SharedScene(const std::string& name);
+		~SharedScene();
+
+		size_t numPoints() const { return numPoints_; }
+		size_t numPoses() const { return numPoses_; }
+
+		const Vertex* structure() const { return structure_; }
+		const SFMColor* pointColors() const { return pointColors_; }  // NULL if the points have no colors
+		const QuatPose* poses() const { return poses_; }
+
+		float fov() const { return fov_; }
+		int img_w() const { return img_w_; }
+		int img_h() const { return img_h_; }
+
+		// the size of the mapping in bytes
+		size_t bytes() const { return bytes_; }
+
+	private:
+		SharedScene(const SharedScene&);
+		SharedScene& operator=(const SharedScene&);
+
+		void* mapping_;
+		size_t bytes_;
+		size_t numPoints_, numPoses_;
+		const Vertex* structure_;
+		const SFMColor* pointColors_;
+		const QuatPose* poses_;
+		float fov_;
+		int img_w_, img_h_;
+	};
+
+	// the points and the camera frusta of a shared scene. the points go from the mapping straight into a vertex
+	// buffer, only the frusta are computed in the process. the scene has to outlive the layer
+	class SharedSceneLayer : public Layer {
+	public:
+		SharedSceneLayer(const SharedScene* scene, const float cameraScale = 7.f)
+		: scene_(scene), cameraScale_(cameraScale), points_(), cameras_(), numCameras_(0) {}
+
+		void draw();
+
+	private:
+		const SharedScene* scene_;
+		float cameraScale_;
+		VertexBuffer points_;
+		VertexBuffer cameras_;
+		size_t numCameras_;
+	};
+
+} // namespace sfmviewer
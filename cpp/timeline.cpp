@@ -0,0 +1,131 @@
+/*
+ * timeline.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: seeking to any step of a playback of highlighted sets through the differences between steps
+ */
+
+#include <float.h>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "timeline.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	HighlightTimeline::HighlightTimeline(const vector<vector<int> >& sets, const size_t numItems)
+	: setOffsets_(sets.size() + 1, 0), highlighted_(numItems, 0), current_(0) {
+		for (size_t k=0; k<sets.size(); k++) {
+			for (size_t j=0; j<sets[k].size(); j++)
+				if (sets[k][j] < 0 || (size_t)sets[k][j] >= numItems)
+					throw std::runtime_error("HighlightTimeline: item index out of range");
+			setOffsets_[k + 1] = setOffsets_[k] + sets[k].size();
+		}
+
+		// the sets sorted and without duplicates, compacted afterwards
+		items_.resize(setOffsets_.back());
+		vector<uint32_t> sizes(sets.size());
+#pragma omp parallel for schedule(dynamic, 16)
+		for (long k=0; k<(long)sets.size(); k++) {
+			int* first = &items_[0] + setOffsets_[k];
+			copy(sets[k].begin(), sets[k].end(), first);
+			sort(first, first + sets[k].size());
+			sizes[k] = unique(first, first + sets[k].size()) - first;
+		}
+		for (size_t k=0, first=0; k<sets.size(); k++) {
+			const size_t next = setOffsets_[k + 1];
+			copy(items_.begin() + first, items_.begin() + first + sizes[k], items_.begin() + setOffsets_[k]);
+			setOffsets_[k + 1] = setOffsets_[k] + sizes[k];
+			first = next;
+		}
+		items_.resize(setOffsets_.back());
+
+		// the items entering and leaving between consecutive steps
+		const size_t numDiffs = sets.empty() ? 0 : sets.size() - 1;
+		vector<vector<int> > diffs(numDiffs);
+		enterEnds_.resize(numDiffs);
+#pragma omp parallel for schedule(dynamic, 16)
+		for (long k=0; k<(long)numDiffs; k++) {
+			set_difference(begin(k + 1), end(k + 1), begin(k), end(k), back_inserter(diffs[k]));
+			enterEnds_[k] = diffs[k].size();
+			set_difference(begin(k), end(k), begin(k + 1), end(k + 1), back_inserter(diffs[k]));
+		}
+		diffOffsets_.assign(numDiffs + 1, 0);
+		diffCosts_.assign(numDiffs + 1, 0);
+		for (size_t k=0; k<numDiffs; k++) {
+			diffOffsets_[k + 1] = diffOffsets_[k] + diffs[k].size();
+			diffCosts_[k + 1] = diffCosts_[k] + diffs[k].size();
+			enterEnds_[k] += diffOffsets_[k];
+		}
+		diffItems_.reserve(diffOffsets_.back());
+		for (size_t k=0; k<numDiffs; k++)
+			diffItems_.insert(diffItems_.end(), diffs[k].begin(), diffs[k].end());
+
+		if (!sets.empty()) highlight(begin(0), end(0), true);
+	}
+
+	/* ************************************************************************* */
+	// whether dropping the current set and highlighting the one of {step} is cheaper than the diffs in between
+	bool HighlightTimeline::replaceSet(const size_t step) const {
+		const uint64_t diffs = step > current_ ? diffCosts_[step] - diffCosts_[current_] : diffCosts_[current_] - diffCosts_[step];
+		return (uint64_t)(setOffsets_[current_ + 1] - setOffsets_[current_]) + (setOffsets_[step + 1] - setOffsets_[step]) < diffs;
+	}
+
+	/* ************************************************************************* */
+	size_t HighlightTimeline::cost(const size_t step) const {
+		if (step >= numSteps())
+			throw std::runtime_error("HighlightTimeline::cost: step out of range");
+		if (replaceSet(step))
+			return (setOffsets_[current_ + 1] - setOffsets_[current_]) + (setOffsets_[step + 1] - setOffsets_[step]);
+		return step > current_ ? diffCosts_[step] - diffCosts_[current_] : diffCosts_[current_] - diffCosts_[step];
+	}
+
+	/* ************************************************************************* */
+	void HighlightTimeline::highlight(const int* first, const int* last, const bool on) {
+		for (const int* i=first; i!=last; i++) {
+			highlighted_[*i] = on;
+			changed_.push_back(*i);
+		}
+	}
+
+	/* ************************************************************************* */
+	const vector<int>& HighlightTimeline::seek(const size_t step) {
+		if (step >= numSteps())
+			throw std::runtime_error("HighlightTimeline::seek: step out of range");
+		changed_.clear();
+		if (step == current_) return changed_;
+
+		if (replaceSet(step)) {
+			highlight(begin(current_), end(current_), false);
+			highlight(begin(step), end(step), true);
+		} else if (step > current_) {
+			for (size_t k=current_; k<step; k++) {
+				highlight(diff(diffOffsets_[k]), diff(enterEnds_[k]), true);
+				highlight(diff(enterEnds_[k]), diff(diffOffsets_[k + 1]), false);
+			}
+		} else {
+			for (size_t k=current_; k-->step; ) {
+				highlight(diff(enterEnds_[k]), diff(diffOffsets_[k + 1]), true);
+				highlight(diff(diffOffsets_[k]), diff(enterEnds_[k]), false);
+			}
+		}
+		current_ = step;
+		return changed_;
+	}
+
+	/* ************************************************************************* */
+	void HighlightTimeline::lifetimes(vector<Lifetime>& lifetimes) const {
+		lifetimes.assign(numItems(), Lifetime(FLT_MAX, FLT_MAX));
+		for (size_t k=0; k<numSteps(); k++)
+			for (const int* i=begin(k); i!=end(k); i++) {
+				if (lifetimes[*i].first == FLT_MAX) lifetimes[*i].first = k;
+				lifetimes[*i].last = k;
+			}
+	}
+
+} // namespace sfmviewer
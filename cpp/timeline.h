@@ -0,0 +1,66 @@
+/*
+ * timeline.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: seeking to any step of a playback of highlighted sets through the differences between steps
+ */
+
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lifetime.h"
+
+namespace sfmviewer {
+
+	// the items highlighted at every step of a playback, e.g. the points a camera of a video sees. the items
+	// entering and leaving the set between consecutive steps are precomputed, so that seeking applies them forward
+	// or backward. a long jump replaces the whole set instead if that touches fewer items, so a seek costs the
+	// number of changes and never the number of items
+	class HighlightTimeline {
+	public:
+		HighlightTimeline() : current_(0) {}
+
+		// the timeline of {sets}, the indices out of {numItems} highlighted at every step. starts at step 0
+		HighlightTimeline(const std::vector<std::vector<int> >& sets, const size_t numItems);
+
+		size_t numSteps() const { return setOffsets_.empty() ? 0 : setOffsets_.size() - 1; }
+		size_t numItems() const { return highlighted_.size(); }
+		size_t current() const { return current_; }
+
+		// whether item {i} is highlighted at the current step
+		bool highlighted(const size_t i) const { return highlighted_[i]; }
+
+		// the items highlighted at {step}
+		const int* begin(const size_t step) const { return items_.empty() ? NULL : &items_[0] + setOffsets_[step]; }
+		const int* end(const size_t step) const { return items_.empty() ? NULL : &items_[0] + setOffsets_[step + 1]; }
+
+		// move to {step} and return the items whose highlight may have changed, possibly more than once
+		const std::vector<int>& seek(const size_t step);
+
+		// the number of items seek would touch to get to {step}
+		size_t cost(const size_t step) const;
+
+		// the first and the last step every item is highlighted in, FLT_MAX for the items that never are
+		void lifetimes(std::vector<Lifetime>& lifetimes) const;
+
+	private:
+		std::vector<uint32_t> setOffsets_;   // the set of step k is items_[setOffsets_[k], setOffsets_[k+1])
+		std::vector<int> items_;
+		std::vector<uint32_t> diffOffsets_;  // the items changing from step k to k+1
+		std::vector<uint32_t> enterEnds_;    // diffItems_[diffOffsets_[k], enterEnds_[k]) enter, the rest leave
+		std::vector<int> diffItems_;
+		std::vector<uint64_t> diffCosts_;    // the sizes of the diffs before step k summed up
+		std::vector<char> highlighted_;
+		size_t current_;
+		std::vector<int> changed_;
+
+		const int* diff(const size_t offset) const { return diffItems_.empty() ? NULL : &diffItems_[0] + offset; }
+		bool replaceSet(const size_t step) const;
+		void highlight(const int* first, const int* last, const bool on);
+	};
+
+} // namespace sfmviewer
@@ -0,0 +1,133 @@
+/*
+ * trackball-simd-inl.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the array kernels of trackball.cpp written once for all vector widths
+ *
+ *  Included by trackball.cpp once per instruction set, inside a namespace that provides the vector type vf
+ *  with W lanes, the mask type vm and the operations used below. loadAoS4 and storeAoS4 move four consecutive
+ *  floats of W elements {stride} floats apart into or out of four registers with contiguous loads and stores. Every kernel processes the first n - n % W
+ *  elements with the same operations in the same order as the scalar functions, so that the results are
+ *  bitwise identical, and returns how many elements it processed.
+ */
+
+	/* ************************************************************************* */
+	// the rotation matrix of W quaternions from q[0], q[4], ... in vector registers
+	static inline void rotmatrix(const vf q[4], vf r[9]) {
+		const vf one = set1(1.0f), two = set1(2.0f);
+		r[0] = sub(one, mul(two, add(mul(q[1], q[1]), mul(q[2], q[2]))));
+		r[1] = mul(two, sub(mul(q[0], q[1]), mul(q[2], q[3])));
+		r[2] = mul(two, add(mul(q[2], q[0]), mul(q[1], q[3])));
+		r[3] = mul(two, add(mul(q[0], q[1]), mul(q[2], q[3])));
+		r[4] = sub(one, mul(two, add(mul(q[2], q[2]), mul(q[0], q[0]))));
+		r[5] = mul(two, sub(mul(q[1], q[2]), mul(q[0], q[3])));
+		r[6] = mul(two, sub(mul(q[2], q[0]), mul(q[1], q[3])));
+		r[7] = mul(two, add(mul(q[1], q[2]), mul(q[0], q[3])));
+		r[8] = sub(one, mul(two, add(mul(q[1], q[1]), mul(q[0], q[0]))));
+	}
+
+	/* ************************************************************************* */
+	static size_t buildRotmatrices(const float* q, float* r, const size_t n) {
+		size_t i = 0;
+		for (; i + W <= n; i += W) {
+			vf qv[4], rv[9];
+			loadAoS4(q + 4*i, 4, qv);
+			rotmatrix(qv, rv);
+			storeAoS4(r + 9*i, 9, rv);
+			storeAoS4(r + 9*i + 4, 9, rv + 4);
+			storeStrided(r + 9*i + 8, 9, rv[8]);
+		}
+		return i;
+	}
+
+	/* ************************************************************************* */
+	// dest = q1 q2 as in add_quats, without the renormalization
+	static size_t addQuats(const float* q1, const float* q2, float* dest, const size_t n) {
+		size_t i = 0;
+		for (; i + W <= n; i += W) {
+			vf a[4], b[4];
+			loadAoS4(q1 + 4*i, 4, a);
+			loadAoS4(q2 + 4*i, 4, b);
+			// t1 + t2 with t1 = q1 * q2[3] and t2 = q2 * q1[3], then t3 + tf with t3 = q2 x q1
+			vf d[4];
+			d[0] = add(sub(mul(b[1], a[2]), mul(b[2], a[1])), add(mul(a[0], b[3]), mul(b[0], a[3])));
+			d[1] = add(sub(mul(b[2], a[0]), mul(b[0], a[2])), add(mul(a[1], b[3]), mul(b[1], a[3])));
+			d[2] = add(sub(mul(b[0], a[1]), mul(b[1], a[0])), add(mul(a[2], b[3]), mul(b[2], a[3])));
+			d[3] = sub(mul(a[3], b[3]), add(add(mul(a[0], b[0]), mul(a[1], b[1])), mul(a[2], b[2])));
+			storeAoS4(dest + 4*i, 4, d);
+		}
+		return i;
+	}
+
+	/* ************************************************************************* */
+	static size_t buildTranMatrices(const QuatPose* poses, float* m, const size_t n) {
+		const float* p = reinterpret_cast<const float*>(poses);
+		const int stride = sizeof(QuatPose) / sizeof(float);
+		const vf zero = set1(0.f), one = set1(1.f);
+		size_t i = 0;
+		for (; i + W <= n; i += W) {
+			// the translation and the quaternion overlap in the first quaternion component
+			vf t[4], qv[4], rv[9];
+			loadAoS4(p + stride*i, stride, t);
+			loadAoS4(p + stride*i + 3, stride, qv);
+			rotmatrix(qv, rv);
+
+			// [R' -R't; 0 1] row by row
+			float* out = m + 16*i;
+			for (int a=0; a<3; a++) {
+				vf row[4] = {rv[a], rv[3 + a], rv[6 + a],
+						sub(sub(mul(neg(rv[a]), t[0]), mul(rv[3 + a], t[1])), mul(rv[6 + a], t[2]))};
+				storeAoS4(out + 4*a, 16, row);
+			}
+			vf row[4] = {zero, zero, zero, one};
+			storeAoS4(out + 12, 16, row);
+		}
+		return i;
+	}
+
+	/* ************************************************************************* */
+	// all four branches of rotation_to_quaternion are evaluated and the taken one is selected per lane
+	static size_t rotationsToQuaternions(const float* m, float* q, const size_t n) {
+		const vf one = set1(1.0f), two = set1(2.0f), half = set1(0.5f), quarter = set1(0.25f);
+		size_t i = 0;
+		for (; i + W <= n; i += W) {
+			vf a[3][4];
+			for (int r=0; r<3; r++)
+				loadAoS4(m + 16*i + 4*r, 16, a[r]);
+
+			const vf trace = add(add(add(a[0][0], a[1][1]), a[2][2]), one);
+			const vm c0 = gt(trace, one);
+			const vm c1 = andnotMask(c0, andMask(gt(a[0][0], a[1][1]), gt(a[0][0], a[2][2])));
+			const vm c2 = andnotMask(c0, andnotMask(c1, gt(a[1][1], a[2][2])));
+			const vm c3 = andnotMask(c0, andnotMask(c1, andnotMask(c2, allMask())));
+
+			const vf d21 = sub(a[2][1], a[1][2]), d02 = sub(a[0][2], a[2][0]), d10 = sub(a[1][0], a[0][1]);
+			const vf s01 = add(a[0][1], a[1][0]), s02 = add(a[0][2], a[2][0]), s12 = add(a[1][2], a[2][1]);
+
+			const vf s0 = div(half, sqrt(trace));
+			vf x = mul(d21, s0), y = mul(d02, s0), z = mul(d10, s0), w = div(quarter, s0);
+
+			const vf s1 = mul(two, sqrt(sub(sub(add(one, a[0][0]), a[1][1]), a[2][2])));
+			x = select(c1, mul(quarter, s1), x);
+			y = select(c1, div(s01, s1), y);
+			z = select(c1, div(s02, s1), z);
+			w = select(c1, div(d21, s1), w);
+
+			const vf s2 = mul(two, sqrt(sub(sub(add(one, a[1][1]), a[0][0]), a[2][2])));
+			x = select(c2, div(s01, s2), x);
+			y = select(c2, mul(quarter, s2), y);
+			z = select(c2, div(s12, s2), z);
+			w = select(c2, div(d02, s2), w);
+
+			const vf s3 = mul(two, sqrt(sub(sub(add(one, a[2][2]), a[0][0]), a[1][1])));
+			x = select(c3, div(s02, s3), x);
+			y = select(c3, div(s12, s3), y);
+			z = select(c3, mul(quarter, s3), z);
+			w = select(c3, div(d10, s3), w);
+
+			const vf quat[4] = {x, y, z, w};
+			storeAoS4(q + 4*i, 4, quat);
+		}
+		return i;
+	}
@@ -52,6 +52,15 @@
 #include <math.h>
 #include "trackball.h"
 
+/*
+ * The array versions below have kernels for wider instruction sets
+ * than the build targets, they are selected at runtime
+ */
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define TRACKBALL_SIMD
+#include <immintrin.h>
+#endif
+
 /*
  * This size should really be based on the distance from the center of
  * rotation to the point on the object underneath the mouse.  That
@@ -245,10 +254,9 @@ tb_project_to_sphere(float r, float x, float y)
 
 #define RENORMCOUNT 97
 
-void
-add_quats(float q1[4], float q2[4], float dest[4])
+static void
+mul_quats(const float q1[4], const float q2[4], float dest[4])
 {
-    static int count=0;
     float t1[4], t2[4], t3[4];
     float tf[4];
 
@@ -267,7 +275,14 @@ add_quats(float q1[4], float q2[4], float dest[4])
     dest[1] = tf[1];
     dest[2] = tf[2];
     dest[3] = tf[3];
+}
+
+void
+add_quats(float q1[4], float q2[4], float dest[4])
+{
+    static int count=0;
 
+    mul_quats(q1, q2, dest);
     if (++count > RENORMCOUNT) {
         count = 0;
         normalize_quat(dest);
@@ -341,7 +356,7 @@ build_tran_matrix (const QuatPose& pose, float p[4][4])
 void rotation_to_quaternion( float a[4][4], float q[4] ) 
 {
   float trace = a[0][0] + a[1][1] + a[2][2] + 1.0f;
-  if( trace > 0.0f ) {
+  if( trace > 1.0f ) { // the diagonal branches are more accurate for large angles
     float s = 0.5f / sqrtf(trace);
     q[3] = 0.25f / s;
     q[0] = ( a[2][1] - a[1][2] ) * s;
@@ -350,7 +365,7 @@ void rotation_to_quaternion( float a[4][4], float q[4] )
   } else {
     if ( a[0][0] > a[1][1] && a[0][0] > a[2][2] ) {
       float s = 2.0f * sqrtf( 1.0f + a[0][0] - a[1][1] - a[2][2]);
-      q[3] = (a[1][2] - a[2][1] ) / s;
+      q[3] = (a[2][1] - a[1][2] ) / s;
       q[0] = 0.25f * s;
       q[1] = (a[0][1] + a[1][0] ) / s;
       q[2] = (a[0][2] + a[2][0] ) / s;
@@ -362,10 +377,307 @@ void rotation_to_quaternion( float a[4][4], float q[4] )
       q[2] = (a[1][2] + a[2][1] ) / s;
     } else {
       float s = 2.0f * sqrtf( 1.0f + a[2][2] - a[0][0] - a[1][1] );
-      q[3] = (a[0][1] - a[1][0] ) / s;
+      q[3] = (a[1][0] - a[0][1] ) / s;
       q[0] = (a[0][2] + a[2][0] ) / s;
       q[1] = (a[1][2] + a[2][1] ) / s;
       q[2] = 0.25f * s;
     }
   }
 }
+
+/*
+ * Array versions for whole trajectories. The same kernel source is
+ * compiled for SSE2, AVX2 and AVX-512 and the widest one the cpu supports
+ * is used, every kernel is checked against the scalar functions by
+ * sfmmicrobench --verify.
+ */
+
+static size_t
+build_rotmatrix_scalar(const float *q, float *r, const size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        build_rotmatrix((float (*)[3])(r + 9*i), q + 4*i);
+    return n;
+}
+
+static size_t
+add_quats_scalar(const float *q1, const float *q2, float *dest, const size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        mul_quats(q1 + 4*i, q2 + 4*i, dest + 4*i);
+    return n;
+}
+
+static size_t
+build_tran_matrix_scalar(const QuatPose *poses, float *m, const size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        build_tran_matrix(poses[i], (float (*)[4])(m + 16*i));
+    return n;
+}
+
+static size_t
+rotation_to_quaternion_scalar(const float *m, float *q, const size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        rotation_to_quaternion((float (*)[4])(m + 16*i), q + 4*i);
+    return n;
+}
+
+#ifdef TRACKBALL_SIMD
+
+/* the kernels read the poses as 7 consecutive floats */
+typedef char quat_pose_is_packed[sizeof(QuatPose) == 7 * sizeof(float) ? 1 : -1];
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+namespace trackball_sse2 {
+    typedef __m128 vf;
+    typedef __m128 vm;
+    static const int W = 4;
+    static inline vf set1(float a) { return _mm_set1_ps(a); }
+    static inline vf add(vf a, vf b) { return _mm_add_ps(a, b); }
+    static inline vf sub(vf a, vf b) { return _mm_sub_ps(a, b); }
+    static inline vf mul(vf a, vf b) { return _mm_mul_ps(a, b); }
+    static inline vf div(vf a, vf b) { return _mm_div_ps(a, b); }
+    static inline vf neg(vf a) { return _mm_xor_ps(a, _mm_set1_ps(-0.f)); }
+    static inline vf sqrt(vf a) { return _mm_sqrt_ps(a); }
+    static inline vm gt(vf a, vf b) { return _mm_cmpgt_ps(a, b); }
+    static inline vm andMask(vm a, vm b) { return _mm_and_ps(a, b); }
+    static inline vm andnotMask(vm a, vm b) { return _mm_andnot_ps(a, b); }
+    static inline vm allMask() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+    static inline vf select(vm m, vf a, vf b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    static inline void storeStrided(float *p, int s, vf v) {
+        float t[4];
+        _mm_storeu_ps(t, v);
+        for (int k = 0; k < 4; k++) p[k*s] = t[k];
+    }
+    static inline void loadAoS4(const float *p, int s, vf v[4]) {
+        for (int k = 0; k < 4; k++) v[k] = _mm_loadu_ps(p + k*s);
+        _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+    }
+    static inline void storeAoS4(float *p, int s, const vf v[4]) {
+        vf t0 = v[0], t1 = v[1], t2 = v[2], t3 = v[3];
+        _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+        _mm_storeu_ps(p, t0); _mm_storeu_ps(p + s, t1); _mm_storeu_ps(p + 2*s, t2); _mm_storeu_ps(p + 3*s, t3);
+    }
+#include "trackball-simd-inl.h"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace trackball_avx2 {
+    typedef __m256 vf;
+    typedef __m256 vm;
+    static const int W = 8;
+    static inline vf set1(float a) { return _mm256_set1_ps(a); }
+    static inline vf add(vf a, vf b) { return _mm256_add_ps(a, b); }
+    static inline vf sub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+    static inline vf mul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+    static inline vf div(vf a, vf b) { return _mm256_div_ps(a, b); }
+    static inline vf neg(vf a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.f)); }
+    static inline vf sqrt(vf a) { return _mm256_sqrt_ps(a); }
+    static inline vm gt(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static inline vm andMask(vm a, vm b) { return _mm256_and_ps(a, b); }
+    static inline vm andnotMask(vm a, vm b) { return _mm256_andnot_ps(a, b); }
+    static inline vm allMask() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    static inline vf select(vm m, vf a, vf b) { return _mm256_blendv_ps(b, a, m); }
+    static inline void storeStrided(float *p, int s, vf v) {
+        float t[8];
+        _mm256_storeu_ps(t, v);
+        for (int k = 0; k < 8; k++) p[k*s] = t[k];
+    }
+    // the 4x4 transpose within each 128 bit lane
+    static inline void transpose4(vf v[4]) {
+        const vf t0 = _mm256_unpacklo_ps(v[0], v[1]), t1 = _mm256_unpackhi_ps(v[0], v[1]);
+        const vf t2 = _mm256_unpacklo_ps(v[2], v[3]), t3 = _mm256_unpackhi_ps(v[2], v[3]);
+        v[0] = _mm256_shuffle_ps(t0, t2, 0x44); v[1] = _mm256_shuffle_ps(t0, t2, 0xEE);
+        v[2] = _mm256_shuffle_ps(t1, t3, 0x44); v[3] = _mm256_shuffle_ps(t1, t3, 0xEE);
+    }
+    static inline void loadAoS4(const float *p, int s, vf v[4]) {
+        for (int k = 0; k < 4; k++)
+            v[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + k*s)), _mm_loadu_ps(p + (k + 4)*s), 1);
+        transpose4(v);
+    }
+    static inline void storeAoS4(float *p, int s, const vf v[4]) {
+        vf t[4] = {v[0], v[1], v[2], v[3]};
+        transpose4(t);
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_ps(p + k*s, _mm256_castps256_ps128(t[k]));
+            _mm_storeu_ps(p + (k + 4)*s, _mm256_extractf128_ps(t[k], 1));
+        }
+    }
+#include "trackball-simd-inl.h"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#pragma GCC optimize("fp-contract=off")
+#pragma GCC diagnostic push
+/* the undefined upper lanes inside the avx512 intrinsics make gcc warn */
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+namespace trackball_avx512 {
+    typedef __m512 vf;
+    typedef __mmask16 vm;
+    static const int W = 16;
+    static inline vf set1(float a) { return _mm512_set1_ps(a); }
+    static inline vf add(vf a, vf b) { return _mm512_add_ps(a, b); }
+    static inline vf sub(vf a, vf b) { return _mm512_sub_ps(a, b); }
+    static inline vf mul(vf a, vf b) { return _mm512_mul_ps(a, b); }
+    static inline vf div(vf a, vf b) { return _mm512_div_ps(a, b); }
+    static inline vf neg(vf a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x80000000))); }
+    static inline vf sqrt(vf a) { return _mm512_sqrt_ps(a); }
+    static inline vm gt(vf a, vf b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static inline vm andMask(vm a, vm b) { return (vm)(a & b); }
+    static inline vm andnotMask(vm a, vm b) { return (vm)(~a & b); }
+    static inline vm allMask() { return (vm)0xFFFF; }
+    static inline vf select(vm m, vf a, vf b) { return _mm512_mask_blend_ps(m, b, a); }
+    static inline void storeStrided(float *p, int s, vf v) {
+        float t[16];
+        _mm512_storeu_ps(t, v);
+        for (int k = 0; k < 16; k++) p[k*s] = t[k];
+    }
+    static inline void transpose4(vf v[4]) {
+        const vf t0 = _mm512_unpacklo_ps(v[0], v[1]), t1 = _mm512_unpackhi_ps(v[0], v[1]);
+        const vf t2 = _mm512_unpacklo_ps(v[2], v[3]), t3 = _mm512_unpackhi_ps(v[2], v[3]);
+        v[0] = _mm512_shuffle_ps(t0, t2, 0x44); v[1] = _mm512_shuffle_ps(t0, t2, 0xEE);
+        v[2] = _mm512_shuffle_ps(t1, t3, 0x44); v[3] = _mm512_shuffle_ps(t1, t3, 0xEE);
+    }
+    static inline void loadAoS4(const float *p, int s, vf v[4]) {
+        for (int k = 0; k < 4; k++) {
+            vf x = _mm512_insertf32x4(_mm512_setzero_ps(), _mm_loadu_ps(p + k*s), 0);
+            x = _mm512_insertf32x4(x, _mm_loadu_ps(p + (k + 4)*s), 1);
+            x = _mm512_insertf32x4(x, _mm_loadu_ps(p + (k + 8)*s), 2);
+            v[k] = _mm512_insertf32x4(x, _mm_loadu_ps(p + (k + 12)*s), 3);
+        }
+        transpose4(v);
+    }
+    static inline void storeAoS4(float *p, int s, const vf v[4]) {
+        vf t[4] = {v[0], v[1], v[2], v[3]};
+        transpose4(t);
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_ps(p + k*s, _mm512_castps512_ps128(t[k]));
+            _mm_storeu_ps(p + (k + 4)*s, _mm512_extractf32x4_ps(t[k], 1));
+            _mm_storeu_ps(p + (k + 8)*s, _mm512_extractf32x4_ps(t[k], 2));
+            _mm_storeu_ps(p + (k + 12)*s, _mm512_extractf32x4_ps(t[k], 3));
+        }
+    }
+#include "trackball-simd-inl.h"
+}
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+
+#endif
+
+static SimdLevel
+detect_simd_level()
+{
+#ifdef TRACKBALL_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+static const SimdLevel supported_level = detect_simd_level();
+static SimdLevel current_level = supported_level;
+
+SimdLevel
+simd_supported()
+{
+    return supported_level;
+}
+
+SimdLevel
+simd_level()
+{
+    return current_level;
+}
+
+void
+set_simd_level(SimdLevel level)
+{
+    current_level = level < supported_level ? level : supported_level;
+}
+
+const char *
+simd_level_name(SimdLevel level)
+{
+    switch (level) {
+    case SIMD_SSE2: return "sse2";
+    case SIMD_AVX2: return "avx2";
+    case SIMD_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+/*
+ * the poses are split into blocks for the threads, the kernel of the
+ * current level does the bulk of a block and the scalar one the rest
+ */
+#define TRACKBALL_BLOCK 4096
+
+#ifdef TRACKBALL_SIMD
+#define TRACKBALL_KERNEL(name, scalar) \
+    (current_level == SIMD_AVX512 ? trackball_avx512::name : \
+     current_level == SIMD_AVX2 ? trackball_avx2::name : \
+     current_level == SIMD_SSE2 ? trackball_sse2::name : scalar)
+#else
+#define TRACKBALL_KERNEL(name, scalar) (scalar)
+#endif
+
+void
+build_rotmatrix_array(const float *q, float *r, size_t n)
+{
+    const long num_blocks = (n + TRACKBALL_BLOCK - 1) / TRACKBALL_BLOCK;
+#pragma omp parallel for schedule(static)
+    for (long b = 0; b < num_blocks; b++) {
+        const size_t begin = b * TRACKBALL_BLOCK;
+        const size_t count = n - begin < TRACKBALL_BLOCK ? n - begin : TRACKBALL_BLOCK;
+        const size_t done = TRACKBALL_KERNEL(buildRotmatrices, build_rotmatrix_scalar)(q + 4*begin, r + 9*begin, count);
+        build_rotmatrix_scalar(q + 4*(begin + done), r + 9*(begin + done), count - done);
+    }
+}
+
+void
+add_quats_array(const float *q1, const float *q2, float *dest, size_t n)
+{
+    const long num_blocks = (n + TRACKBALL_BLOCK - 1) / TRACKBALL_BLOCK;
+#pragma omp parallel for schedule(static)
+    for (long b = 0; b < num_blocks; b++) {
+        const size_t begin = b * TRACKBALL_BLOCK;
+        const size_t count = n - begin < TRACKBALL_BLOCK ? n - begin : TRACKBALL_BLOCK;
+        const size_t done = TRACKBALL_KERNEL(addQuats, add_quats_scalar)(q1 + 4*begin, q2 + 4*begin, dest + 4*begin, count);
+        add_quats_scalar(q1 + 4*(begin + done), q2 + 4*(begin + done), dest + 4*(begin + done), count - done);
+    }
+}
+
+void
+build_tran_matrix_array(const QuatPose *poses, float *m, size_t n)
+{
+    const long num_blocks = (n + TRACKBALL_BLOCK - 1) / TRACKBALL_BLOCK;
+#pragma omp parallel for schedule(static)
+    for (long b = 0; b < num_blocks; b++) {
+        const size_t begin = b * TRACKBALL_BLOCK;
+        const size_t count = n - begin < TRACKBALL_BLOCK ? n - begin : TRACKBALL_BLOCK;
+        const size_t done = TRACKBALL_KERNEL(buildTranMatrices, build_tran_matrix_scalar)(poses + begin, m + 16*begin, count);
+        build_tran_matrix_scalar(poses + begin + done, m + 16*(begin + done), count - done);
+    }
+}
+
+void
+rotation_to_quaternion_array(const float *m, float *q, size_t n)
+{
+    const long num_blocks = (n + TRACKBALL_BLOCK - 1) / TRACKBALL_BLOCK;
+#pragma omp parallel for schedule(static)
+    for (long b = 0; b < num_blocks; b++) {
+        const size_t begin = b * TRACKBALL_BLOCK;
+        const size_t count = n - begin < TRACKBALL_BLOCK ? n - begin : TRACKBALL_BLOCK;
+        const size_t done = TRACKBALL_KERNEL(rotationsToQuaternions, rotation_to_quaternion_scalar)(m + 16*begin, q + 4*begin, count);
+        rotation_to_quaternion_scalar(m + 16*(begin + done), q + 4*(begin + done), count - done);
+    }
+}
@@ -43,6 +43,7 @@
 #pragma once
 
 #include <string>
+#include <stddef.h>
 
 // Kai: the data structure for the poses with quaternion rotations
 struct QuatPose {
@@ -99,3 +100,26 @@ void
 axis_to_quat(float a[3], float phi, float q[4]);
 
 void rotation_to_quaternion( float a[4][4], float q[4] );
+
+/*
+ * Array versions of the functions above for whole trajectories,
+ * with n quaternions of 4 floats, n rotation matrices of 9 floats and n
+ * transformations of 16 floats, all row major. add_quats_array does not
+ * renormalize. The kernels use the widest instruction set of the cpu and
+ * all the threads, and give the same results as the scalar functions.
+ */
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+
+// the widest instruction set of this cpu
+SimdLevel simd_supported();
+
+// the instruction set of the array functions, a level above the supported one is lowered to it
+SimdLevel simd_level();
+void set_simd_level(SimdLevel level);
+
+const char *simd_level_name(SimdLevel level);
+
+void build_rotmatrix_array(const float *q, float *r, size_t n);
+void add_quats_array(const float *q1, const float *q2, float *dest, size_t n);
+void build_tran_matrix_array(const QuatPose *poses, float *m, size_t n);
+void rotation_to_quaternion_array(const float *m, float *q, size_t n);
@@ -0,0 +1,207 @@
+/*
+ * trackstats.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the track and camera statistics of a reconstruction, kept up to date as visibility streams in
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "trackstats.h"
+
+using namespace std;
+
+namespace sfmviewer {
+
+	/* ************************************************************************* */
+	void CountHistogram::add(const uint32_t count) {
+		if (count >= bins.size()) bins.resize(count + 1, 0);
+		bins[count]++;
+		items++;
+		sum += count;
+	}
+
+	/* ************************************************************************* */
+	void CountHistogram::remove(const uint32_t count) {
+		if (count >= bins.size() || bins[count] == 0)
+			throw std::runtime_error("CountHistogram::remove: no item with this count");
+		bins[count]--;
+		items--;
+		sum -= count;
+	}
+
+	/* ************************************************************************* */
+	uint32_t CountHistogram::median() const {
+		const uint64_t half = (nonzero() + 1) / 2;
+		uint64_t seen = 0;
+		for (size_t k=1; k<bins.size(); k++)
+			if ((seen += bins[k]) >= half && half > 0) return k;
+		return 0;
+	}
+
+	/* ************************************************************************* */
+	uint32_t CountHistogram::max() const {
+		for (size_t k=bins.size(); k-->0; )
+			if (bins[k]) return k;
+		return 0;
+	}
+
+	/* ************************************************************************* */
+	// the histogram of {counts}, every thread counts its part and the parts are added up
+	static void countHistogram(const vector<uint32_t>& counts, CountHistogram& histogram) {
+		histogram = CountHistogram();
+#pragma omp parallel
+		{
+			CountHistogram local;
+#pragma omp for schedule(static) nowait
+			for (long i=0; i<(long)counts.size(); i++)
+				local.add(counts[i]);
+#pragma omp critical
+			{
+				if (local.bins.size() > histogram.bins.size()) histogram.bins.resize(local.bins.size(), 0);
+				for (size_t k=0; k<local.bins.size(); k++)
+					histogram.bins[k] += local.bins[k];
+				histogram.items += local.items;
+				histogram.sum += local.sum;
+			}
+		}
+	}
+
+	/* ************************************************************************* */
+	void TrackStatistics::resizePoints(const size_t numPoints) {
+		for (size_t p=pointObservations_.size(); p<numPoints; p++) {
+			trackLengths_.add(0);
+			camerasPerPoint_.add(0);
+		}
+		pointObservations_.resize(max(numPoints, pointObservations_.size()), 0);
+		pointCameras_.resize(max(numPoints, pointCameras_.size()), 0);
+	}
+
+	/* ************************************************************************* */
+	void TrackStatistics::compute(const vector<vector<int> >& cameraPoints, const size_t numPoints) {
+		for (size_t c=0; c<cameraPoints.size(); c++)
+			for (size_t k=0; k<cameraPoints[c].size(); k++)
+				if (cameraPoints[c][k] < 0 || (size_t)cameraPoints[c][k] >= numPoints)
+					throw std::runtime_error("TrackStatistics::compute: point index out of range");
+
+		// the sorted points and the counts of every camera
+		const size_t numCameras = cameraPoints.size();
+		cameraPoints_ = cameraPoints;
+		vector<uint32_t> cameraObservations(numCameras), cameraDistinct(numCameras);
+		long numObservations = 0;
+#pragma omp parallel for schedule(dynamic, 16) reduction(+:numObservations)
+		for (long c=0; c<(long)numCameras; c++) {
+			vector<int>& points = cameraPoints_[c];
+			sort(points.begin(), points.end());
+			cameraObservations[c] = points.size();
+			cameraDistinct[c] = points.empty() ? 0 : 1;
+			for (size_t k=1; k<points.size(); k++)
+				cameraDistinct[c] += points[k] != points[k-1];
+			numObservations += points.size();
+		}
+		numObservations_ = numObservations;
+
+		// the counts of every point, the cameras are spread over the threads
+		pointObservations_.assign(numPoints, 0);
+		pointCameras_.assign(numPoints, 0);
+#pragma omp parallel for schedule(dynamic, 16)
+		for (long c=0; c<(long)numCameras; c++) {
+			const vector<int>& points = cameraPoints_[c];
+			for (size_t k=0; k<points.size(); k++) {
+#pragma omp atomic
+				pointObservations_[points[k]]++;
+				if (k == 0 || points[k] != points[k-1]) {
+#pragma omp atomic
+					pointCameras_[points[k]]++;
+				}
+			}
+		}
+
+		countHistogram(pointObservations_, trackLengths_);
+		countHistogram(pointCameras_, camerasPerPoint_);
+		countHistogram(cameraObservations, observationsPerCamera_);
+		countHistogram(cameraDistinct, pointsPerCamera_);
+	}
+
+	/* ************************************************************************* */
+	void TrackStatistics::setCamera(const size_t c, const vector<int>& points) {
+		for (size_t k=0; k<points.size(); k++)
+			if (points[k] < 0)
+				throw std::runtime_error("TrackStatistics::setCamera: negative point index");
+		while (c >= cameraPoints_.size()) {
+			cameraPoints_.push_back(vector<int>());
+			observationsPerCamera_.add(0);
+			pointsPerCamera_.add(0);
+		}
+
+		// take the old points out, point by point
+		vector<int>& old = cameraPoints_[c];
+		uint32_t distinct = 0;
+		for (size_t k=0; k<old.size(); k++) {
+			const int p = old[k];
+			trackLengths_.move(pointObservations_[p], pointObservations_[p] - 1);
+			pointObservations_[p]--;
+			if (k == 0 || p != old[k-1]) {
+				camerasPerPoint_.move(pointCameras_[p], pointCameras_[p] - 1);
+				pointCameras_[p]--;
+				distinct++;
+			}
+		}
+		numObservations_ -= old.size();
+		const uint32_t oldObservations = old.size(), oldDistinct = distinct;
+
+		// and the new ones in
+		old = points;
+		sort(old.begin(), old.end());
+		if (!old.empty()) resizePoints(old.back() + 1);
+		distinct = 0;
+		for (size_t k=0; k<old.size(); k++) {
+			const int p = old[k];
+			trackLengths_.move(pointObservations_[p], pointObservations_[p] + 1);
+			pointObservations_[p]++;
+			if (k == 0 || p != old[k-1]) {
+				camerasPerPoint_.move(pointCameras_[p], pointCameras_[p] + 1);
+				pointCameras_[p]++;
+				distinct++;
+			}
+		}
+		numObservations_ += old.size();
+		observationsPerCamera_.move(oldObservations, old.size());
+		pointsPerCamera_.move(oldDistinct, distinct);
+	}
+
+	/* ************************************************************************* */
+	string TrackStatistics::report(const uint32_t maxBin) const {
+		ostringstream os;
+		os << fixed << setprecision(1);
+		os << "cameras        " << setw(9) << numCameras() << "  (" << observationsPerCamera_.nonzero() << " seeing points)\n";
+		os << "points         " << setw(9) << numPoints() << "  (" << trackLengths_.nonzero() << " observed)\n";
+		os << "observations   " << setw(9) << numObservations_ << "\n\n";
+
+		os << "                    mean  median     max\n";
+		const CountHistogram* histograms[4] = {&trackLengths_, &camerasPerPoint_, &observationsPerCamera_, &pointsPerCamera_};
+		const char* names[4] = {"track length   ", "cameras/point  ", "obs/camera     ", "points/camera  "};
+		for (int i=0; i<4; i++)
+			os << names[i] << setw(9) << histograms[i]->mean() << setw(8) << histograms[i]->median()
+				 << setw(8) << histograms[i]->max() << "\n";
+
+		// the bars of the track lengths from 1 to maxBin and more, scaled to the longest one
+		os << "\ntrack lengths\n";
+		vector<uint64_t> bars(maxBin + 1, 0);
+		for (size_t k=1; k<trackLengths_.bins.size(); k++)
+			bars[min<size_t>(k, maxBin)] += trackLengths_.bins[k];
+		const uint64_t longest = max<uint64_t>(1, *max_element(bars.begin(), bars.end()));
+		for (uint32_t k=1; k<=maxBin; k++) {
+			ostringstream label;
+			label << k << (k == maxBin ? "+" : "");
+			os << setw(4) << label.str() << " " << left << setw(30) << string(bars[k] * 30 / longest, '#') << right
+				 << setw(9) << bars[k] << "\n";
+		}
+		return os.str();
+	}
+
+} // namespace sfmviewer
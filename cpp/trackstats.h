@@ -0,0 +1,79 @@
+/*
+ * trackstats.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the track and camera statistics of a reconstruction, kept up to date as visibility streams in
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sfmviewer {
+
+	// how many items have every count, e.g. how many points are seen by k cameras. the items with count 0 are
+	// included, so an item can move between bins without being added or removed
+	struct CountHistogram {
+		std::vector<uint64_t> bins;   // bins[k] is the number of items with count k
+		uint64_t items, sum;
+
+		CountHistogram() : items(0), sum(0) {}
+
+		void add(const uint32_t count);
+		void remove(const uint32_t count);
+		void move(const uint32_t from, const uint32_t to) { if (from != to) { remove(from); add(to); } }
+
+		// the items with a count above 0 and their mean, median and maximum count
+		uint64_t nonzero() const { return items - (bins.empty() ? 0 : bins[0]); }
+		double mean() const { return nonzero() ? (double)sum / nonzero() : 0.; }
+		uint32_t median() const;
+		uint32_t max() const;
+	};
+
+	// the statistics of the points every camera sees: the track lengths, i.e. the observations per point, the
+	// cameras per point, the observations per camera and the points per camera. a point observed twice by the
+	// same camera counts twice as an observation and once otherwise. compute sorts the cameras and counts the
+	// points in parallel, setCamera changes only the counts of the points of that camera, so that a stream of
+	// frames keeps the statistics up to date at the cost of the frames
+	class TrackStatistics {
+	public:
+		TrackStatistics() : numObservations_(0) {}
+
+		// the statistics of {cameraPoints}, the indices of the points every camera sees, out of {numPoints}
+		void compute(const std::vector<std::vector<int> >& cameraPoints, const size_t numPoints);
+
+		// replace the points camera {c} sees, the cameras and points grow as needed
+		void setCamera(const size_t c, const std::vector<int>& points);
+
+		size_t numCameras() const { return cameraPoints_.size(); }
+		size_t numPoints() const { return pointObservations_.size(); }
+		uint64_t numObservations() const { return numObservations_; }
+
+		const CountHistogram& trackLengths() const { return trackLengths_; }
+		const CountHistogram& camerasPerPoint() const { return camerasPerPoint_; }
+		const CountHistogram& observationsPerCamera() const { return observationsPerCamera_; }
+		const CountHistogram& pointsPerCamera() const { return pointsPerCamera_; }
+
+		// the numbers and the track length histogram as text lines for a fixed-width font, the track lengths
+		// from {maxBin} up are put together in the last bar
+		std::string report(const uint32_t maxBin = 16) const;
+
+	private:
+		std::vector<std::vector<int> > cameraPoints_;  // sorted, with repeated observations
+		std::vector<uint32_t> pointObservations_;
+		std::vector<uint32_t> pointCameras_;
+		uint64_t numObservations_;
+
+		CountHistogram trackLengths_;
+		CountHistogram camerasPerPoint_;
+		CountHistogram observationsPerCamera_;
+		CountHistogram pointsPerCamera_;
+
+		void resizePoints(const size_t numPoints);
+	};
+
+} // namespace sfmviewer
@@ -0,0 +1,222 @@
+/*
+ * visibilityset.cpp
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the points seen by every camera as compressed bitsets with fast overlap counts
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "visibilityset.h"
+#include "trackball.h"
+
+// the kernels count 64 bit words, which are only native on x86-64
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define VISIBILITY_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace sfmviewer {
+
+	// the overlap of a camera with the query, whose block i is at slot[i] or -1 if it is empty
+	typedef uint32_t (*OverlapKernel)(const uint32_t* ids, const uint64_t* words, const size_t numBlocks,
+			const int32_t* slot, const uint64_t* queryWords);
+
+	/* ************************************************************************* */
+	static uint32_t overlapScalar(const uint32_t* ids, const uint64_t* words, const size_t numBlocks,
+			const int32_t* slot, const uint64_t* queryWords) {
+		uint32_t count = 0;
+		for (size_t i=0; i<numBlocks; i++) {
+			if (slot[ids[i]] < 0) continue;
+			const uint64_t* a = words + i * VisibilitySets::BLOCK_WORDS;
+			const uint64_t* b = queryWords + (size_t)slot[ids[i]] * VisibilitySets::BLOCK_WORDS;
+			for (int k=0; k<VisibilitySets::BLOCK_WORDS; k++)
+				count += __builtin_popcountll(a[k] & b[k]);
+		}
+		return count;
+	}
+
+#ifdef VISIBILITY_SIMD
+
+#pragma GCC push_options
+#pragma GCC target("popcnt")
+	/* ************************************************************************* */
+	// the same with the popcnt instruction, which comes with the cpus of the sse4.2 era
+	static uint32_t overlapPopcnt(const uint32_t* ids, const uint64_t* words, const size_t numBlocks,
+			const int32_t* slot, const uint64_t* queryWords) {
+		uint64_t count = 0;
+		for (size_t i=0; i<numBlocks; i++) {
+			if (slot[ids[i]] < 0) continue;
+			const uint64_t* a = words + i * VisibilitySets::BLOCK_WORDS;
+			const uint64_t* b = queryWords + (size_t)slot[ids[i]] * VisibilitySets::BLOCK_WORDS;
+			for (int k=0; k<VisibilitySets::BLOCK_WORDS; k++)
+				count += _mm_popcnt_u64(a[k] & b[k]);
+		}
+		return count;
+	}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+	/* ************************************************************************* */
+	// the bits of every nibble looked up with a byte shuffle and summed per 64 bits, a block is two registers
+	static uint32_t overlapAvx2(const uint32_t* ids, const uint64_t* words, const size_t numBlocks,
+			const int32_t* slot, const uint64_t* queryWords) {
+		const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+				0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i low = _mm256_set1_epi8(0x0f);
+		__m256i sum = _mm256_setzero_si256();
+		for (size_t i=0; i<numBlocks; i++) {
+			if (slot[ids[i]] < 0) continue;
+			const __m256i* a = (const __m256i*)(words + i * VisibilitySets::BLOCK_WORDS);
+			const __m256i* b = (const __m256i*)(queryWords + (size_t)slot[ids[i]] * VisibilitySets::BLOCK_WORDS);
+			__m256i bytes = _mm256_setzero_si256();
+			for (int k=0; k<2; k++) {
+				const __m256i v = _mm256_and_si256(_mm256_loadu_si256(a + k), _mm256_loadu_si256(b + k));
+				bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(
+						_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low)),
+						_mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low))));
+			}
+			sum = _mm256_add_epi64(sum, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+		}
+		return _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) + _mm256_extract_epi64(sum, 2)
+				+ _mm256_extract_epi64(sum, 3);
+	}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512vpopcntdq")
+	/* ************************************************************************* */
+	// a block is one register
+	static uint32_t overlapAvx512(const uint32_t* ids, const uint64_t* words, const size_t numBlocks,
+			const int32_t* slot, const uint64_t* queryWords) {
+		__m512i sum = _mm512_setzero_si512();
+		for (size_t i=0; i<numBlocks; i++) {
+			if (slot[ids[i]] < 0) continue;
+			const __m512i v = _mm512_and_si512(_mm512_loadu_si512(words + i * VisibilitySets::BLOCK_WORDS),
+					_mm512_loadu_si512(queryWords + (size_t)slot[ids[i]] * VisibilitySets::BLOCK_WORDS));
+			sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(v));
+		}
+		return _mm512_reduce_add_epi64(sum);
+	}
+#pragma GCC pop_options
+
+#endif
+
+	/* ************************************************************************* */
+	// the widest kernel allowed by simd_level that the cpu can run
+	static OverlapKernel overlapKernel() {
+#ifdef VISIBILITY_SIMD
+		__builtin_cpu_init();
+		const SimdLevel level = simd_level();
+		if (level >= SIMD_AVX512 && __builtin_cpu_supports("avx512vpopcntdq")) return overlapAvx512;
+		if (level >= SIMD_AVX2) return overlapAvx2;
+		if (level >= SIMD_SSE2 && __builtin_cpu_supports("popcnt")) return overlapPopcnt;
+#endif
+		return overlapScalar;
+	}
+
+	/* ************************************************************************* */
+	VisibilitySets::VisibilitySets(const vector<vector<int> >& cameraPoints, const size_t numPoints)
+	: numPoints_(numPoints), offsets_(cameraPoints.size() + 1, 0) {
+		// the sorted blocks of every camera, counted first so that the arrays are filled in parallel
+		const size_t numCameras = cameraPoints.size();
+		for (size_t c=0; c<numCameras; c++)
+			for (size_t k=0; k<cameraPoints[c].size(); k++)
+				if (cameraPoints[c][k] < 0 || (size_t)cameraPoints[c][k] >= numPoints)
+					throw std::runtime_error("VisibilitySets: point index out of range");
+		vector<vector<uint32_t> > blocks(numCameras);
+#pragma omp parallel for schedule(dynamic, 16)
+		for (long c=0; c<(long)numCameras; c++) {
+			blocks[c].reserve(cameraPoints[c].size());
+			for (size_t k=0; k<cameraPoints[c].size(); k++)
+				blocks[c].push_back(cameraPoints[c][k] / BLOCK_BITS);
+			sort(blocks[c].begin(), blocks[c].end());
+			blocks[c].erase(unique(blocks[c].begin(), blocks[c].end()), blocks[c].end());
+		}
+		for (size_t c=0; c<numCameras; c++)
+			offsets_[c + 1] = offsets_[c] + blocks[c].size();
+
+		blockIds_.resize(offsets_[numCameras]);
+		words_.assign((size_t)offsets_[numCameras] * BLOCK_WORDS, 0);
+#pragma omp parallel for schedule(dynamic, 16)
+		for (long c=0; c<(long)numCameras; c++) {
+			const vector<uint32_t>& ids = blocks[c];
+			copy(ids.begin(), ids.end(), blockIds_.begin() + offsets_[c]);
+			for (size_t k=0; k<cameraPoints[c].size(); k++) {
+				const int p = cameraPoints[c][k];
+				const size_t i = offsets_[c] + (lower_bound(ids.begin(), ids.end(), (uint32_t)(p / BLOCK_BITS)) - ids.begin());
+				words_[i * BLOCK_WORDS + p % BLOCK_BITS / 64] |= (uint64_t)1 << (p % 64);
+			}
+		}
+	}
+
+	/* ************************************************************************* */
+	uint32_t VisibilitySets::count(const size_t c) const {
+		uint32_t count = 0;
+		for (size_t w=(size_t)offsets_[c] * BLOCK_WORDS; w<(size_t)offsets_[c + 1] * BLOCK_WORDS; w++)
+			count += __builtin_popcountll(words_[w]);
+		return count;
+	}
+
+	/* ************************************************************************* */
+	uint32_t VisibilitySets::overlap(const size_t a, const size_t b) const {
+		// merge the sorted blocks of both cameras
+		uint32_t count = 0;
+		uint32_t i = offsets_[a], j = offsets_[b];
+		while (i < offsets_[a + 1] && j < offsets_[b + 1]) {
+			if (blockIds_[i] < blockIds_[j]) i++;
+			else if (blockIds_[j] < blockIds_[i]) j++;
+			else {
+				for (int k=0; k<BLOCK_WORDS; k++)
+					count += __builtin_popcountll(words_[(size_t)i * BLOCK_WORDS + k] & words_[(size_t)j * BLOCK_WORDS + k]);
+				i++;
+				j++;
+			}
+		}
+		return count;
+	}
+
+	/* ************************************************************************* */
+	void VisibilitySets::overlaps(const size_t query, vector<uint32_t>& counts) const {
+		if (query >= numCameras())
+			throw std::runtime_error("VisibilitySets::overlaps: camera index out of range");
+
+		// where the blocks of the query are, so that the other cameras look them up instead of merging
+		vector<int32_t> slot((numPoints_ + BLOCK_BITS - 1) / BLOCK_BITS + 1, -1);
+		for (uint32_t i=offsets_[query]; i<offsets_[query + 1]; i++)
+			slot[blockIds_[i]] = i - offsets_[query];
+		const uint64_t* queryWords = words_.empty() ? NULL : &words_[(size_t)offsets_[query] * BLOCK_WORDS];
+
+		const OverlapKernel kernel = overlapKernel();
+		counts.resize(numCameras());
+#pragma omp parallel for schedule(dynamic, 64)
+		for (long c=0; c<(long)numCameras(); c++)
+			counts[c] = numBlocks(c) ? kernel(&blockIds_[offsets_[c]], &words_[(size_t)offsets_[c] * BLOCK_WORDS],
+					numBlocks(c), &slot[0], queryWords) : 0;
+	}
+
+	/* ************************************************************************* */
+	void overlapColors(const vector<uint32_t>& counts, const size_t query, const uint32_t minShared,
+			const SFMColor& color, vector<SFMColor>& colors) {
+		uint32_t maxShared = 0;
+		for (size_t c=0; c<counts.size(); c++)
+			if (c != query) maxShared = max(maxShared, counts[c]);
+
+		colors.assign(counts.size(), color);
+		for (size_t c=0; c<counts.size(); c++) {
+			if (c == query)
+				colors[c] = SFMColor(1.f, 0.f, 0.f, 1.f);
+			else if (counts[c] >= minShared && counts[c] > 0) {
+				const float strength = (float)counts[c] / maxShared;
+				colors[c] = SFMColor(0.f, 0.4f + 0.6f * strength, 0.f, 1.f);
+			} else
+				colors[c] = SFMColor(color.r, color.g, color.b, 0.2f * color.alpha);
+		}
+	}
+
+} // namespace sfmviewer
@@ -0,0 +1,57 @@
+/*
+ * visibilityset.h
+ *
+ *   Created on: Oct 19, 2026
+ *       Author: nikai
+ *  Description: the points seen by every camera as compressed bitsets with fast overlap counts
+ */
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "render.h"
+
+namespace sfmviewer {
+
+	// the visible points of every camera as bitsets cut into blocks of 512 points. a camera keeps only the
+	// blocks that have a visible point, in increasing order, so a camera seeing a few nearby points costs a
+	// few cache lines. the overlaps are counted with the widest popcount of simd_level, see trackball.h
+	class VisibilitySets {
+	public:
+		enum { BLOCK_BITS = 512, BLOCK_WORDS = BLOCK_BITS / 64 };
+
+		VisibilitySets() : numPoints_(0), offsets_(1, 0) {}
+
+		// the sets of {cameraPoints}, the indices of the points every camera sees, out of {numPoints}
+		VisibilitySets(const std::vector<std::vector<int> >& cameraPoints, const size_t numPoints);
+
+		size_t numCameras() const { return offsets_.size() - 1; }
+		size_t numPoints() const { return numPoints_; }
+
+		// the number of blocks stored for camera {c}
+		size_t numBlocks(const size_t c) const { return offsets_[c + 1] - offsets_[c]; }
+
+		// the number of points camera {c} sees
+		uint32_t count(const size_t c) const;
+
+		// the number of points both {a} and {b} see
+		uint32_t overlap(const size_t a, const size_t b) const;
+
+		// the overlaps of {query} with all the cameras, including itself, computed in parallel
+		void overlaps(const size_t query, std::vector<uint32_t>& counts) const;
+
+	private:
+		size_t numPoints_;
+		std::vector<uint32_t> offsets_;   // the blocks of camera c are [offsets_[c], offsets_[c+1])
+		std::vector<uint32_t> blockIds_;  // the index of every block among the blocks of all the points
+		std::vector<uint64_t> words_;     // BLOCK_WORDS per block
+	};
+
+	// the colors that show the overlaps {counts} of camera {query}: the query in red, the cameras that share at
+	// least {minShared} points in green, brighter the more they share, and the others in {color} faded out
+	void overlapColors(const std::vector<uint32_t>& counts, const size_t query, const uint32_t minShared,
+			const SFMColor& color, std::vector<SFMColor>& colors);
+
+} // namespace sfmviewer